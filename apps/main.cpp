@@ -3,6 +3,7 @@
 #include "NeuralNetwork.hpp"
 #include "ParallelScheduler.hpp"
 #include "ProjectVersion.hpp"
+#include "TiledInference.hpp"
 #include "TrainingController.hpp"
 #include "controlSystem/TrainingCollection.hpp"
 #include "controlSystem/TrainingCollectionLoader.hpp"
@@ -10,6 +11,7 @@
 #include "openclUtils/clPlatformSelector.hpp"
 #include "tscl.hpp"
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <vector>
@@ -27,11 +29,21 @@ void setupLogger() {
   thandler.minLvl(Log::Information);
 }
 
+// Sets stored as bytes hold no float tensors, so their job is built from the byte tensors, which
+// are normalized when the batches are sliced
+BatchSchedulerJob makeTrainingJob(size_t batch_size, TrainingCollection &collection) {
+  auto &training_set = collection.getTrainingSet();
+  if (training_set.getStorage() == InputStorage::uint8)
+    return {batch_size, training_set.getByteTensors(), collection.getTargets()};
+  return {batch_size, training_set.getTensors(), collection.getTargets()};
+}
+
 // This function is quite big, but it allows the user to trivially specify the hyperparameters in
 // one place. This is especially useful for debugging or benchmarking. This function is not intended
 // for production use.
 bool createAndTrain(std::filesystem::path const &input_path,
-                    std::filesystem::path const &output_path) {
+                    std::filesystem::path const &output_path,
+                    std::filesystem::path const &tiled_path) {
   tscl::logger("Current version: " + tscl::Version::current.to_string(), tscl::Log::Debug);
   tscl::logger("Output path: " + output_path.string(), tscl::Log::Debug);
 
@@ -54,6 +66,15 @@ bool createAndTrain(std::filesystem::path const &input_path,
 
   constexpr OptimType kOptimType = kUseSGD;
 
+  // Set to uint8 to store the training set as bytes on the device, using 4 times less memory
+  constexpr InputStorage kTrainingStorage = InputStorage::float32;
+
+  // Full-resolution images are evaluated by tiles of kImageSize pixels, every kTileStride pixels,
+  // and the heatmap of the kHeatmapClass output is saved for each of them
+  constexpr size_t kTileStride = kImageSize / 2;
+  constexpr size_t kTileBatchSize = 64;
+  constexpr size_t kHeatmapClass = 0;
+
   // Maximum number of thread
   // The scheduler is free to use less if it judges necessary
   constexpr size_t kMaxThread = 4;
@@ -81,6 +102,7 @@ bool createAndTrain(std::filesystem::path const &input_path,
 
   logger("Loading dataset", tscl::Log::Debug);
   TrainingCollectionLoader loader(kTensorSize, kImageSize, kImageSize);
+  loader.setTrainingStorage(kTrainingStorage);
   auto &pre_engine = loader.getPreProcessEngine();
   // Add preprocessing transformations here
   pre_engine.addTransformation(std::make_shared<image::transform::Inversion>());
@@ -121,8 +143,7 @@ bool createAndTrain(std::filesystem::path const &input_path,
   logger("Creating scheduler", tscl::Log::Debug);
 
   ParallelScheduler::Builder scheduler_builder;
-  scheduler_builder.setJob({kBatchSize, training_collection.getTrainingSet().getTensors(),
-                            training_collection.getTargets()});
+  scheduler_builder.setJob(makeTrainingJob(kBatchSize, training_collection));
   // Set the resources for the scheduler
   scheduler_builder.setMaxThread(kMaxThread, kAllowMultipleThreadPerDevice);
   scheduler_builder.setDevices(utils::cl_wrapper.getDevices());
@@ -145,6 +166,29 @@ bool createAndTrain(std::filesystem::path const &input_path,
     tscl::logger(res.getMessage(), tscl::Log::Error);
     return false;
   }
+
+  if (tiled_path.empty()) return true;
+
+  logger("Evaluating full-resolution images by tiles", tscl::Log::Debug);
+  std::vector<std::filesystem::path> images;
+  for (auto &entry : std::filesystem::directory_iterator(tiled_path)) {
+    if (entry.is_regular_file()) images.push_back(entry.path());
+  }
+  std::sort(images.begin(), images.end());
+
+  // The images go through the same transformations as the training set, but are not resized
+  image::transform::TransformEngine tile_engine;
+  tile_engine.addTransformation(std::make_shared<image::transform::Inversion>());
+  tile_engine.addTransformation(std::make_shared<image::transform::BinaryScale>());
+
+  TiledInference tiling(*model, kImageSize, kImageSize, kTileStride, kTileStride, kTileBatchSize);
+  EvalController eval_controller(output_path / "heatmaps", model.get(), nullptr);
+  res = eval_controller.runTiled(images, tiling, kHeatmapClass, &tile_engine);
+  if (not res) {
+    tscl::logger("Tiled evaluation failed with an exception", tscl::Log::Error);
+    tscl::logger(res.getMessage(), tscl::Log::Error);
+    return false;
+  }
   return true;
 }
 
@@ -154,7 +198,8 @@ int main(int argc, char **argv) {
 
 
   if (argc < 2) {
-    tscl::logger("Usage: " + std::string(argv[0]) + " <input_path> (<output_path>)",
+    tscl::logger("Usage: " + std::string(argv[0]) +
+                         " <input_path> (<output_path>) (<full_resolution_path>)",
                  tscl::Log::Information);
     return 1;
   } else if (argc >= 3) {
@@ -167,6 +212,7 @@ int main(int argc, char **argv) {
   for (size_t i = 0; i < argc; i++) args.emplace_back(argv[i]);
 
 
-  bool ret = createAndTrain(args[1], args.size() == 3 ? args[2] : "runs/test");
+  bool ret = createAndTrain(args[1], args.size() >= 3 ? args[2] : "runs/test",
+                            args.size() >= 4 ? args[3] : "");
   return ret ? 0 : 1;
 }
\ No newline at end of file
@@ -1,12 +1,15 @@
 #include "EvalController.hpp"
 #include "MPINeuralNetwork.hpp"
+#include "MPIModelEvaluator.hpp"
 #include "MPIParallelScheduler.hpp"
+#include "MPIPipelineEvaluator.hpp"
+#include "MPIPipelineScheduler.hpp"
 #include "MPITrainingController.hpp"
 #include "ModelEvaluator.hpp"
 #include "ProjectVersion.hpp"
 #include "controlSystem/TrainingCollection.hpp"
 #include "controlSystem/TrainingCollectionLoader.hpp"
-#include "mpiWrapper/TrainingCollectionScatterer.hpp"
+#include "mpiWrapper/DistributedCollectionLoader.hpp"
 #include "neuralNetwork/OptimizationScheduler/SchedulerProfiler.hpp"
 #include "openclUtils/clPlatformSelector.hpp"
 #include "tscl.hpp"
@@ -28,6 +31,15 @@ void setupLogger() {
   thandler.minLvl(Log::Information);
 }
 
+// Sets stored as bytes hold no float tensors, so their job is built from the byte tensors, which
+// are normalized when the batches are sliced
+BatchSchedulerJob makeTrainingJob(size_t batch_size, TrainingCollection &collection) {
+  auto &training_set = collection.getTrainingSet();
+  if (training_set.getStorage() == InputStorage::uint8)
+    return {batch_size, training_set.getByteTensors(), collection.getTargets()};
+  return {batch_size, training_set.getTensors(), collection.getTargets()};
+}
+
 // This function is quite big, but it allows the user to trivially specify the hyperparameters in
 // one place. This is especially useful for debugging or benchmarking. This function is not intended
 // for production use.
@@ -60,6 +72,19 @@ bool createAndTrain(std::filesystem::path const &input_path,
 
   constexpr OptimType kOptimType = kUseSGD;
 
+  // Set to true to train a CNN instead of a perceptron. The filters are always optimized using
+  // SGD
+  constexpr bool kUseCNN = false;
+  // Set to true to split the layers of the perceptron between the processes, instead of the
+  // samples. Only the first process loads the dataset. Not available for CNNs
+  constexpr bool kUsePipeline = false;
+  // The number of micro-batches each batch is split into when using the pipeline
+  constexpr size_t kMicroBatchCount = 4;
+  static_assert(not(kUseCNN and kUsePipeline), "Pipelines are not available for CNNs");
+  // The convolutional part of the CNN, the input size must match the images size
+  const std::string kCNNTopology = std::to_string(kImageSize) + " " + std::to_string(kImageSize) +
+                                   " relu convolution 4 3 3 pooling max 2 2";
+
   // Maximum number of thread
   // The scheduler is free to use less if it judges necessary
   constexpr size_t kMaxThread = 1;
@@ -85,26 +110,43 @@ bool createAndTrain(std::filesystem::path const &input_path,
 
   // Do not add the output size, it is automatically set to the number of classes
   MLPTopology topology = {kImageSize * kImageSize, 64, 64, 64, 64};
+  // When using a CNN, the input size of the perceptron is set to the output size of the cnn
+  MLPTopology cnn_mlp_topology = {64, 64};
+
+
+  // Every process loads its own shard of the training and evaluation sets
+  // When using a pipeline, the first process loads the whole dataset on its own
+  mpiw::DistributedCollectionLoader loader(kUsePipeline ? MPI_COMM_SELF : MPI_COMM_WORLD,
+                                           kTensorSize, kImageSize, kImageSize);
+  auto &pre_engine = loader.getPreProcessEngine();
+  // Add preprocessing transformations here
+  pre_engine.addTransformation(std::make_shared<image::transform::Inversion>());
 
+  auto &engine = loader.getPostProcessEngine();
+  // Add postprocessing transformations here
+  // engine.addTransformation(std::make_shared<image::transform::BinaryScale>());
 
-  mpiw::TrainingCollectionScatterer scatterer(MPI_COMM_WORLD);
   std::unique_ptr<TrainingCollection> local_collection;
-  if (rank == 0) {
-    TrainingCollectionLoader loader(kTensorSize, kImageSize, kImageSize);
-    auto &pre_engine = loader.getPreProcessEngine();
-    // Add preprocessing transformations here
-    pre_engine.addTransformation(std::make_shared<image::transform::Inversion>());
-
-    auto &engine = loader.getPostProcessEngine();
-    // Add postprocessing transformations here
-    // engine.addTransformation(std::make_shared<image::transform::BinaryScale>());
-
-    TrainingCollection full_training_collection = loader.load(input_path);
-    local_collection =
-            std::make_unique<TrainingCollection>(scatterer.scatter(full_training_collection));
-    local_collection->getEvaluationSet() = std::move(full_training_collection.getEvaluationSet());
+  if (not kUsePipeline) {
+    local_collection = std::make_unique<TrainingCollection>(
+            loader.load(input_path, mpiw::DistributedCollectionLoader::EvalSetMode::shard));
   } else {
-    local_collection = std::make_unique<TrainingCollection>(scatterer.receive(0));
+    // The other stages only need the number of classes, 0 meaning the loading failed
+    unsigned long class_count = 0;
+    std::exception_ptr error;
+    if (rank == 0) {
+      try {
+        local_collection = std::make_unique<TrainingCollection>(
+                loader.load(input_path, mpiw::DistributedCollectionLoader::EvalSetMode::full));
+        class_count = local_collection->getClassCount();
+      } catch (...) { error = std::current_exception(); }
+    } else {
+      local_collection = std::make_unique<TrainingCollection>(kImageSize, kImageSize);
+    }
+    MPI_Bcast(&class_count, 1, MPI_UNSIGNED_LONG, 0, MPI_COMM_WORLD);
+    if (error) std::rethrow_exception(error);
+    if (class_count == 0) throw std::runtime_error("The first stage failed to load the dataset");
+    topology.pushBack(class_count);
   }
 
   std::filesystem::create_directories("tmp_" + std::to_string(rank));
@@ -112,52 +154,111 @@ bool createAndTrain(std::filesystem::path const &input_path,
             << "tmp_" + std::to_string(rank)
             << " count: " << local_collection->getTrainingSet().getSize() << std::endl;
 
-  topology.pushBack(local_collection->getClassCount());
+  if (not kUsePipeline) topology.pushBack(local_collection->getClassCount());
+  cnn_mlp_topology.pushBack(local_collection->getClassCount());
 
   if (rank == 0) {
     logger("Training set size: " + std::to_string(local_collection->getTrainingSet().getSize()),
            tscl::Log::Trace);
-    logger("Evaluation set size: " + std::to_string(local_collection->getEvaluationSet().getSize()),
+    logger("Local evaluation set size: " +
+                   std::to_string(local_collection->getEvaluationSet().getSize()),
            tscl::Log::Trace);
   }
 
-  // auto model = nnet::MLPModel::randomReluSigmoid(topology);
-  auto model = nnet::MPIMLPModel::random(topology, af::ActivationFunctionType::leakyRelu);
-  // auto model = std::make_unique<nnet::MLPModel>();
-  // model->load("michal.nnet");
+  std::unique_ptr<Model> model;
   std::unique_ptr<Optimizer> optimizer;
-  if (kOptimType == kUseSGD)
-    optimizer = nnet::MPIMLPOptimizer::make<nnet::SGDOptimization>(*model, kLearningRate);
-  else if (kOptimType == kUseMomentum)
-    optimizer = nnet::MPIMLPOptimizer::make<nnet::MomentumOptimization>(*model, kLearningRate,
-                                                                        kMomentum);
-  else if (kOptimType == kUseDecay)
-    optimizer =
-            nnet::MPIMLPOptimizer::make<nnet::DecayOptimization>(*model, kLearningRate, kDecayRate);
-  else if (kOptimType == kUseDecayMomentum)
-    optimizer = nnet::MPIMLPOptimizer::make<nnet::DecayMomentumOptimization>(*model, kLearningRate,
-                                                                             kDecayRate, kMomentum);
+  // The layers of the local stage, when using a pipeline
+  std::unique_ptr<MLPModel> stage_model;
+  if (kUseCNN) {
+    auto cnn_model = nnet::CNNModel::random(stringToTopology(kCNNTopology), cnn_mlp_topology);
+    auto &mlp = cnn_model->getMlp();
+    std::unique_ptr<Optimization> mlp_optimization;
+    if (kOptimType == kUseSGD)
+      mlp_optimization = std::make_unique<nnet::SGDOptimization>(mlp, kLearningRate);
+    else if (kOptimType == kUseMomentum)
+      mlp_optimization =
+              std::make_unique<nnet::MomentumOptimization>(mlp, kLearningRate, kMomentum);
+    else if (kOptimType == kUseDecay)
+      mlp_optimization =
+              std::make_unique<nnet::DecayOptimization>(mlp, kLearningRate, kDecayRate);
+    else if (kOptimType == kUseDecayMomentum)
+      mlp_optimization = std::make_unique<nnet::DecayMomentumOptimization>(mlp, kLearningRate,
+                                                                           kDecayRate, kMomentum);
+    // Synchronizes the randomly initialized model across processes
+    optimizer = std::make_unique<nnet::MPICNNOptimizer>(
+            *cnn_model, std::move(mlp_optimization),
+            std::make_unique<nnet::CNNSGDOptimization>(cnn_model->getCnn(), kLearningRate));
+    model = std::move(cnn_model);
+  } else if (kUsePipeline) {
+    // Each stage only holds its own layers, there is nothing to synchronize
+    stage_model = nnet::MLPModel::random(makeStageTopology(topology, rank, comm_size),
+                                         af::ActivationFunctionType::leakyRelu);
+    if (kOptimType == kUseSGD)
+      optimizer = nnet::MPIPipelineOptimizer::make<nnet::SGDOptimization>(
+              *stage_model, MPI_COMM_WORLD, kMicroBatchCount, kLearningRate);
+    else if (kOptimType == kUseMomentum)
+      optimizer = nnet::MPIPipelineOptimizer::make<nnet::MomentumOptimization>(
+              *stage_model, MPI_COMM_WORLD, kMicroBatchCount, kLearningRate, kMomentum);
+    else if (kOptimType == kUseDecay)
+      optimizer = nnet::MPIPipelineOptimizer::make<nnet::DecayOptimization>(
+              *stage_model, MPI_COMM_WORLD, kMicroBatchCount, kLearningRate, kDecayRate);
+    else if (kOptimType == kUseDecayMomentum)
+      optimizer = nnet::MPIPipelineOptimizer::make<nnet::DecayMomentumOptimization>(
+              *stage_model, MPI_COMM_WORLD, kMicroBatchCount, kLearningRate, kDecayRate,
+              kMomentum);
+    model = std::make_unique<nnet::MPIPipelineModel>(*stage_model, MPI_COMM_WORLD);
+  } else {
+    // auto model = nnet::MLPModel::randomReluSigmoid(topology);
+    auto mlp_model = nnet::MPIMLPModel::random(topology, af::ActivationFunctionType::leakyRelu);
+    // auto model = std::make_unique<nnet::MLPModel>();
+    // model->load("michal.nnet");
+    if (kOptimType == kUseSGD)
+      optimizer = nnet::MPIMLPOptimizer::make<nnet::SGDOptimization>(*mlp_model, kLearningRate);
+    else if (kOptimType == kUseMomentum)
+      optimizer = nnet::MPIMLPOptimizer::make<nnet::MomentumOptimization>(
+              *mlp_model, kLearningRate, kMomentum);
+    else if (kOptimType == kUseDecay)
+      optimizer = nnet::MPIMLPOptimizer::make<nnet::DecayOptimization>(*mlp_model, kLearningRate,
+                                                                       kDecayRate);
+    else if (kOptimType == kUseDecayMomentum)
+      optimizer = nnet::MPIMLPOptimizer::make<nnet::DecayMomentumOptimization>(
+              *mlp_model, kLearningRate, kDecayRate, kMomentum);
+    model = std::move(mlp_model);
+  }
   logger("[P" + std::to_string(rank) + "]: " + "Creating scheduler", tscl::Log::Debug);
 
 
-  MPIParallelScheduler::Builder scheduler_builder;
+  std::unique_ptr<OptimizationScheduler> scheduler;
+  if (kUsePipeline) {
+    // Only the first stage reads the job, the other ones pass an empty training set
+    scheduler = std::make_unique<MPIPipelineScheduler>(
+            makeTrainingJob(kBatchSize, *local_collection),
+            dynamic_cast<MPIPipelineOptimizer &>(*optimizer));
+  } else {
+    MPIParallelScheduler::Builder scheduler_builder;
 
-  assert(local_collection->getTargets().empty() == false);
-  scheduler_builder.setJob({static_cast<size_t>(kBatchSize / comm_size),
-                            local_collection->getTrainingSet().getTensors(),
-                            local_collection->getTargets()});
-  // Set the resources for the scheduler
-  scheduler_builder.setMaxThread(kMaxThread, kAllowMultipleThreadPerDevice);
-  scheduler_builder.setDevices(utils::cl_wrapper.getDevices());
+    assert(local_collection->getTargets().empty() == false);
+    scheduler_builder.setJob(
+            makeTrainingJob(static_cast<size_t>(kBatchSize / comm_size), *local_collection));
+    // Set the resources for the scheduler
+    scheduler_builder.setMaxThread(kMaxThread, kAllowMultipleThreadPerDevice);
+    scheduler_builder.setDevices(utils::cl_wrapper.getDevices());
 
-  scheduler_builder.setOptimizer(*optimizer);
+    scheduler_builder.setOptimizer(*optimizer);
 
-  auto scheduler = scheduler_builder.build();
+    scheduler = scheduler_builder.build();
+  }
   // SchedulerProfiler sc_profiler(scheduler_builder.build(), output_path / "scheduler");
   //  sc_profiler.setVerbose(false);
 
+  // The evaluation is distributed, only the root writes the results
+  // With a pipeline, every stage takes part in the forward passes of the evaluation
+  std::unique_ptr<ModelEvaluator> model_evaluator;
+  if (kUsePipeline) model_evaluator = std::make_unique<MPIPipelineEvaluator>(MPI_COMM_WORLD);
+  else
+    model_evaluator = std::make_unique<MPIModelEvaluator>(MPI_COMM_WORLD);
   ModelEvolutionTracker evaluator(output_path / ("model_evolution_" + std::to_string(rank)), *model,
-                                  *local_collection);
+                                  *local_collection, std::move(model_evaluator));
 
   logger("[P" + std::to_string(rank) + "]: Starting run", tscl::Log::Debug);
   MPITrainingController controller(kMaxEpoch, evaluator, *scheduler);
@@ -9,6 +9,8 @@
 
 #include "neuralNetwork/Perceptron/MLPModelSerializer.hpp"
 #include "neuralNetwork/Perceptron/MPIMLPModel.hpp"
+#include "neuralNetwork/Perceptron/MPIPipelineModel.hpp"
+#include "neuralNetwork/Perceptron/PipelinePartition.hpp"
 
 #include "neuralNetwork/Perceptron/ActivationFunction.hpp"
 
@@ -20,3 +22,9 @@
 
 // Optimizer
 #include "neuralNetwork/Perceptron/MPIMLPOptimizer.hpp"
+#include "neuralNetwork/Perceptron/MPIPipelineOptimizer.hpp"
+
+// CNN
+#include "neuralNetwork/CNN/CNNModel.hpp"
+#include "neuralNetwork/CNN/CNNOptimization/CNNSGDOptimization.hpp"
+#include "neuralNetwork/CNN/MPICNNOptimizer.hpp"
@@ -2,6 +2,8 @@
 #include "ControllerResult.hpp"
 #include "InputSet.hpp"
 #include "NeuralNetwork.hpp"
+#include "TiledInference.hpp"
+#include "image/Transform.hpp"
 
 namespace control {
 
@@ -23,6 +25,21 @@ namespace control {
      */
     ControllerResult run() noexcept;
 
+    /**
+     * @brief Runs the model on full-resolution images instead of the input set. Each image is
+     * split into overlapping tiles matching the input of the model, and the heatmap of the given
+     * output is saved as a PNG in the output path
+     *
+     * @param images The paths of the images to evaluate
+     * @param tiling The tiled inference to use, built on the same model
+     * @param class_index The output of the model reported in the heatmaps
+     * @param engine If not null, the transformations applied to each image before it is tiled
+     * @return
+     */
+    ControllerResult runTiled(const std::vector<std::filesystem::path> &images,
+                              const TiledInference &tiling, size_t class_index,
+                              const image::transform::TransformEngine *engine = nullptr) noexcept;
+
   private:
     std::filesystem::path output_path;
     nnet::Model *model;
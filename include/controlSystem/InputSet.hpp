@@ -1,6 +1,7 @@
 #pragma once
 #include "math/clFMatrix.hpp"
 #include "math/clFTensor.hpp"
+#include "math/clU8Tensor.hpp"
 #include <filesystem>
 #include <iostream>
 #include <utility>
@@ -41,6 +42,17 @@ namespace control {
     math::clFMatrix data;
   };
 
+  /**
+   * @brief How the samples of an InputSet are stored on the device
+   */
+  enum class InputStorage {
+    // Normalized floats, usable directly by the models
+    float32,
+    // Raw 8-bit pixels, using 4 times less memory. They are normalized when a batch is sliced,
+    // and the samples hold no float data
+    uint8
+  };
+
   /**
    * @brief Thread-safe set of samples that can be used to feed a neural network model
    * Note that the samples are grouped in Tensors of heterogeneous size, which can be used for
@@ -52,8 +64,9 @@ namespace control {
    */
   class InputSet final {
   public:
-    InputSet(size_t input_width, size_t input_height)
-        : input_width(input_width), input_height(input_height) {}
+    InputSet(size_t input_width, size_t input_height,
+             InputStorage storage = InputStorage::float32)
+        : input_width(input_width), input_height(input_height), storage(storage) {}
 
     InputSet(const InputSet &) = delete;
     InputSet &operator=(const InputSet &) = delete;
@@ -75,6 +88,12 @@ namespace control {
     void append(math::clFTensor &&tensor, const std::vector<size_t> &ids,
                 const std::vector<long> &class_ids = {});
 
+    /**
+     * @brief Append 8-bit samples to a set using the uint8 storage. See the other overload
+     */
+    void append(math::clU8Tensor &&tensor, const std::vector<size_t> &ids,
+                const std::vector<long> &class_ids = {});
+
     /**
      * @brief Alter the tensors size and reorder the samples (Maintaining the same ordering) to
      * match the new tensor size.
@@ -116,6 +135,7 @@ namespace control {
 
     size_t getInputWidth() const { return input_width; }
     size_t getInputHeight() const { return input_height; }
+    InputStorage getStorage() const { return storage; }
 
     Sample &operator[](size_t index) { return samples[index]; }
     const Sample &operator[](size_t index) const { return samples[index]; }
@@ -186,7 +206,40 @@ namespace control {
      */
     size_t getTensorCount() const {
       std::shared_lock<std::shared_mutex> lock(mutex);
-      return tensors.size();
+      return storage == InputStorage::uint8 ? byte_tensors.size() : tensors.size();
+    }
+
+    /**
+     * @brief Return the number of samples of the tensor at the given index, whatever the storage
+     */
+    size_t getTensorDepth(size_t index) const {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      return storage == InputStorage::uint8 ? byte_tensors.at(index).getDepth()
+                                            : tensors.at(index).getDepth();
+    }
+
+    /**
+     * @brief Return the samples of the tensor at the given index as floats, whatever the storage.
+     * Tensors stored as bytes are normalized into a new tensor, and the call blocks until they
+     * are, so that the result can be used on any queue
+     * @param index The index of the tensor
+     * @param queue The queue used to normalize the tensor
+     * @return The tensor itself if it is stored as floats, else a new tensor
+     */
+    math::clFTensor getFloatTensor(size_t index, cl::CommandQueue &queue) const;
+
+    /**
+     * @brief Return the tensors of a set using the uint8 storage
+     * @return
+     */
+    std::vector<math::clU8Tensor> &getByteTensors() {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      return byte_tensors;
+    }
+
+    const std::vector<math::clU8Tensor> &getByteTensors() const {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      return byte_tensors;
     }
 
     /**
@@ -331,8 +384,12 @@ namespace control {
     // which is really practical.
     std::vector<Sample> samples;
 
+    InputStorage storage = InputStorage::float32;
+
     // Store the tensor separately to avoid copying the data
+    // Only one of them is used, depending on the storage
     std::vector<math::clFTensor> tensors;
+    std::vector<math::clU8Tensor> byte_tensors;
     std::vector<std::string> class_names;
 
     mutable std::shared_mutex mutex;
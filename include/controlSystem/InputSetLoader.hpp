@@ -42,7 +42,62 @@ namespace control {
      */
     InputSet load(const std::filesystem::path &path, bool load_classes, bool shuffle_samples) const;
 
+    /**
+     * @brief Load a shard of a directory of images. The files are enumerated in a deterministic
+     * order, and the file with id i belongs to the shard i % shard_count. The ids are the same as
+     * the ones given by load(), so that multiple processes can each load their own shard
+     * @param path The path of the top directory to load
+     * @param load_classes If true, the classes will be loaded as well (See load())
+     * @param shuffle_samples If true, the samples of the shard are shuffled
+     * @param shard_index The index of the shard to load, in [0, shard_count)
+     * @param shard_count The total number of shards
+     * @return The loaded shard
+     */
+    InputSet loadShard(const std::filesystem::path &path, bool load_classes, bool shuffle_samples,
+                       size_t shard_index, size_t shard_count) const;
+
+    /**
+     * @brief Return the names of the classes found in a directory, in the order used by load()
+     * @param path The path of the top directory
+     * @return The sorted names of the classes
+     */
+    static std::vector<std::string> listClasses(const std::filesystem::path &path);
+
     size_t getTensorSize() const { return tensor_size; }
+
+    /**
+     * @brief Set the number of threads decoding and transforming the images while loading
+     * @param count The number of threads, or 0 to use one per hardware thread
+     */
+    void setThreadCount(size_t count) { n_thread = count; }
+    size_t getThreadCount() const { return n_thread; }
+
+    /**
+     * @brief Set the directory where the transformed images are cached. The first load of a set
+     * writes a cache file, which is memory-mapped by the next loads instead of decoding the
+     * images again. A cache is only reused if the files, the input size and the transformations
+     * are unchanged
+     * @param directory The cache directory, or an empty path to disable the cache
+     */
+    void setCacheDirectory(const std::filesystem::path &directory) { cache_directory = directory; }
+    const std::filesystem::path &getCacheDirectory() const { return cache_directory; }
+
+    /**
+     * @brief Set how the loaded samples are stored on the device. Sets using the uint8 storage
+     * use 4 times less memory, but can only be used for training
+     */
+    void setStorage(InputStorage new_storage) { storage = new_storage; }
+    InputStorage getStorage() const { return storage; }
+
+    /**
+     * @brief Set whether the images are resized and transformed on the device. The decoded images
+     * are then uploaded once with their original size, which frees the host threads for decoding.
+     * If a transformation cannot run on the device, the images are transformed on the host. The
+     * cache is not used when the images are transformed on the device
+     */
+    void setDevicePreprocessing(bool enable) { device_preprocessing = enable; }
+    bool getDevicePreprocessing() const { return device_preprocessing; }
+
     size_t getInputWidth() const { return input_width; }
     size_t getInputHeight() const { return input_height; }
 
@@ -58,11 +113,17 @@ namespace control {
     image::transform::TransformEngine &getPostProcessEngine() { return postprocess_engine; }
 
   private:
-    InputSet loadWithClasses(const std::filesystem::path &path, bool shuffle_samples) const;
-    InputSet loadWithoutClasses(const std::filesystem::path &path, bool shuffle_samples) const;
+    InputSet loadWithClasses(const std::filesystem::path &path, bool shuffle_samples,
+                             size_t shard_index, size_t shard_count) const;
+    InputSet loadWithoutClasses(const std::filesystem::path &path, bool shuffle_samples,
+                                size_t shard_index, size_t shard_count) const;
 
     image::transform::TransformEngine preprocess_engine, postprocess_engine;
     size_t tensor_size, input_width, input_height;
+    size_t n_thread = 0;
+    std::filesystem::path cache_directory;
+    InputStorage storage = InputStorage::float32;
+    bool device_preprocessing = false;
   };
 
 }   // namespace control
@@ -11,6 +11,7 @@
 #include "Model.hpp"
 #include "TrainingCollection.hpp"
 #include <fstream>
+#include <memory>
 
 namespace control {
 
@@ -46,6 +47,24 @@ namespace control {
      * @return
      */
     virtual ModelEvaluation evaluate(const nnet::Model &model, const InputSet &input) const;
+
+  protected:
+    /**
+     * @brief Runs the model on every sample of the input set
+     * @param model The model to evaluate
+     * @param input_set The input set to run the evaluation on
+     * @return A square matrix, where the element (i, j) is the number of samples of class j
+     * predicted as class i
+     */
+    static math::Matrix<size_t> computeConfusionMatrix(const nnet::Model &model,
+                                                       const InputSet &input_set);
+
+    /**
+     * @brief Computes the precision, recall and f1 score of each class from a confusion matrix
+     * @param confusion_matrix
+     * @return
+     */
+    static ModelEvaluation computeStatistics(const math::Matrix<size_t> &confusion_matrix);
   };
 
 
@@ -63,6 +82,15 @@ namespace control {
     ModelEvolutionTracker(std::filesystem::path output_path, nnet::Model &model,
                           const TrainingCollection &training_collection);
 
+    /**
+     * @brief Build a new tracker that uses a custom evaluator
+     * @param evaluator The evaluator to run after each epoch. If it returns an empty evaluation,
+     * nothing is written for this epoch
+     */
+    ModelEvolutionTracker(std::filesystem::path output_path, nnet::Model &model,
+                          const TrainingCollection &training_collection,
+                          std::unique_ptr<ModelEvaluator> evaluator);
+
     /**
      * @brief Evaluate a model on an input set, and return the evaluation
      * @param model The model to evaluate
@@ -84,7 +112,7 @@ namespace control {
 
     nnet::Model *model;
 
-    ModelEvaluator evaluator;
+    std::unique_ptr<ModelEvaluator> evaluator;
     std::filesystem::path output_path;
 
     const TrainingCollection *training_collection;
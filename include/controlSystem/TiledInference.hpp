@@ -0,0 +1,87 @@
+#pragma once
+#include "Image.hpp"
+#include "Model.hpp"
+#include "math/Matrix.hpp"
+#include <vector>
+
+namespace control {
+
+  /**
+   * @brief Runs a model on overlapping tiles of an image larger than the input of the model, and
+   * assembles the outputs into a heatmap of the image
+   *
+   * The image is uploaded once as bytes, by bands of rows on a dedicated queue, so that the first
+   * batches of tiles are computed while the rest of the image is uploaded. The tiles are then
+   * extracted and normalized on the device, one batch at a time: they are never stored on the
+   * host, and the next batch is extracted while the model runs on the current one.
+   */
+  class TiledInference {
+  public:
+    /**
+     * @brief Builds a tiled inference of tiles of the given size, matching the input of the model
+     * @param model The model to run. Must outlive this object
+     * @param stride_x The horizontal distance between two tiles. Tiles overlap if it is smaller
+     * than the tile width, and may not be larger, so that every pixel is covered
+     * @param stride_y The vertical distance between two tiles, at most the tile height
+     * @param batch_size The number of tiles fed to the model at once
+     */
+    TiledInference(const nnet::Model &model, size_t tile_width, size_t tile_height,
+                   size_t stride_x, size_t stride_y, size_t batch_size);
+
+    /**
+     * @brief Runs the model on every tile of an image
+     *
+     * Tiles are laid out every stride pixels, plus a last row and column of tiles aligned on the
+     * right and bottom borders, so that every pixel is covered.
+     *
+     * @param image The image to run the model on. Must be at least as large as a tile
+     * @param queue The queue used to extract the tiles and run the model
+     * @param factor The factor each pixel is divided by before being fed to the model
+     * @return A matrix of tile_count rows, holding the output of the model for each tile. Tiles
+     * are stored row by row
+     */
+    math::FloatMatrix predictTiles(const image::GrayscaleImage &image, cl::CommandQueue &queue,
+                                   float factor = 255.0f) const;
+
+    /**
+     * @brief Runs the model on every tile of an image, and returns a heatmap of the given output
+     * @param class_index The output of the model reported in the heatmap
+     * @return A matrix of image.getHeight() rows and image.getWidth() columns, where each pixel is
+     * the mean of the outputs of the tiles covering it
+     * @see predictTiles()
+     */
+    math::FloatMatrix predictHeatmap(const image::GrayscaleImage &image, size_t class_index,
+                                     cl::CommandQueue &queue, float factor = 255.0f) const;
+
+    /**
+     * @brief Returns the origins of the tiles along an axis of the given size. Throws if the tile
+     * size or the stride is null
+     */
+    [[nodiscard]] static std::vector<size_t> tileOrigins(size_t size, size_t tile, size_t stride);
+
+    /**
+     * @brief Averages the outputs of the tiles of an image into a heatmap. Throws if a stride is
+     * larger than the tile, since some pixels would not be covered
+     * @param scores A matrix holding the outputs of each tile, as returned by predictTiles()
+     * @param class_index The output of the model reported in the heatmap
+     * @return A matrix of height rows and width columns, where each pixel is the mean of the
+     * outputs of the tiles covering it
+     */
+    [[nodiscard]] static math::FloatMatrix averageTiles(const math::FloatMatrix &scores,
+                                                        size_t class_index, size_t width,
+                                                        size_t height, size_t tile_width,
+                                                        size_t tile_height, size_t stride_x,
+                                                        size_t stride_y);
+
+    [[nodiscard]] size_t getTileWidth() const { return tile_width; }
+    [[nodiscard]] size_t getTileHeight() const { return tile_height; }
+    [[nodiscard]] size_t getBatchSize() const { return batch_size; }
+
+  private:
+    const nnet::Model *model;
+    size_t tile_width, tile_height;
+    size_t stride_x, stride_y;
+    size_t batch_size;
+  };
+
+}   // namespace control
@@ -36,6 +36,27 @@ namespace control {
 
     size_t getInputHeight() const { return input_set_loader.getInputHeight(); }
 
+    /**
+     * @brief Set the directory where the transformed images are cached, see
+     * InputSetLoader::setCacheDirectory()
+     */
+    void setCacheDirectory(const std::filesystem::path &directory) {
+      input_set_loader.setCacheDirectory(directory);
+    }
+
+    /**
+     * @brief Set whether the images are transformed on the device, see
+     * InputSetLoader::setDevicePreprocessing()
+     */
+    void setDevicePreprocessing(bool enable) { input_set_loader.setDevicePreprocessing(enable); }
+
+    /**
+     * @brief Set how the training set is stored on the device. The evaluation set always uses
+     * floats
+     */
+    void setTrainingStorage(InputStorage storage) { training_storage = storage; }
+    InputStorage getTrainingStorage() const { return training_storage; }
+
     /**
      * @brief The preprocessing engine to apply to the images, before rescaling.
      * @return A reference to the preprocessing engine.
@@ -55,6 +76,7 @@ namespace control {
 
   private:
     InputSetLoader input_set_loader;
+    InputStorage training_storage = InputStorage::float32;
   };
 
 }   // namespace control
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Image.hpp"
+#include <memory>
+#include <vector>
+
+namespace image {
+
+  /** @brief Stores images of the same size contiguously, in the layout of a tensor
+   *
+   * Image i starts at getData() + i * getImageSize(), so the whole batch can be transformed in long
+   * contiguous sweeps and uploaded to the device with a single write. A batch either owns its
+   * pixels, or is a view over pixels owned by someone else, such as a mapped staging buffer.
+   */
+  class ImageBatch {
+  public:
+    ImageBatch() = default;
+
+    /**
+     * @brief Builds a batch of count black images
+     */
+    ImageBatch(size_t width, size_t height, size_t count);
+
+    /**
+     * @brief Builds a batch viewing the given pixels. The pixels must outlive the batch
+     */
+    static ImageBatch view(grayscale_t *data, size_t width, size_t height, size_t count);
+
+    ImageBatch(const ImageBatch &other) = delete;
+    ImageBatch &operator=(const ImageBatch &other) = delete;
+
+    ImageBatch(ImageBatch &&other) noexcept { *this = std::move(other); }
+    ImageBatch &operator=(ImageBatch &&other) noexcept;
+
+    [[nodiscard]] size_t getWidth() const { return width; }
+    [[nodiscard]] size_t getHeight() const { return height; }
+    [[nodiscard]] size_t getCount() const { return count; }
+    [[nodiscard]] bool isView() const { return not storage; }
+
+    /**
+     * @brief Returns the number of pixels of each image
+     */
+    [[nodiscard]] size_t getImageSize() const { return width * height; }
+
+    /**
+     * @brief Returns the number of pixels of the whole batch
+     */
+    [[nodiscard]] size_t getSize() const { return width * height * count; }
+
+    [[nodiscard]] grayscale_t *getData() { return data; }
+    [[nodiscard]] const grayscale_t *getData() const { return data; }
+
+    /**
+     * @brief Returns the first pixel of the i-th image. Throws on out of bound access
+     */
+    [[nodiscard]] grayscale_t *getImage(size_t i);
+    [[nodiscard]] const grayscale_t *getImage(size_t i) const;
+
+    /**
+     * @brief Returns a copy of the i-th image
+     */
+    [[nodiscard]] GrayscaleImage getImageCopy(size_t i) const;
+
+    /**
+     * @brief Copies an image to the i-th slot of the batch. Throws if the image does not have the
+     * size of the batch
+     */
+    void setImage(size_t i, const GrayscaleImage &image);
+
+    /**
+     * @brief Returns the histogram of the i-th image, in the format of
+     * GrayscaleImage::createRatioHistogram()
+     */
+    [[nodiscard]] std::vector<double> createRatioHistogram(size_t i) const;
+
+    [[nodiscard]] grayscale_t *begin() { return data; }
+    [[nodiscard]] const grayscale_t *begin() const { return data; }
+
+    [[nodiscard]] grayscale_t *end() { return data + getSize(); }
+    [[nodiscard]] const grayscale_t *end() const { return data + getSize(); }
+
+  private:
+    std::unique_ptr<grayscale_t[]> storage;
+    grayscale_t *data = nullptr;
+    size_t width = 0, height = 0, count = 0;
+  };
+
+}   // namespace image
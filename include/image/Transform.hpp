@@ -1,6 +1,11 @@
 #pragma once
 
 #include "Image.hpp"
+#include "ImageBatch.hpp"
+#include <array>
+#include <string>
+#include <typeinfo>
+#include <vector>
 
 namespace image::transform {
 
@@ -24,6 +29,55 @@ namespace image::transform {
   public:
     virtual ~Transformation() = default;
     virtual bool transform(image::GrayscaleImage &image) const = 0;
+
+    /**
+     * @brief Transforms every image of a batch. The transformation must keep the size of the
+     * images. By default, the images are transformed one by one
+     */
+    virtual bool transformBatch(image::ImageBatch &batch) const;
+
+    /**
+     * @brief Returns a string identifying the transformation and its parameters, so that two
+     * transformations with the same identifier give the same results
+     */
+    [[nodiscard]] virtual std::string getIdentifier() const { return typeid(*this).name(); }
+  };
+
+  /**
+   * @brief Maps each gray level to a new one
+   */
+  using LookupTable = std::array<grayscale_t, nb_colors>;
+
+  /** @brief Interface for transformations that map each pixel independently of its neighbours
+   *
+   * Such transformations are described by a lookup table, so that the TransformEngine can compose
+   * consecutive ones and apply them in a single pass over the image.
+   */
+  class PointwiseTransformation : public Transformation {
+  public:
+    /**
+     * @brief Builds the lookup table for the image, and applies it
+     */
+    bool transform(image::GrayscaleImage &image) const override;
+
+    /**
+     * @brief Applies the same lookup table to the whole batch in a single sweep, unless the table
+     * depends on the histogram of each image
+     */
+    bool transformBatch(image::ImageBatch &batch) const override;
+
+    /**
+     * @brief Returns the lookup table of this transformation
+     * @param ratio_histogram The ratio histogram of the image the table is applied to. Empty if
+     * needsHistogram() returns false
+     */
+    [[nodiscard]] virtual LookupTable
+    getLookupTable(const std::vector<double> &ratio_histogram) const = 0;
+
+    /**
+     * @brief Returns true if the lookup table depends on the histogram of the image
+     */
+    [[nodiscard]] virtual bool needsHistogram() const { return false; }
   };
 
   /** @brief Resizing transformation for GrayscaleImage
@@ -42,6 +96,7 @@ namespace image::transform {
      */
     Resize(size_t width, size_t height);
     bool transform(image::GrayscaleImage &image) const override;
+    [[nodiscard]] std::string getIdentifier() const override;
   };
 
   /** @brief Produces a view of a GrayscaleImage
@@ -63,13 +118,14 @@ namespace image::transform {
      */
     Crop(size_t width, size_t height, size_t orig_x = 0, size_t orig_y = 0);
     bool transform(image::GrayscaleImage &image) const override;
+    [[nodiscard]] std::string getIdentifier() const override;
   };
 
 
   /** @brief Restriction transformation for GrayscaleImage
    *
    */
-  class Restriction : public Transformation {
+  class Restriction : public PointwiseTransformation {
   private:
     size_t desired_step;
 
@@ -81,20 +137,25 @@ namespace image::transform {
      * @param desired_step 1 by default, step between two colors.
      */
     Restriction(size_t desired_step = 1);
-    bool transform(image::GrayscaleImage &image) const override;
+    [[nodiscard]] LookupTable
+    getLookupTable(const std::vector<double> &ratio_histogram) const override;
+    [[nodiscard]] std::string getIdentifier() const override;
   };
 
   /**
    * @brief Equalize the given image colors repartition. (A half-white & half-black image turns into
    * a full-gray image)
    */
-  class Equalize : public Transformation {
+  class Equalize : public PointwiseTransformation {
   public:
-    bool transform(image::GrayscaleImage &image) const override;
+    [[nodiscard]] LookupTable
+    getLookupTable(const std::vector<double> &ratio_histogram) const override;
+    [[nodiscard]] bool needsHistogram() const override { return true; }
   };
 
   /**
-   * @brief Apply a Gaussian blur on the given image.
+   * @brief Apply a Gaussian blur on the given image. The blur is applied as two separable passes,
+   * and the border pixels are replicated outside the image.
    */
   class Filter : public Transformation {
   public:
@@ -114,25 +175,29 @@ namespace image::transform {
   /**
    * @brief Turns the given image in black & white. Based on the mean image color.
    */
-  class BinaryScale : public Transformation {
+  class BinaryScale : public PointwiseTransformation {
   public:
-    bool transform(image::GrayscaleImage &image) const override;
+    [[nodiscard]] LookupTable
+    getLookupTable(const std::vector<double> &ratio_histogram) const override;
   };
 
   /**
    * @brief Turns the given image in black & white. Based on the median image color.
    */
-  class BinaryScaleByMedian : public Transformation {
+  class BinaryScaleByMedian : public PointwiseTransformation {
   public:
-    bool transform(image::GrayscaleImage &image) const override;
+    [[nodiscard]] LookupTable
+    getLookupTable(const std::vector<double> &ratio_histogram) const override;
+    [[nodiscard]] bool needsHistogram() const override { return true; }
   };
 
   /**
    * @brief Inverts colors for the given image. White turns into black, etc.
    */
-  class Inversion : public Transformation {
+  class Inversion : public PointwiseTransformation {
   public:
-    bool transform(image::GrayscaleImage &image) const override;
+    [[nodiscard]] LookupTable
+    getLookupTable(const std::vector<double> &ratio_histogram) const override;
   };
 
   /** @brief Pipeline for applying transformations on GrayscaleImage
@@ -169,10 +234,32 @@ namespace image::transform {
     /**
      * @param image  Apply every transformation in-place
      * @brief Apply all transformations of the transformation list for the
-     * given image
+     * given image. Consecutive pointwise transformations are composed into a single lookup table,
+     * and applied in one pass
      */
     void apply(image::GrayscaleImage &image) const;
 
+    /**
+     * @brief Apply all transformations of the transformation list to every image of a batch,
+     * in-place. The transformations must keep the size of the images. Runs of pointwise
+     * transformations are applied in one sweep over the whole batch
+     */
+    void apply(image::ImageBatch &batch) const;
+
+    /**
+     * @brief Returns true if every transformation of the list is pointwise
+     */
+    [[nodiscard]] bool isPointwise() const;
+
+    /**
+     * @brief Returns the identifiers of the transformations of the list, in order
+     */
+    [[nodiscard]] std::string getIdentifier() const;
+
+    [[nodiscard]] const std::vector<std::shared_ptr<Transformation>> &getTransformations() const {
+      return transformations;
+    }
+
   private:
     // Keeping the transformations identifiers for I/O easily.
     std::vector<TransformType> transformationsEnums;
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Image.hpp"
+#include "Transform.hpp"
+#include "math/clFTensor.hpp"
+#include "math/clU8Tensor.hpp"
+#include <memory>
+#include <vector>
+
+namespace image::transform {
+
+  /** @brief Transforms batches of images on the device
+   *
+   * The images are uploaded once as bytes, with their original size. They are then cropped,
+   * resized, transformed by a list of pointwise transformations and normalized on the device.
+   * When no transformation depends on the histogram of the images, this is done in a single kernel
+   * launch.
+   *
+   * The resizing averages the covered area on reductions and interpolates linearly on
+   * enlargements, as Resize does. Results may differ from the ones of Resize by one gray level,
+   * since the device does not use fixed-point weights.
+   *
+   * Large batches are split into packs of at most a few hundred megabytes, which also fit in the
+   * maximum allocation size of the device.
+   */
+  class clTransformEngine {
+  public:
+    /**
+     * @brief Builds an engine resizing the images to the given dimensions
+     */
+    clTransformEngine(size_t width, size_t height);
+
+    /**
+     * @brief Crops the images before resizing them. The region must fit in every image
+     * @param orig_x column origin index (0 is left border)
+     * @param orig_y row origin index (0 is top border)
+     */
+    void setCrop(size_t crop_width, size_t crop_height, size_t orig_x = 0, size_t orig_y = 0);
+
+    /**
+     * @brief Add a pointwise transformation, applied after the resizing and the previous
+     * transformations
+     */
+    void addTransformation(std::shared_ptr<PointwiseTransformation> transformation);
+
+    /**
+     * @brief Add every transformation of an engine, in order. Throws if the engine is not
+     * supported, see supports()
+     */
+    void addTransformations(const TransformEngine &engine);
+
+    /**
+     * @brief Returns true if every transformation of an engine can run on the device. This is the
+     * case of the pointwise transformations that do not depend on the histogram of the image, and
+     * of Equalize and BinaryScaleByMedian
+     */
+    static bool supports(const TransformEngine &engine);
+
+    /**
+     * @brief Transforms a batch of images, and normalizes them by a given factor
+     * @param images The images to transform. The images can have different sizes
+     * @param queue The queue used for the upload and the transformation
+     * @param factor The factor each pixel is divided by
+     * @return A tensor of depth images.size(), holding the transformed images
+     */
+    math::clFTensor transform(const std::vector<GrayscaleImage> &images, cl::CommandQueue &queue,
+                              float factor = 255.0f) const;
+
+    /**
+     * @brief Transforms a batch of images, keeping the transformed pixels as bytes
+     * @see transform()
+     */
+    math::clU8Tensor transformToBytes(const std::vector<GrayscaleImage> &images,
+                                      cl::CommandQueue &queue) const;
+
+    /**
+     * @brief Transforms a batch of images into an existing tensor, such as the slice of a larger
+     * tensor
+     * @param output A tensor of depth images.size(), whose matrices have the output dimensions
+     * @see transform()
+     */
+    void transform(const std::vector<GrayscaleImage> &images, math::clFTensor &output,
+                   cl::CommandQueue &queue, float factor = 255.0f) const;
+
+    /**
+     * @brief Same as transform(), but keeps the transformed pixels as bytes
+     */
+    void transformToBytes(const std::vector<GrayscaleImage> &images, math::clU8Tensor &output,
+                          cl::CommandQueue &queue) const;
+
+    [[nodiscard]] size_t getWidth() const { return width; }
+    [[nodiscard]] size_t getHeight() const { return height; }
+
+  private:
+    template<class Tensor>
+    void transformImpl(const std::vector<GrayscaleImage> &images, Tensor &output,
+                       cl::CommandQueue &queue, float factor) const;
+
+    /**
+     * @brief Transforms the images [first, first + res.getDepth()[ with a single upload
+     */
+    template<class Tensor>
+    void transformPack(const std::vector<GrayscaleImage> &images, size_t first, Tensor &res,
+                       cl::CommandQueue &queue, float factor) const;
+
+    size_t width, height;
+    bool crop = false;
+    size_t crop_width = 0, crop_height = 0, orig_x = 0, orig_y = 0;
+    std::vector<std::shared_ptr<PointwiseTransformation>> transformations;
+  };
+
+}   // namespace image::transform
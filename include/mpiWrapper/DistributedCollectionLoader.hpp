@@ -0,0 +1,66 @@
+#pragma once
+#include "InputSetLoader.hpp"
+#include "TrainingCollection.hpp"
+#include <filesystem>
+#include <mpi.h>
+
+namespace mpiw {
+
+  /**
+   * @brief Loads a training collection over multiple processes. Each process enumerates the
+   * dataset and loads its own shard of the training set, so no image is ever sent between
+   * processes.
+   */
+  class DistributedCollectionLoader {
+  public:
+    /**
+     * @brief How the evaluation set is loaded: not at all, entirely, or sharded like the training
+     * set. A sharded evaluation set must be evaluated with a MPIModelEvaluator
+     */
+    enum class EvalSetMode { none, full, shard };
+
+    /**
+     * @brief Builds a loader on the given communicator
+     * @param comm The communicator whose processes share the training set
+     * @param tensor_size The depth of the tensors to store images in
+     * @param input_width The width of the images, rescaling as needed
+     * @param input_height The height of the images, rescaling as needed
+     */
+    DistributedCollectionLoader(MPI_Comm comm, size_t tensor_size, size_t input_width,
+                                size_t input_height);
+
+    /**
+     * @brief Loads the local shard of a training collection. This method is collective over the
+     * communicator, and every process must see the same directory.
+     * The sample with id i of the training set is loaded by the process of rank i % size.
+     * If the loading fails on any process, every process throws.
+     * @param path The path to the directory, following the convention of training directories
+     * @param eval_mode How the evaluation set is loaded by this process
+     * @return The collection containing the local shard of the training set
+     */
+    control::TrainingCollection load(const std::filesystem::path &path,
+                                     EvalSetMode eval_mode) const;
+
+    /**
+     * @brief The preprocessing engine to apply to the images, before rescaling.
+     * @return A reference to the preprocessing engine.
+     */
+    image::transform::TransformEngine &getPreProcessEngine() {
+      return input_set_loader.getPreProcessEngine();
+    }
+
+    /**
+     * @brief The postprocessing engine to apply to the images, after rescaling.
+     * @return A reference to the postprocessing engine.
+     */
+    image::transform::TransformEngine &getPostProcessEngine() {
+      return input_set_loader.getPostProcessEngine();
+    }
+
+  private:
+    int rank, size;
+    MPI_Comm comm;
+    control::InputSetLoader input_set_loader;
+  };
+
+}   // namespace mpiw
@@ -0,0 +1,34 @@
+#pragma once
+#include "ModelEvaluator.hpp"
+#include <mpi.h>
+
+namespace control {
+
+  /**
+   * @brief Evaluates a model over multiple processes. Each process holds a distinct shard of the
+   * input set, and only runs the model on its own shard. The confusion matrices are then summed on
+   * the 0-th process of the communicator, which computes the statistics
+   */
+  class MPIModelEvaluator : public ModelEvaluator {
+  public:
+    /**
+     * @brief Builds an evaluator on the given communicator
+     * @param comm The communicator whose processes share the input set
+     */
+    explicit MPIModelEvaluator(MPI_Comm comm);
+
+    /**
+     * @note This method is collective over the communicator
+     * @brief Evaluate a model on the local shard of an input set
+     * @param model The model to evaluate, which must be the same on every process
+     * @param input_set The local shard of the input set
+     * @return The evaluation of the whole input set on the 0-th process, an empty evaluation on
+     * every other process
+     */
+    ModelEvaluation evaluate(const nnet::Model &model, const InputSet &input_set) const override;
+
+  private:
+    MPI_Comm comm;
+  };
+
+}   // namespace control
@@ -0,0 +1,33 @@
+#pragma once
+#include "ModelEvaluator.hpp"
+#include <mpi.h>
+
+namespace control {
+
+  /**
+   * @brief Evaluates a MPIPipelineModel. Only the first stage holds the input set: the other stages
+   * only take part in the forward passes, so every process runs the model the same number of times
+   */
+  class MPIPipelineEvaluator : public ModelEvaluator {
+  public:
+    /**
+     * @brief Builds an evaluator on the given communicator
+     * @param comm The communicator whose processes hold the stages of the model
+     */
+    explicit MPIPipelineEvaluator(MPI_Comm comm);
+
+    /**
+     * @note This method is collective over the communicator
+     * @brief Evaluate a pipelined model on an input set
+     * @param model The model to evaluate, whose predictions are collective over the communicator
+     * @param input_set The input set. Only read by the 0-th process, the other processes may pass
+     * an empty set
+     * @return The evaluation on the 0-th process, an empty evaluation on every other process
+     */
+    ModelEvaluation evaluate(const nnet::Model &model, const InputSet &input_set) const override;
+
+  private:
+    MPI_Comm comm;
+  };
+
+}   // namespace control
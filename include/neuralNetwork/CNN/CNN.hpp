@@ -81,9 +81,11 @@ namespace nnet {
    * @param tensor Tensor to reorganize
    * @param nInput Number of input
    * @param nBranch Number of branch
+   * @param buffer Tensor the reorganized output is written to, only reallocated if its size
+   * changes. The tensor may end up as a view of it
    */
   void reorganizeForward(cl::CommandQueue &queue, math::clFTensor &tensor, const size_t nInput,
-                         const size_t nBranch);
+                         const size_t nBranch, math::clFTensor &buffer);
 
   /**
    * @brief Reorganize the output tensor of MLP for CNN
@@ -93,8 +95,11 @@ namespace nnet {
    * @param nInput Number of input
    * @param nBranch Number of branch
    * @param size Size of one output of CNN
+   * @param buffer Tensor the reorganized errors are written to, only reallocated if its size
+   * changes. The tensor may end up as a view of it
    */
   void reorganizeBackward(cl::CommandQueue &queue, math::clFTensor &tensor, const size_t nInput,
-                          const size_t nBranch, const std::pair<size_t, size_t> size);
+                          const size_t nBranch, const std::pair<size_t, size_t> size,
+                          math::clFTensor &buffer);
 
 }   // namespace nnet
\ No newline at end of file
@@ -13,6 +13,12 @@ namespace nnet {
   enum class LayerType { CONVOLUTION, POOLING };
   enum class PoolingType { MAX, AVERAGE };
 
+  /**
+   * @brief The method used to compute a convolution. By default, the method is chosen from the
+   * size of the input and of the filters
+   */
+  enum class ConvolutionAlgorithm { automatic, gemm, winograd, direct };
+
   /**
    * @brief Base class of cnn layer
    */
@@ -85,6 +91,8 @@ namespace nnet {
     const std::pair<size_t, size_t> outputSize;
   };
 
+  class CNNPoolingLayer;
+
   /**
    * @brief Implementation of convolutional layer
    */
@@ -93,7 +101,9 @@ namespace nnet {
     // nFilter nombre de kernel par branche
     CNNConvolutionLayer(const std::pair<size_t, size_t> outputSize,
                         const std::pair<size_t, size_t> sizeFilter, const size_t nFilter,
-                        const af::ActivationFunctionType aFunction, const size_t nBranch);
+                        const af::ActivationFunctionType aFunction, const size_t nBranch,
+                        const std::pair<size_t, size_t> stride = {1, 1},
+                        const std::pair<size_t, size_t> padding = {0, 0});
 
     CNNConvolutionLayer(const CNNConvolutionLayer &other);
     ~CNNConvolutionLayer() override = default;
@@ -127,6 +137,17 @@ namespace nnet {
     [[nodiscard]] const math::clFTensor &getFilter() const { return filters; }
     [[nodiscard]] math::clFTensor &getFilter() { return filters; }
 
+    [[nodiscard]] const std::pair<size_t, size_t> &getStride() const { return stride; }
+    [[nodiscard]] const std::pair<size_t, size_t> &getPadding() const { return padding; }
+
+    /**
+     * @brief Forces the method used to compute the convolution. Throws if the layer does not
+     * support this method
+     * @param algo The method to use, or automatic to choose it from the sizes of the layer
+     */
+    void setAlgorithm(ConvolutionAlgorithm algo);
+    [[nodiscard]] ConvolutionAlgorithm getAlgorithm() const { return algorithm; }
+
     /**
      * @brief Compute layer operation for prediction of cnn
      * @param queue Queue used to make the computation
@@ -135,6 +156,23 @@ namespace nnet {
      */
     math::clFTensor compute(cl::CommandQueue &queue, const math::clFTensor &input) override;
 
+    /**
+     * @brief Returns true if this layer and the given pooling layer can be computed by
+     * computeFused()
+     */
+    [[nodiscard]] bool supportsFusion(const CNNPoolingLayer &pooling) const;
+
+    /**
+     * @brief Computes this layer followed by a pooling layer in a single kernel, for prediction.
+     * The output of the convolution is never written to global memory
+     * @param queue Queue used to make the computation
+     * @param input Input tensor
+     * @param pooling The pooling layer following this layer
+     * @return The output of the pooling layer
+     */
+    math::clFTensor computeFused(cl::CommandQueue &queue, const math::clFTensor &input,
+                                 const CNNPoolingLayer &pooling) const;
+
     /**
      * @brief Compute layer operation for forward of cnn
      * @param queue Queue used to make the computations
@@ -157,31 +195,63 @@ namespace nnet {
 
   private:
     /**
-     * @brief Compute the error on filter
+     * @brief Returns true if the layer can use the Winograd F(2x2, 3x3) algorithm, which is the
+     * case of the 3x3 filters with a stride of 1
+     */
+    [[nodiscard]] bool supportsWinograd() const;
+
+    /**
+     * @brief Returns true if the filters and the input tiles of the layer fit in the local memory
+     * used by the direct convolution kernels
+     */
+    [[nodiscard]] bool supportsDirect() const;
+
+    /**
+     * @brief Returns the method used to convolve the given input. Small inputs use the direct
+     * kernels, then 3x3 stride 1 layers use Winograd, and the other layers im2col and GEMM
+     */
+    [[nodiscard]] ConvolutionAlgorithm selectAlgorithm(const math::clFTensor &input) const;
+
+    /**
+     * @brief Convolve every branch of the input with its filters, and apply the activation
+     * function
      * @param queue Queue used to make the computations
      * @param input Input tensor
+     * @param workspace Receives the output, and the im2col matrices when they are built
+     * @return A shallow copy of the output of the workspace
+     */
+    math::clFTensor convolve(cl::CommandQueue &queue, const math::clFTensor &input,
+                             CNNStorageBPConvolution &workspace);
+
+    /**
+     * @brief Compute the error on filter, averaged over the inputs of each branch, into the
+     * error_filter of the storage
+     * @param queue Queue used to make the computations
+     * @param input Error tensor
      * @param storage Backpack with data to learn
-     * @return Error Tensor of filter
      */
-    math::clFTensor computeErrorFilter(cl::CommandQueue &queue, const math::clFTensor &input,
-                                       CNNStorageBPConvolution &storage);
+    void computeErrorFilter(cl::CommandQueue &queue, const math::clFTensor &input,
+                            CNNStorageBPConvolution &storage);
 
     /**
-     * @brief Compute the error on input
+     * @brief Compute the error on input, summed over the filters and averaged over the inputs of
+     * each branch, into the error_input of the storage
      * @param queue Queue used to make the computations
      * @param input Input tensor
      * @param storage Backpack with data to learn
-     * @return Error Tensor of input
      */
-    math::clFTensor computeErrorInput(cl::CommandQueue &queue, const math::clFTensor &input,
-                                      CNNStorageBPConvolution &storage);
+    void computeErrorInput(cl::CommandQueue &queue, const math::clFTensor &input,
+                           CNNStorageBPConvolution &storage);
 
   private:
     const size_t n_branch;
     const size_t n_filter;
+    const std::pair<size_t, size_t> stride;
+    const std::pair<size_t, size_t> padding;
 
     math::clFTensor filters;
     af::ActivationFunctionType a_function;
+    ConvolutionAlgorithm algorithm = ConvolutionAlgorithm::automatic;
   };
 
 
@@ -191,11 +261,20 @@ namespace nnet {
   class CNNPoolingLayer : public CNNLayer {
   public:
     CNNPoolingLayer(const std::pair<size_t, size_t> outputSize,
-                    const std::pair<size_t, size_t> PoolSize);
+                    const std::pair<size_t, size_t> PoolSize,
+                    const std::pair<size_t, size_t> stride,
+                    const std::pair<size_t, size_t> padding);
     ~CNNPoolingLayer() override = default;
 
+    [[nodiscard]] virtual PoolingType getPoolingType() const = 0;
+    [[nodiscard]] const std::pair<size_t, size_t> &getPoolingSize() const { return poolingSize; }
+    [[nodiscard]] const std::pair<size_t, size_t> &getStride() const { return stride; }
+    [[nodiscard]] const std::pair<size_t, size_t> &getPadding() const { return padding; }
+
   protected:
     const std::pair<size_t, size_t> poolingSize;
+    const std::pair<size_t, size_t> stride;
+    const std::pair<size_t, size_t> padding;
   };
 
   /**
@@ -204,10 +283,14 @@ namespace nnet {
   class CNNMaxPoolingLayer final : public CNNPoolingLayer {
   public:
     CNNMaxPoolingLayer(const std::pair<size_t, size_t> outputSize,
-                       const std::pair<size_t, size_t> PoolSize);
+                       const std::pair<size_t, size_t> PoolSize,
+                       const std::pair<size_t, size_t> stride = {1, 1},
+                       const std::pair<size_t, size_t> padding = {0, 0});
     CNNMaxPoolingLayer(const CNNMaxPoolingLayer &other);
     ~CNNMaxPoolingLayer() override = default;
 
+    [[nodiscard]] PoolingType getPoolingType() const override { return PoolingType::MAX; }
+
     /**
      * @brief copying a layer
      * @return the copied layer
@@ -241,6 +324,14 @@ namespace nnet {
      */
     math::clFTensor computeBackward(cl::CommandQueue &queue, const math::clFTensor &input,
                                     CNNStorageBP &storage) override;
+
+  private:
+    /**
+     * @brief Pools the input into the given tensor, which is only reallocated if its size differs
+     * from the output size. The index of each maximum is also written if indices is not null
+     */
+    void pool(cl::CommandQueue &queue, const math::clFTensor &input, math::clFTensor &res,
+              cl::Buffer *indices);
   };
 
   /**
@@ -249,10 +340,14 @@ namespace nnet {
   class CNNAvgPoolingLayer final : public CNNPoolingLayer {
   public:
     CNNAvgPoolingLayer(const std::pair<size_t, size_t> outputSize,
-                       const std::pair<size_t, size_t> PoolSize);
+                       const std::pair<size_t, size_t> PoolSize,
+                       const std::pair<size_t, size_t> stride = {1, 1},
+                       const std::pair<size_t, size_t> padding = {0, 0});
     CNNAvgPoolingLayer(const CNNAvgPoolingLayer &other);
     ~CNNAvgPoolingLayer() override = default;
 
+    [[nodiscard]] PoolingType getPoolingType() const override { return PoolingType::AVERAGE; }
+
     /**
      * @brief copying a layer
      * @return the copied layer
@@ -288,7 +383,11 @@ namespace nnet {
                                     CNNStorageBP &storage) override;
 
   private:
-    math::clFTensor filter;
+    /**
+     * @brief Average the input into the given tensor, which is only reallocated if its size
+     * differs from the output size
+     */
+    void pool(cl::CommandQueue &queue, const math::clFTensor &input, math::clFTensor &res);
   };
 
 }   // namespace nnet
\ No newline at end of file
@@ -24,10 +24,20 @@ namespace nnet {
       virtual ~WeightUpdateCache() = default;
 
       WeightUpdateCache(WeightUpdateCache &&other) noexcept = default;
+      WeightUpdateCache &operator=(WeightUpdateCache &&other) noexcept = default;
 
-      WeightUpdateCache(CNN *cnn, std::vector<math::clFTensor> &&weight_updates, size_t contribution);
+      WeightUpdateCache(CNNOptimizer &optimizer, std::vector<math::clFTensor> &&weight_updates,
+                        size_t contribution);
 
-      void add(size_t index, const math::clFTensor &delta, cl::CommandQueue &queue);
+      /**
+       * @brief Add the gradient of a layer to the cache
+       * @param index The index of the layer, among the layers that have weights
+       * @param delta The gradient, averaged over the batch
+       * @param contribution_size The size of the batch used to compute the gradient
+       * @param queue
+       */
+      void add(size_t index, const math::clFTensor &delta, size_t contribution_size,
+               cl::CommandQueue &queue);
 
       void reduce(WeightUpdateCache &other, cl::CommandQueue &queue);
 
@@ -35,8 +45,28 @@ namespace nnet {
 
       void increaseContribution(size_t contribution) { contributions += contribution; }
 
+      [[nodiscard]] size_t getContribution() const { return contributions; }
+      void setContribution(size_t contribution) { contributions = contribution; }
+
+      [[nodiscard]] std::vector<math::clFTensor> &getWeightUpdates() { return weight_updates; }
+      [[nodiscard]] const std::vector<math::clFTensor> &getWeightUpdates() const {
+        return weight_updates;
+      }
+
       std::vector<std::unique_ptr<CNNLayer>> &getLayers() { return layers_copy; }
 
+      /**
+       * @brief Returns the backprop storages of the layers, which are reused across batches so
+       * that their tensors are only allocated once
+       */
+      std::vector<std::unique_ptr<CNNStorageBP>> &getStorages() { return storages; }
+
+      /**
+       * @brief Returns the tensors the cnn outputs and the perceptron errors are reorganized into
+       */
+      math::clFTensor &getFlattenBuffer() { return flatten_buffer; }
+      math::clFTensor &getErrorBuffer() { return error_buffer; }
+
       void synchronizeLayers(cl::CommandQueue &queue);
 
       void clear(cl::CommandQueue &queue);
@@ -46,6 +76,9 @@ namespace nnet {
       size_t contributions;
       std::vector<math::clFTensor> weight_updates;
       std::vector<std::unique_ptr<CNNLayer>> layers_copy;
+      std::vector<std::unique_ptr<CNNStorageBP>> storages;
+      // Outputs of the reorganization between the cnn and the perceptron, reused across batches
+      math::clFTensor flatten_buffer, error_buffer;
 
     private:
       CNNOptimization *optimization;
@@ -54,7 +87,7 @@ namespace nnet {
     class Operation : public Optimizer::Operation {
     public:
       explicit Operation(CNNOptimizer &optimizer)
-          : mlp_operation(optimizer.mlp_optimizer.makeOperation()), optimizer(&optimizer) {}
+          : mlp_operation(optimizer.mlp_optimizer->makeOperation()), optimizer(&optimizer) {}
 
       void operator()(size_t thread_rank, const math::clFTensor &inputs,
                       const math::clFTensor &targets, cl::CommandQueue batch_queue) override {
@@ -76,9 +109,8 @@ namespace nnet {
       std::unique_ptr<MLPOptimizer::Operation> mlp_operation;
       CNNOptimizer *optimizer;
 
-    private:
       void reduceAll(cl::CommandQueue &queue) override {
-        for (auto &cache : caches) { cache->reduce(*caches[0], queue); }
+        for (size_t i = 1; i < caches.size(); i++) { caches[0]->reduce(*caches[i], queue); }
       }
 
       void applyChanges(cl::CommandQueue &queue) override {
@@ -93,7 +125,15 @@ namespace nnet {
     };
 
 
-    CNNOptimizer(CNNModel &model, std::unique_ptr<Optimization> mlp_optimization);
+    /**
+     * @brief Builds a new optimizer for the given model. Note that the model should remain valid
+     * for the lifetime of the optimizer.
+     * @param model The model to optimize
+     * @param mlp_optimization The optimization method used for the perceptron. Takes ownership
+     * @param cnn_optimization The optimization method used for the filters. Takes ownership
+     */
+    CNNOptimizer(CNNModel &model, std::unique_ptr<Optimization> mlp_optimization,
+                 std::unique_ptr<CNNOptimization> cnn_optimization);
 
     CNNOptimizer(const CNNOptimizer &other) = delete;
     CNNOptimizer(CNNOptimizer &&other) noexcept = default;
@@ -101,7 +141,10 @@ namespace nnet {
     CNNOptimizer &operator=(const CNNOptimizer &other) = delete;
     CNNOptimizer &operator=(CNNOptimizer &&other) noexcept = default;
 
-    void update() override { mlp_optimizer.update(); }
+    void update() override {
+      mlp_optimizer->update();
+      optimization->update();
+    }
 
     void optimize(const math::clFTensor &inputs, const math::clFTensor &targets,
                   WeightUpdateCache &cnn_cache, MLPOptimizer::WeightUpdateCache &mlp_cache,
@@ -112,11 +155,20 @@ namespace nnet {
     std::unique_ptr<WeightUpdateCache> makeCache();
     std::vector<std::unique_ptr<WeightUpdateCache>> makeCaches(size_t ncache);
 
-  private:
-    Operation *makeOperationImpl() override;
+    CNN *getCNN() { return cnn; }
+
+  protected:
+    /**
+     * @brief Used by the derived optimizers to provide their own perceptron optimizer
+     */
+    CNNOptimizer(CNNModel &model, std::unique_ptr<MLPOptimizer> mlp_optimizer,
+                 std::unique_ptr<CNNOptimization> cnn_optimization);
 
     CNN *cnn;
-    MLPOptimizer mlp_optimizer;
+    std::unique_ptr<MLPOptimizer> mlp_optimizer;
     std::unique_ptr<CNNOptimization> optimization;
+
+  private:
+    Operation *makeOperationImpl() override;
   };
 }   // namespace nnet
\ No newline at end of file
@@ -8,11 +8,21 @@
 
 namespace nnet {
 
+  /**
+   * @brief Holds the data a layer keeps between its forward and backward passes. A storage is
+   * reused across batches, so that its tensors are only allocated once in the steady state
+   */
   class CNNStorageBP {
   public:
     CNNStorageBP() = default;
     virtual ~CNNStorageBP() = default;
 
+    /**
+     * @brief Reallocates the tensor only if its size differs from the given one. Its content is
+     * left undefined
+     */
+    static void reserve(math::clFTensor &tensor, size_t rows, size_t cols, size_t depth);
+
     /**
      * @brief Check if storage have weight
      * @return true if layer have weight, otherwise false
@@ -34,6 +44,10 @@ namespace nnet {
     virtual const math::clFTensor &getGradient() const {
       throw std::runtime_error("CNNStorageBP: Tried to acces gradient in a storage without one");
     }
+
+    // Output of the forward pass and error on the input of the layer
+    math::clFTensor output;
+    math::clFTensor error_input;
   };
 
   class CNNStorageBPConvolution final : public CNNStorageBP {
@@ -56,7 +70,14 @@ namespace nnet {
     const math::clFTensor &getGradient() const override { return error_filter; }
 
     math::clFTensor input;
+    // The im2col matrices of the input, built by the forward pass and reused for the gradient
+    math::clFTensor input_col;
+    bool has_input_col = false;
     math::clFTensor error_filter;
+
+    math::clFTensor col_error;
+    // Transformed filters, inputs and outputs of the Winograd convolution
+    math::clFTensor winograd_filters, winograd_inputs, winograd_outputs;
   };
 
   class CNNStorageBPPooling : public CNNStorageBP {
@@ -72,8 +93,14 @@ namespace nnet {
     explicit CNNStorageBPMaxPooling(const std::pair<size_t, size_t> inputSize)
         : CNNStorageBPPooling(inputSize) {}
 
-    std::vector<math::Matrix<size_t>> max_rows;
-    std::vector<math::Matrix<size_t>> max_cols;
+    /**
+     * @brief Reallocates the indices buffer only if it cannot hold the given number of indices
+     */
+    void reserveIndices(size_t count);
+
+    // Index in its image of the maximum of each output pixel, written by the forward pass
+    cl::Buffer max_indices;
+    size_t max_indices_capacity = 0;
   };
 
   class CNNStorageBPAvgPooling final : public CNNStorageBPPooling {
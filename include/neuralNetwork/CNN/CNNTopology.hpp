@@ -78,10 +78,14 @@ namespace nnet {
      * @param filterSize Filter size
      * @param aFunction Activation function use in convolution
      * @param nbranch Number of branch
+     * @param stride Step between two positions of the filter
+     * @param padding Number of zeros added on each side of the input
      */
     void addConvolution(const std::pair<size_t, size_t> &inputSize, const size_t features,
                         const std::pair<size_t, size_t> &filterSize,
-                        const af::ActivationFunctionType aFunction, const size_t nbranch);
+                        const af::ActivationFunctionType aFunction, const size_t nbranch,
+                        const std::pair<size_t, size_t> &stride,
+                        const std::pair<size_t, size_t> &padding);
 
     /**
      * Add a pooling layer to topology
@@ -89,9 +93,13 @@ namespace nnet {
      * @param poolingType Type of pooling
      * @param poolSize Pooling size
      * @param nbranch Number of branch
+     * @param stride Step between two positions of the pooling window
+     * @param padding Number of values ignored by the pooling added on each side of the input
      */
     void addPooling(const std::pair<size_t, size_t> &inputSize, const PoolingType poolingType,
-                    const std::pair<size_t, size_t> &poolSize, const size_t nbranch);
+                    const std::pair<size_t, size_t> &poolSize, const size_t nbranch,
+                    const std::pair<size_t, size_t> &stride,
+                    const std::pair<size_t, size_t> &padding);
 
   private:
     std::pair<size_t, size_t> inputSize;
@@ -102,6 +110,9 @@ namespace nnet {
 
   /**
    * @brief Convert a string into topology
+   * The string starts with the input size and the activation function, followed by the layers:
+   * "convolution <features> <rows> <cols>" or "pooling <max|avg> <rows> <cols>". Each layer may be
+   * followed by "stride <rows> <cols>" and / or "padding <rows> <cols>", which default to 1 and 0
    * @param str String to convert
    * @return Topology generate with the string
    */
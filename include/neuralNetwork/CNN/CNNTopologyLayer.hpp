@@ -20,10 +20,14 @@ namespace nnet {
 
   public:
     CNNTopologyLayer(const std::pair<size_t, size_t> inputSize,
-                     const std::pair<size_t, size_t> filter, const size_t nbranch);
+                     const std::pair<size_t, size_t> filter, const size_t nbranch,
+                     const std::pair<size_t, size_t> stride = {1, 1},
+                     const std::pair<size_t, size_t> padding = {0, 0});
     ~CNNTopologyLayer() = default;
 
     [[nodiscard]] const std::pair<size_t, size_t> &getFilterSize() const { return filter_size; }
+    [[nodiscard]] const std::pair<size_t, size_t> &getStride() const { return stride; }
+    [[nodiscard]] const std::pair<size_t, size_t> &getPadding() const { return padding; }
     [[nodiscard]] virtual const size_t getFeatures() const { return 1; }
 
     /**
@@ -50,10 +54,21 @@ namespace nnet {
     computeOutputSize(const std::pair<size_t, size_t> &inputSize) const = 0;
     virtual std::ostream &printTo(std::ostream &) const = 0;
 
+    /**
+     * @brief Compute the output size of a window sliding over the input, using the stride and the
+     * padding of this layer. Throws if the window does not fit in the padded input
+     * @param inputSize Image size
+     * @return Size of output image
+     */
+    [[nodiscard]] const std::pair<size_t, size_t>
+    computeSlidingOutputSize(const std::pair<size_t, size_t> &inputSize) const;
+
   protected:
     const std::pair<size_t, size_t> input_size;
     const std::pair<size_t, size_t> filter_size;
     const size_t n_branch;
+    const std::pair<size_t, size_t> stride;
+    const std::pair<size_t, size_t> padding;
   };
 
   /**
@@ -63,7 +78,9 @@ namespace nnet {
   public:
     CNNTopologyLayerConvolution(const std::pair<size_t, size_t> inputSize, const size_t features,
                                 const std::pair<size_t, size_t> filter,
-                                const af::ActivationFunctionType aFunction, const size_t nBranch);
+                                const af::ActivationFunctionType aFunction, const size_t nBranch,
+                                const std::pair<size_t, size_t> stride = {1, 1},
+                                const std::pair<size_t, size_t> padding = {0, 0});
     ~CNNTopologyLayerConvolution() = default;
 
     [[nodiscard]] const size_t getFeatures() const override { return features; }
@@ -106,7 +123,9 @@ namespace nnet {
   class CNNTopologyLayerPooling : public CNNTopologyLayer {
   public:
     CNNTopologyLayerPooling(const std::pair<size_t, size_t> inputSize,
-                            const std::pair<size_t, size_t> filter, const size_t nBranch);
+                            const std::pair<size_t, size_t> filter, const size_t nBranch,
+                            const std::pair<size_t, size_t> stride = {1, 1},
+                            const std::pair<size_t, size_t> padding = {0, 0});
     ~CNNTopologyLayerPooling() = default;
 
 
@@ -134,7 +153,9 @@ namespace nnet {
   class CNNTopologyLayerMaxPooling final : public CNNTopologyLayerPooling {
   public:
     CNNTopologyLayerMaxPooling(const std::pair<size_t, size_t> inputSize,
-                               const std::pair<size_t, size_t> filter, const size_t nBranch);
+                               const std::pair<size_t, size_t> filter, const size_t nBranch,
+                               const std::pair<size_t, size_t> stride = {1, 1},
+                               const std::pair<size_t, size_t> padding = {0, 0});
     ~CNNTopologyLayerMaxPooling() = default;
 
     /**
@@ -160,7 +181,9 @@ namespace nnet {
   class CNNTopologyLayerAvgPooling final : public CNNTopologyLayerPooling {
   public:
     CNNTopologyLayerAvgPooling(const std::pair<size_t, size_t> inputSize,
-                               const std::pair<size_t, size_t> filter, const size_t nBranch);
+                               const std::pair<size_t, size_t> filter, const size_t nBranch,
+                               const std::pair<size_t, size_t> stride = {1, 1},
+                               const std::pair<size_t, size_t> padding = {0, 0});
     ~CNNTopologyLayerAvgPooling() = default;
 
     /**
@@ -1,27 +1,53 @@
 #pragma once
 
 #include "CNNOptimizer.hpp"
+#include "MPIOperation.hpp"
+#include "Perceptron/MPIMLPOptimizer.hpp"
+#include <mpi.h>
 
-class MPICNNOptimizer : public nnet::CNNOptimizer {
-public:
-  void reduceAll() override {
-    mpi_reduce_cache_cnn();
-    for () cache[0].reduce(caches);
-  }
-
-  void applyChanges() override {
-    for (auto &cache : caches) { cache.apply(); }
-    mlp_operation.updateModel();
-  }
-
-  void clearChanges() override;
-};
-
-std::unique_ptr<Optimizer::Operation> makeBatchOperation() override {
-  return std::make_unique<MPIMLPOperation>();
-}
-
-private:
-std::unique_ptr<nnet::MLPOptimizer> optimizer;
-}
-;
+namespace nnet {
+
+  /**
+   * @brief A CNNOptimizer that synchronizes the filters and the perceptron across MPI processes
+   * at each model update
+   */
+  class MPICNNOptimizer : public CNNOptimizer {
+  public:
+    class Operation;
+
+    /**
+     * @note This constructor is collective over MPI_COMM_WORLD: the model of the 0-th process is
+     * broadcast to every other process, so that all processes start from the same model
+     * @param model The model to optimize
+     * @param mlp_optimization The optimization method used for the perceptron. Takes ownership
+     * @param cnn_optimization The optimization method used for the filters. Takes ownership
+     */
+    MPICNNOptimizer(CNNModel &model, std::unique_ptr<Optimization> mlp_optimization,
+                    std::unique_ptr<CNNOptimization> cnn_optimization);
+
+  private:
+    CNNOptimizer::Operation *makeOperationImpl() override;
+  };
+
+  /**
+   * @brief The filters updates are summed on the 0-th process of the communicator, which applies
+   * them and broadcasts the new filters. The perceptron is handled by an MPIMLPOptimizer operation
+   * sharing the same communicator
+   */
+  class MPICNNOptimizer::Operation : public CNNOptimizer::Operation, public MPIOperation {
+  public:
+    explicit Operation(MPICNNOptimizer &optimizer);
+
+    void setCommunicator(MPI_Comm comm) override;
+
+    [[nodiscard]] MPI_Comm getCommunicator() const override { return current_comm; }
+
+  protected:
+    void reduceAll(cl::CommandQueue &queue) override;
+    void applyChanges(cl::CommandQueue &queue) override;
+
+  private:
+    MPI_Comm current_comm;
+  };
+
+}   // namespace nnet
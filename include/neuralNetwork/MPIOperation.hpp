@@ -0,0 +1,23 @@
+#pragma once
+
+#include <mpi.h>
+
+namespace nnet {
+
+  /**
+   * @brief Interface for the optimizer operations that synchronize their changes across MPI
+   * processes. Used by the MPI schedulers to choose which processes take part in a model update.
+   */
+  class MPIOperation {
+  public:
+    virtual ~MPIOperation() = default;
+
+    /**
+     * @brief Set the communicator used for the next model updates
+     * @param comm
+     */
+    virtual void setCommunicator(MPI_Comm comm) = 0;
+
+    [[nodiscard]] virtual MPI_Comm getCommunicator() const = 0;
+  };
+}   // namespace nnet
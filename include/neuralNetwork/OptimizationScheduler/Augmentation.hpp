@@ -0,0 +1,89 @@
+#pragma once
+#include "math/clFTensor.hpp"
+#include "math/clU8Tensor.hpp"
+#include <vector>
+
+namespace nnet {
+
+  /**
+   * @brief Randomly augments batches of images on the device, when they are fed to the network
+   *
+   * Each sample can be flipped, rotated by a multiple of 90°, translated by a few pixels and have
+   * its contrast and brightness jittered. The random values are drawn by a counter-based generator
+   * from the seed, the epoch and the identifier of the sample: at a given epoch, a sample is
+   * augmented the same way whatever its position in the set, even if the set is shuffled.
+   *
+   * Nothing is stored, every batch is augmented by a single kernel launch.
+   */
+  class Augmentation {
+  public:
+    /**
+     * @brief Builds an augmentation of images of the given size, that does nothing until an
+     * augmentation is enabled
+     * @param seed The seed of the random generator
+     */
+    Augmentation(size_t width, size_t height, unsigned long seed = 0);
+
+    /**
+     * @brief Enables random flips. Each enabled flip is applied to half of the samples
+     */
+    void setFlips(bool horizontal, bool vertical);
+
+    /**
+     * @brief Enables random rotations by 0, 90, 180 or 270°. Throws if the images are not square
+     */
+    void setRotations(bool enable);
+
+    /**
+     * @brief Enables random translations of at most the given number of pixels on each axis. The
+     * border of the image is replicated over the uncovered area
+     */
+    void setMaxTranslation(size_t pixels);
+
+    /**
+     * @brief Enables a random jitter of the intensity: each pixel value v becomes v * (1 + c) + b,
+     * with c drawn in [-contrast, contrast[ and b in [-brightness, brightness[
+     */
+    void setIntensityJitter(float contrast, float brightness);
+
+    /**
+     * @brief Returns true if no augmentation is enabled
+     */
+    [[nodiscard]] bool isIdentity() const;
+
+    /**
+     * @brief Augments a batch of samples
+     * @param inputs The samples, each of them holding width * height values
+     * @param sample_ids The identifier of each sample, such as the ids of the InputSet samples
+     * @param epoch The current epoch, so that the samples are augmented differently at each epoch
+     * @param queue The queue used for the augmentation
+     * @return A new tensor of the same dimensions
+     */
+    math::clFTensor apply(const math::clFTensor &inputs, const std::vector<size_t> &sample_ids,
+                          size_t epoch, cl::CommandQueue &queue) const;
+
+    /**
+     * @brief Augments a batch of samples stored as bytes, normalizing them by the given factor in
+     * the same kernel launch
+     * @see apply()
+     */
+    math::clFTensor apply(const math::clU8Tensor &inputs, const std::vector<size_t> &sample_ids,
+                          size_t epoch, cl::CommandQueue &queue, float factor = 255.0f) const;
+
+    [[nodiscard]] size_t getWidth() const { return width; }
+    [[nodiscard]] size_t getHeight() const { return height; }
+    [[nodiscard]] unsigned long getSeed() const { return seed; }
+
+  private:
+    template<class Tensor>
+    math::clFTensor applyImpl(const Tensor &inputs, const std::vector<size_t> &sample_ids,
+                              size_t epoch, cl::CommandQueue &queue, float factor) const;
+
+    size_t width, height;
+    unsigned long seed;
+    bool horizontal_flip = false, vertical_flip = false, rotation = false;
+    size_t max_translation = 0;
+    float contrast = 0.0f, brightness = 0.0f;
+  };
+
+}   // namespace nnet
@@ -1,5 +1,7 @@
 #pragma once
+#include "Augmentation.hpp"
 #include "math/clFTensor.hpp"
+#include "math/clU8Tensor.hpp"
 #include <vector>
 
 namespace nnet {
@@ -21,6 +23,26 @@ namespace nnet {
                   const std::vector<math::clFTensor> &targets, size_t tensor_index = 0,
                   size_t local_index = 0);
 
+    /**
+     * @brief Creates a location at the beginning of a batch whose inputs are stored as bytes
+     */
+    BatchLocation(const std::vector<math::clU8Tensor> &inputs,
+                  const std::vector<math::clFTensor> &targets, size_t tensor_index = 0,
+                  size_t local_index = 0);
+
+    /**
+     * @brief Augments the input slices
+     * @param new_augmentation The augmentation to apply, or nullptr to disable it
+     * @param new_sample_ids The id of each sample of the job, in the order of the tensors
+     * @param new_epoch The current epoch
+     */
+    void setAugmentation(const Augmentation *new_augmentation,
+                         const std::vector<size_t> *new_sample_ids, size_t new_epoch) {
+      augmentation = new_augmentation;
+      sample_ids = new_sample_ids;
+      epoch = new_epoch;
+    }
+
     /**
      * @brief Progresses the location by a number of elements
      * @param count
@@ -31,16 +53,17 @@ namespace nnet {
      * @brief Returns the number of remaining elements in the current tensors
      * @return
      */
-    size_t getBatchRemainder() const { return (*inputs)[tensor_index].getDepth() - local_index; }
+    size_t getBatchRemainder() const { return (*targets)[tensor_index].getDepth() - local_index; }
 
     /**
-     * @brief Returns a slice of the next input tensor
+     * @brief Returns a slice of the next input tensor. Inputs stored as bytes are normalized into
+     * a new tensor with a single kernel launch. If an augmentation is set, the slice is augmented
+     * into a new tensor, in the same kernel launch as the normalization
      * @param size The size of the slice. Cannot be larger than the number of remaining elements
+     * @param queue The queue used to normalize and augment the inputs
      * @return
      */
-    math::clFTensor getInputSlice(size_t size) const {
-      return (*inputs)[tensor_index].slice(local_index, local_index + size);
-    }
+    math::clFTensor getInputSlice(size_t size, cl::CommandQueue &queue) const;
 
     /**
      * @brief Returns a slice of the next target tensor
@@ -52,8 +75,17 @@ namespace nnet {
     }
 
   private:
-    const std::vector<math::clFTensor> *inputs, *targets;
+    /**
+     * @brief Returns the index of the current element in the whole job
+     */
+    size_t getGlobalIndex() const;
+
+    const std::vector<math::clFTensor> *inputs = nullptr, *targets = nullptr;
+    const std::vector<math::clU8Tensor> *byte_inputs = nullptr;
     size_t tensor_index, local_index;
+    const Augmentation *augmentation = nullptr;
+    const std::vector<size_t> *sample_ids = nullptr;
+    size_t epoch = 0;
   };
 
 }   // namespace nnet
@@ -1,7 +1,9 @@
 #pragma once
+#include "Augmentation.hpp"
 #include "OptimizationScheduler.hpp"
 #include "Optimizer.hpp"
 #include "math/clFTensor.hpp"
+#include "math/clU8Tensor.hpp"
 
 namespace nnet {
 
@@ -14,17 +16,46 @@ namespace nnet {
     BatchSchedulerJob(size_t batch_size, const std::vector<math::clFTensor> &inputs,
                       const std::vector<math::clFTensor> &targets);
 
+    /**
+     * @brief Builds a job whose inputs are stored as bytes, and normalized when a batch is sliced
+     */
+    BatchSchedulerJob(size_t batch_size, const std::vector<math::clU8Tensor> &inputs,
+                      const std::vector<math::clFTensor> &targets);
+
     size_t getBatchSize() const { return batch_size; }
     const std::vector<math::clFTensor> &getInputs() const { return *inputs; }
+    const std::vector<math::clU8Tensor> &getByteInputs() const { return *byte_inputs; }
     const std::vector<math::clFTensor> &getTargets() const { return *targets; }
 
-    bool isValid() const { return batch_size > 0 && inputs && targets; }
+    /**
+     * @brief Returns true if the inputs are stored as bytes, in which case only getByteInputs() is
+     * valid
+     */
+    bool hasByteInputs() const { return byte_inputs != nullptr; }
+
+    /**
+     * @brief Augments the inputs when the batches are sliced. The augmentation and the ids must
+     * outlive the job
+     * @param new_augmentation The augmentation to apply, or nullptr to disable it
+     * @param new_sample_ids The id of each sample, in the order of the tensors, such as
+     * InputSet::getSamplesIds(). They identify the samples for the random generator of the
+     * augmentation, so that it doesn't depend on the order of the samples
+     */
+    void setAugmentation(const Augmentation *new_augmentation,
+                         const std::vector<size_t> *new_sample_ids);
+    const Augmentation *getAugmentation() const { return augmentation; }
+    const std::vector<size_t> *getSampleIds() const { return sample_ids; }
+
+    bool isValid() const { return batch_size > 0 && (inputs || byte_inputs) && targets; }
     size_t getGlobalWorkSize() const;
 
   private:
     size_t batch_size = 0;
     const std::vector<math::clFTensor> *inputs = nullptr;
+    const std::vector<math::clU8Tensor> *byte_inputs = nullptr;
     const std::vector<math::clFTensor> *targets = nullptr;
+    const Augmentation *augmentation = nullptr;
+    const std::vector<size_t> *sample_ids = nullptr;
   };
 
   /**
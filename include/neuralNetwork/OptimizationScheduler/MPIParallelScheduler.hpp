@@ -8,22 +8,63 @@ namespace nnet {
 
   /**
    * @brief An MPI implementation of the ParallelScheduler
-   * Model is gather, averaged, and broadcast to all nodes for each epoch
+   * Model is gathered, averaged, and broadcast to all nodes after each batch. Every process takes
+   * part in every model update, using a single communicator for the lifetime of the scheduler.
+   *
+   * Each process measures its throughput during an epoch. Between epochs, samples are migrated
+   * from the slower processes to the faster ones, so that every process holds a share of the
+   * samples proportional to its throughput, and all processes finish each batch at the same time.
    */
   class MPIParallelScheduler : public ParallelScheduler {
   public:
     class Builder;
-    using ParallelScheduler::ParallelScheduler;
 
-    MPIParallelScheduler(const ParallelScheduler &other) = delete;
-    explicit MPIParallelScheduler(ParallelScheduler &&other)
-        : ParallelScheduler(std::move(other)) {}
+    /**
+     * @note This constructor is collective over MPI_COMM_WORLD
+     * @brief Build a scheduler from a ParallelScheduler. The scheduler keeps its own list of
+     * samples, which may differ from the job's after rebalancing
+     * @param other
+     */
+    explicit MPIParallelScheduler(ParallelScheduler &&other);
+
+    MPIParallelScheduler(const MPIParallelScheduler &other) = delete;
+    MPIParallelScheduler &operator=(const MPIParallelScheduler &other) = delete;
+
+    ~MPIParallelScheduler() override;
 
     /**
      * @brief Runs the optimizer for a single epoch with MPI synchronization. Batch displacement is
      * determined by the policy used during the construction of the ParallelScheduler.
      */
     void run() override;
+
+    /**
+     * @brief Enables or disables the migration of samples between epochs. Enabled by default
+     * @param enabled
+     */
+    void setRebalancing(bool enabled) { rebalancing = enabled; }
+
+    /**
+     * @brief Returns the number of samples currently held by this process
+     * @return
+     */
+    [[nodiscard]] size_t getLocalSampleCount() const { return getJob().getGlobalWorkSize(); }
+
+  protected:
+    void print(std::ostream &os) const override;
+
+  private:
+    /**
+     * @brief Migrate samples between processes according to their last measured throughput.
+     * Collective over the communicator
+     */
+    void rebalance();
+
+    MPI_Comm comm = MPI_COMM_NULL;
+    std::vector<math::clFTensor> local_inputs, local_targets;
+    // Number of samples computed per second during the last epoch
+    double throughput = 0;
+    bool rebalancing = true;
   };
 
   class MPIParallelScheduler::Builder : public ParallelScheduler::Builder {
@@ -32,4 +73,4 @@ namespace nnet {
 
     [[nodiscard]] std::unique_ptr<ParallelScheduler> build() const override;
   };
-}   // namespace nnet
\ No newline at end of file
+}   // namespace nnet
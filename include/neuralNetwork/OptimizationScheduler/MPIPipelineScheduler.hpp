@@ -0,0 +1,43 @@
+#pragma once
+#include "BatchOptimizationScheduler.hpp"
+#include "Perceptron/MPIPipelineOptimizer.hpp"
+#include <mpi.h>
+
+namespace nnet {
+
+  /**
+   * @brief A scheduler for pipeline parallelism, running a MPIPipelineOptimizer on every process of
+   * its communicator. Only the first stage holds the training set: it decides the batches, and the
+   * other stages follow. The model is updated after each batch.
+   *
+   * Batches do not span multiple tensors, so the last batch of each tensor may be smaller than the
+   * batch size.
+   */
+  class MPIPipelineScheduler : public BatchOptimizationScheduler {
+  public:
+    /**
+     * @brief Build a new scheduler for the local stage
+     * @param job The job to schedule. Only read by the first stage, the other stages may pass a job
+     * with no samples
+     * @param optimizer The optimizer of the local stage
+     */
+    MPIPipelineScheduler(const BatchSchedulerJob &job, MPIPipelineOptimizer &optimizer);
+
+    /**
+     * @note This method is collective over the communicator of the optimizer
+     * @brief Runs the pipeline for a single epoch
+     */
+    void run() override;
+
+  protected:
+    void print(std::ostream &os) const override;
+
+    void updateModel() override;
+    void epochStart() override;
+    void endEpoch() override;
+
+  private:
+    MPIPipelineOptimizer *optimizer;
+    std::unique_ptr<MPIPipelineOptimizer::Operation> optimizer_operation;
+  };
+}   // namespace nnet
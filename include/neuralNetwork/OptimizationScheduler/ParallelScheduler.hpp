@@ -53,6 +53,8 @@ namespace nnet {
     std::unique_ptr<Dispatcher> batch_dispatcher;
     Optimizer *optimizer;
     std::unique_ptr<Optimizer::Operation> optimizer_operation;
+    // Number of epochs run so far, used to draw new augmentations at each epoch
+    size_t epoch = 0;
   };
 
   /**
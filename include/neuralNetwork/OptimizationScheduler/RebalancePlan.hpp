@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace nnet {
+
+  /**
+   * @brief A number of samples to move from a process to another
+   */
+  struct SampleTransfer {
+    int source;
+    int destination;
+    size_t count;
+  };
+
+  /**
+   * @brief Computes the number of samples each process should hold, proportionally to its
+   * throughput. Uses the largest remainder method so that the sum is preserved, ties being broken
+   * by rank
+   * @param total The number of samples to share
+   * @param throughputs The throughput of each process, must be positive
+   * @return The number of samples of each process
+   */
+  std::vector<size_t> computeTargetCounts(size_t total, const std::vector<double> &throughputs);
+
+  /**
+   * @brief Builds the list of transfers needed to go from the current counts to the targets.
+   * Every process computes the same plan, since it only depends on gathered data
+   * @param counts The number of samples currently held by each process
+   * @param targets The number of samples each process should hold, with the same sum as counts
+   * @return The transfers, ordered by source and destination rank
+   */
+  std::vector<SampleTransfer> planTransfers(const std::vector<size_t> &counts,
+                                            const std::vector<size_t> &targets);
+
+}   // namespace nnet
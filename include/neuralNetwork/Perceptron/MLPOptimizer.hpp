@@ -20,6 +20,14 @@ namespace nnet {
      */
     class WeightUpdateCache;
 
+    /**
+     * @brief The outputs of every layer during a forward pass, before and after the activation
+     * function. The first element is the input of the perceptron
+     */
+    struct LayersOutput {
+      std::vector<math::clFTensor> layers_output;
+      std::vector<math::clFTensor> layers_af_output;
+    };
 
     /**
      * @brief A delegate class to run the Optimizer
@@ -137,6 +145,28 @@ namespace nnet {
     math::clFTensor optimize(const math::clFTensor &inputs, const math::clFTensor &targets,
                              WeightUpdateCache &cache, cl::CommandQueue &queue);
 
+    /**
+     * @brief Runs the perceptron on the inputs, using the weights stored in the cache
+     * @param inputs An input tensor
+     * @param cache The cache holding the copy of the weights to use
+     * @param queue The queue to use for the computation
+     * @return The output of every layer, required by the backward pass
+     */
+    LayersOutput forwardPass(const math::clFTensor &inputs, WeightUpdateCache &cache,
+                             cl::CommandQueue &queue);
+
+    /**
+     * @brief Backpropagates an error through the perceptron, and accumulates the gradients in the
+     * cache. The contribution of the cache is not increased
+     * @param output_error The error on the output of the last layer
+     * @param layers The outputs of the forward pass associated with this error
+     * @param cache The cache used for the forward pass
+     * @param queue The queue to use for the computation
+     * @return The error on the input
+     */
+    math::clFTensor backwardPass(math::clFTensor output_error, LayersOutput &layers,
+                                 WeightUpdateCache &cache, cl::CommandQueue &queue);
+
     /**
      * @brief Create a cache that can be used with this object
      * @return
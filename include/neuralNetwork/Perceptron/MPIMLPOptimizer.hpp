@@ -2,6 +2,7 @@
 
 #include "mpi.h"
 
+#include "MPIOperation.hpp"
 #include "Perceptron/MLPOptimizer.hpp"
 
 namespace nnet {
@@ -25,14 +26,14 @@ namespace nnet {
   };
 
 
-  class MPIMLPOptimizer::Operation : public MLPOptimizer::Operation {
+  class MPIMLPOptimizer::Operation : public MLPOptimizer::Operation, public MPIOperation {
   public:
     explicit Operation(MPIMLPOptimizer &optimizer)
         : MLPOptimizer::Operation(optimizer), current_comm(MPI_COMM_WORLD) {}
 
-    void setCommunicator(MPI_Comm comm) { this->current_comm = comm; }
+    void setCommunicator(MPI_Comm comm) override { this->current_comm = comm; }
 
-    [[nodiscard]] MPI_Comm getCommunicator() const;
+    [[nodiscard]] MPI_Comm getCommunicator() const override;
 
   protected:
     void reduceAll(cl::CommandQueue &queue) override;
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "MLPModel.hpp"
+#include <mpi.h>
+
+namespace nnet {
+
+  /**
+   * @brief A perceptron whose layers are split between the processes of a communicator, as
+   * trained by a MPIPipelineOptimizer. Each process holds the model of its own stage.
+   *
+   * Running the model is collective: the first stage reads the inputs, the activations flow through
+   * the stages, and the outputs of the last stage are broadcast back to every stage. Hence, every
+   * process must run the model the same number of times, in the same order.
+   */
+  class MPIPipelineModel : public Model {
+  public:
+    /**
+     * @note This constructor is collective over the communicator
+     * @brief Builds the pipelined model from the local stage
+     * @param stage The model holding the layers of this stage, whose topology should be built with
+     * nnet::makeStageTopology(). Must outlive this model
+     * @param comm The communicator whose processes hold the stages, in order of rank
+     */
+    MPIPipelineModel(MLPModel &stage, MPI_Comm comm);
+
+    /**
+     * @note This method is collective over the communicator
+     * @brief Runs the model on a single sample
+     * @param input The input of the model. Only read by the first stage
+     * @return The output of the model, on every stage
+     */
+    math::clFMatrix predict(cl::CommandQueue &queue, math::clFMatrix const &input) const override;
+
+    /**
+     * @note This method is collective over the communicator
+     * @brief Runs the model on a batch of samples
+     * @param inputs The inputs of the model. Only read by the first stage
+     * @return The outputs of the model, on every stage
+     */
+    math::clFTensor predict(cl::CommandQueue &queue, math::clFTensor const &inputs) const override;
+
+    /**
+     * @brief Saves the local stage, in a file suffixed by the rank of the stage
+     */
+    bool save(const std::filesystem::path &path) const override;
+
+    /**
+     * @brief Loads the local stage from a file suffixed by the rank of the stage
+     */
+    bool load(const std::filesystem::path &path) override;
+
+    [[nodiscard]] MLPModel &getStage() { return *stage; }
+    [[nodiscard]] MLPModel const &getStage() const { return *stage; }
+
+    [[nodiscard]] MPI_Comm getCommunicator() const { return comm; }
+    [[nodiscard]] bool isFirstStage() const { return rank == 0; }
+    [[nodiscard]] bool isLastStage() const { return rank == n_stage - 1; }
+
+  private:
+    [[nodiscard]] std::filesystem::path getStagePath(const std::filesystem::path &path) const;
+
+    MLPModel *stage;
+    MPI_Comm comm;
+    int rank = 0, n_stage = 0;
+    // The output size of the last stage
+    size_t output_size = 0;
+  };
+
+}   // namespace nnet
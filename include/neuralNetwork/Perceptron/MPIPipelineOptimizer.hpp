@@ -0,0 +1,87 @@
+#pragma once
+
+#include "mpi.h"
+
+#include "Perceptron/MLPOptimizer.hpp"
+
+namespace nnet {
+
+  /**
+   * @brief An MLPOptimizer for pipeline parallelism. The layers of the perceptron are split
+   * between the processes of a communicator, each process (or stage) holding a contiguous range of
+   * layers. The stage of rank 0 holds the first layers, and the stage of the last rank the output
+   * layer.
+   *
+   * Each batch is divided into micro-batches that stream through the stages: the activations are
+   * sent forward to the next stage, and the errors backward to the previous one, asynchronously.
+   * Since a stage only holds its own layers, no weight synchronization is required between the
+   * stages. The trained perceptron is run through a MPIPipelineModel.
+   */
+  class MPIPipelineOptimizer : public MLPOptimizer {
+  public:
+    class Operation;
+
+    /**
+     * @note This constructor is collective over the communicator
+     * @brief Builds a new optimizer for the local stage of a perceptron
+     * @param stage The perceptron holding the layers of this stage. Its topology should be built
+     * with nnet::makeStageTopology()
+     * @param optimization The optimization method to use. Takes ownership of the method
+     * @param comm The communicator whose processes hold the stages, in order of rank
+     * @param n_micro_batch The number of micro-batches each batch is split into
+     */
+    MPIPipelineOptimizer(MLPModel &stage, std::unique_ptr<Optimization> optimization,
+                         MPI_Comm comm, size_t n_micro_batch);
+
+    template<class optim, typename... Args>
+    static std::unique_ptr<MPIPipelineOptimizer> make(MLPModel &stage, MPI_Comm comm,
+                                                      size_t n_micro_batch, Args &&...args) {
+      return std::make_unique<MPIPipelineOptimizer>(
+              stage, std::make_unique<optim>(stage.getPerceptron(), std::forward<Args>(args)...),
+              comm, n_micro_batch);
+    }
+
+    [[nodiscard]] MPI_Comm getCommunicator() const { return comm; }
+    [[nodiscard]] bool isFirstStage() const { return rank == 0; }
+    [[nodiscard]] bool isLastStage() const { return rank == n_stage - 1; }
+
+  private:
+    MLPOptimizer::Operation *makeOperationImpl() override;
+
+    MPI_Comm comm;
+    int rank = 0, n_stage = 0;
+    size_t n_micro_batch;
+  };
+
+  /**
+   * @brief Runs the pipeline on a batch. Every stage must run the same sequence of batches:
+   * only the first stage reads the inputs, and only the last one reads the targets
+   */
+  class MPIPipelineOptimizer::Operation : public MLPOptimizer::Operation {
+  public:
+    explicit Operation(MPIPipelineOptimizer &optimizer);
+
+    /**
+     * @brief Runs the pipeline on a batch, using the first cache
+     * @param thread_rank Unused, the pipeline is single-threaded on each stage
+     */
+    void operator()(size_t thread_rank, const math::clFTensor &inputs,
+                    const math::clFTensor &targets, cl::CommandQueue queue) override;
+
+    /**
+     * @note This method is collective over the communicator of the optimizer
+     * @brief Runs the pipeline on a batch
+     * @param batch_size The number of samples in the batch, which must be the same on every stage
+     * @param inputs The inputs of the batch. Only read by the first stage
+     * @param targets The targets of the batch. Only read by the first stage, which forwards them to
+     * the last stage
+     * @param queue The queue to use for the computation
+     */
+    void runBatch(size_t batch_size, const math::clFTensor &inputs,
+                  const math::clFTensor &targets, cl::CommandQueue &queue);
+
+  private:
+    MPIPipelineOptimizer *pipeline;
+  };
+
+}   // namespace nnet
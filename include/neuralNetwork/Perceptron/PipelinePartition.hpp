@@ -0,0 +1,27 @@
+#pragma once
+#include "MLPerceptron.hpp"
+#include <vector>
+
+namespace nnet {
+
+  /**
+   * @brief Returns the topology of the layers held by a stage of a pipelined perceptron. The layers
+   * are split so that each stage holds roughly the same number of weights
+   * @param topology The topology of the whole perceptron
+   * @param stage The index of the stage
+   * @param n_stage The total number of stages. The perceptron must have at least this number of
+   * layers
+   * @return The topology of the stage, whose first layer is the last layer of the previous stage
+   */
+  MLPTopology makeStageTopology(const MLPTopology &topology, size_t stage, size_t n_stage);
+
+  /**
+   * @brief Returns the boundaries of the micro-batches of a batch, so that micro-batch i covers the
+   * samples [res[i], res[i + 1][. The batch is split into at most batch_size micro-batches, whose
+   * sizes differ by at most one
+   * @param batch_size The number of samples of the batch
+   * @param n_micro_batch The number of micro-batches to split the batch into
+   */
+  std::vector<size_t> splitBatch(size_t batch_size, size_t n_micro_batch);
+
+}   // namespace nnet
@@ -1,5 +1,7 @@
 #include "EvalController.hpp"
 
+#include <algorithm>
+
 namespace control {
 
   EvalController::EvalController(const std::filesystem::path &output_path, nnet::Model *model,
@@ -8,17 +10,59 @@ namespace control {
 
 
   ControllerResult EvalController::run() noexcept {
-    if (input_set->getTensorCount() == 0) { return {1, "No input data found"}; }
+    if (not input_set or input_set->getTensorCount() == 0) { return {1, "No input data found"}; }
+
+    auto &queue = utils::cl_wrapper.getDefaultQueue();
+    try {
+      // Temporary implementation that treat each matrix individually and not tensor-wise
+      // The tensors are fetched as floats, since samples stored as bytes hold no float data
+      for (size_t t = 0, count = 0; t < input_set->getTensorCount(); t++) {
+        math::clFTensor inputs = input_set->getFloatTensor(t, queue);
+        for (size_t i = 0; i < inputs.getDepth(); i++, count++) {
+          auto res = model->predict(queue, inputs[i]);
+          auto class_id = res.imax();
+          (*input_set)[count].setClass(class_id);
+          std::cout << "Sample " << (*input_set)[count].getId() << " is of class " << class_id
+                    << std::endl;
+        }
+      }
+    } catch (const std::exception &e) { return {1, e.what()}; }
+
+    return {0, "Evaluation Success"};
+  }
+
+  ControllerResult
+  EvalController::runTiled(const std::vector<std::filesystem::path> &images,
+                           const TiledInference &tiling, size_t class_index,
+                           const image::transform::TransformEngine *engine) noexcept {
+    if (images.empty()) { return {1, "No input data found"}; }
+
+    auto &queue = utils::cl_wrapper.getDefaultQueue();
+    try {
+      if (not std::filesystem::exists(output_path))
+        std::filesystem::create_directories(output_path);
 
-    size_t count = 0;
+      for (auto &path : images) {
+        image::GrayscaleImage image = image::ImageSerializer::load(path);
+        if (engine) engine->apply(image);
+        math::FloatMatrix heatmap = tiling.predictHeatmap(image, class_index, queue);
 
-    // Temporary implementation that treat each matrix individually and not tensor-wise
-    for (auto &it : *input_set) {
-      auto res = model->predict(utils::cl_wrapper.getDefaultQueue(), it.getData());
-      auto class_id = res.imax();
-      (*input_set)[count].setClass(class_id);
-      std::cout << "Sample " << it.getId() << " is of class " << class_id << std::endl;
-    }
+        // The outputs of the model are probabilities, they are scaled to the range of a pixel
+        auto pixels = std::make_unique<image::grayscale_t[]>(heatmap.getSize());
+        float max_score = 0.f;
+        for (size_t i = 0; i < heatmap.getSize(); i++) {
+          const float score = std::clamp(heatmap.getData()[i], 0.f, 1.f);
+          pixels[i] = (image::grayscale_t) (score * 255.f);
+          max_score = std::max(max_score, score);
+        }
+        image::GrayscaleImage res(heatmap.getCols(), heatmap.getRows(), std::move(pixels));
+        const std::filesystem::path heatmap_path =
+                output_path / (path.stem().string() + "_heatmap.png");
+        image::ImageSerializer::save(heatmap_path.string(), res);
+        std::cout << "Image " << path << " has a maximum score of " << max_score << " for class "
+                  << class_index << ", heatmap saved to " << heatmap_path << std::endl;
+      }
+    } catch (const std::exception &e) { return {1, e.what()}; }
 
     return {0, "Evaluation Success"};
   }
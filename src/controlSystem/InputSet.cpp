@@ -37,8 +37,10 @@ namespace control {
 
     input_width = other.input_width;
     input_height = other.input_height;
+    storage = other.storage;
 
     tensors = std::move(other.tensors);
+    byte_tensors = std::move(other.byte_tensors);
     samples = std::move(other.samples);
     class_names = std::move(other.class_names);
     return *this;
@@ -48,6 +50,9 @@ namespace control {
                         const std::vector<long> &class_ids) {
     std::scoped_lock lock(mutex);
 
+    if (storage != InputStorage::float32)
+      throw std::runtime_error("InputSet::append: Cannot append floats to a uint8 set");
+
     // Each sample must have its own id
     if (tensor.getDepth() != new_ids.size()) {
       std::cerr << "Error: tensor.getDepth(): " << tensor.getDepth()
@@ -73,8 +78,31 @@ namespace control {
     tensors.push_back(std::move(tensor));
   }
 
+  void InputSet::append(math::clU8Tensor &&tensor, const std::vector<size_t> &new_ids,
+                        const std::vector<long> &class_ids) {
+    std::scoped_lock lock(mutex);
+
+    if (storage != InputStorage::uint8)
+      throw std::runtime_error("InputSet::append: Cannot append bytes to a float32 set");
+    if (tensor.getDepth() != new_ids.size())
+      throw std::runtime_error("InputSet::append: tensor and new_ids must have same size");
+    if (tensor.getRows() != input_width or tensor.getCols() != input_height)
+      throw std::runtime_error(
+              "InputSet::append: tensor must have same size as input_width and input_height");
+
+    // The samples have no float data, they are only converted when a batch is sliced
+    for (size_t i = 0; i < new_ids.size(); i++) {
+      long class_id = -1;
+      if (class_ids.size() == new_ids.size()) class_id = class_ids[i];
+      samples.emplace_back(new_ids[i], class_id, math::clFMatrix());
+    }
+    byte_tensors.push_back(std::move(tensor));
+  }
+
   void InputSet::alterTensors(size_t new_tensor_size) {
     std::scoped_lock lock(mutex);
+    if (storage != InputStorage::float32)
+      throw std::runtime_error("InputSet::alterTensors: Not supported by uint8 sets");
 
     std::vector<math::clFTensor> new_tensors;
     size_t size = samples.size();
@@ -105,7 +133,8 @@ namespace control {
       throw std::runtime_error("InputSet::removeTensors: start must be smaller than end");
     }
 
-    if (end > tensors.size()) {
+    const bool bytes = storage == InputStorage::uint8;
+    if (end > (bytes ? byte_tensors.size() : tensors.size())) {
       throw std::runtime_error("InputSet::removeTensors: end must be smaller than tensors.size()");
     }
 
@@ -113,16 +142,21 @@ namespace control {
     size_t last_global_index = 0;
 
     for (size_t i = 0; i < end; i++) {
-      if (i < start) { first_global_index += tensors[i].getDepth(); }
-      last_global_index += tensors[i].getDepth();
+      size_t depth = bytes ? byte_tensors[i].getDepth() : tensors[i].getDepth();
+      if (i < start) { first_global_index += depth; }
+      last_global_index += depth;
     }
     samples.erase(samples.begin() + first_global_index, samples.begin() + last_global_index);
     // Remove the tensors from the vector
-    tensors.erase(tensors.begin() + start, tensors.begin() + end);
+    if (bytes) byte_tensors.erase(byte_tensors.begin() + start, byte_tensors.begin() + end);
+    else
+      tensors.erase(tensors.begin() + start, tensors.begin() + end);
   }
 
   void InputSet::shuffle(size_t random_seed) {
     std::scoped_lock lock(mutex);
+    if (storage != InputStorage::float32)
+      throw std::runtime_error("InputSet::shuffle: Not supported by uint8 sets");
 
     // Since we need to shuffle not only the tensors, but their content
     // The easiest way is to recreate a new input set and move copy the samples
@@ -162,6 +196,8 @@ namespace control {
 
   void InputSet::split(size_t nb_sets, std::vector<InputSet> &sub_sets) const {
     assert(sub_sets.empty());
+    if (storage != InputStorage::float32)
+      throw std::runtime_error("InputSet::split: Not supported by uint8 sets");
     std::cout << "InputSet::splitTrainingSet() Splitting InputSet intro " +
                          std::to_string(nb_sets) + " sub-sets."
               << std::endl;
@@ -272,4 +308,13 @@ namespace control {
 
   const std::vector<Sample> &InputSet::getSamples() const { return samples; }
 
+  math::clFTensor InputSet::getFloatTensor(size_t index, cl::CommandQueue &queue) const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    if (storage == InputStorage::float32) return tensors.at(index).shallowCopy();
+
+    math::clFTensor res = byte_tensors.at(index).toFloat(queue);
+    queue.finish();
+    return res;
+  }
+
 }   // namespace control
\ No newline at end of file
@@ -1,6 +1,26 @@
 #include "InputSetLoader.hpp"
+#include "image/ImageBatch.hpp"
+#include "image/clTransformEngine.hpp"
+#include <algorithm>
+#include <array>
+#include <boost/asio.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
 #include <stack>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 namespace tr = image::transform;
@@ -52,92 +72,573 @@ namespace control {
       long class_id;
     };
 
-    // Take a list of input files, create a Tensor and fill it up with images loaded from the files.
-    // Images are normalized and transformed, and stored inside the Tensor (Using the default
-    // device) The tensor is then appended at the end of the input set.
-    void loadTensor(const std::vector<InputFileMetadata> &files, size_t index, size_t tensor_size,
-                    TransformationPipeline &pipeline, InputSet &res) {
-      // We may be left with a small number of images, so we need to resize the tensor
-      // This can happen if the number of images is not a multiple of the tensor size
-      size_t count = std::min(tensor_size, files.size() - index);
-      math::clFTensor tensor(res.getInputWidth(), res.getInputHeight(), count);
+    // Number of tensors being decoded at the same time. While a tensor is uploaded, the decoders
+    // already work on the next one
+    constexpr size_t kStagingSlots = 2;
 
-      // Create an out-of-order queue to transform the images in parallel
-      cl::CommandQueue queue = cl::CommandQueue(utils::cl_wrapper.getContext(),
-                                                utils::cl_wrapper.getDefaultDevice());
+    /**
+     * @brief A pinned host buffer receiving the raw bytes of the images of a tensor, mapped while
+     * the decoders write into it
+     */
+    struct StagingSlot {
+      cl::Buffer buffer;
+      unsigned char *data = nullptr;
+      std::vector<std::future<void>> decodes;
+    };
 
-      // Fetch the normalizing kernel
-      // This kernel convert a char array to a float array, and scale every element by a given
-      // factor
-      cl::Kernel kernel = utils::cl_wrapper.getKernels().getKernel("NormalizeCharToFloat.cl",
-                                                                   "normalizeCharToFloat");
+    // Writes the raw bytes of the i-th sample of a set to the given destination
+    using SampleReader = std::function<void(size_t i, unsigned char *dst)>;
 
+    /**
+     * @brief Loads the samples of an input set in parallel. Decoder threads read the samples of a
+     * tensor straight into a staging slot, while the main thread uploads the previous tensor with
+     * a single kernel launch. At most kStagingSlots tensors are in flight
+     */
+    class LoadingPipeline {
+    public:
+      /**
+       * @param ids The ids of the samples, in loading order
+       * @param class_ids The class ids of the samples, in loading order
+       * @param reader Reads the i-th sample. Called concurrently by the decoders
+       * @param batch_engine If not null, applied to every tensor once decoded, in place
+       * @param cache If not null, receives the raw bytes of every tensor once transformed
+       */
+      LoadingPipeline(const std::vector<size_t> &ids, const std::vector<long> &class_ids,
+                      size_t tensor_size, size_t n_thread, SampleReader reader, InputSet &res,
+                      const tr::TransformEngine *batch_engine = nullptr,
+                      std::ostream *cache = nullptr)
+          : ids(ids), class_ids(class_ids), tensor_size(tensor_size), reader(std::move(reader)),
+            res(res), batch_engine(batch_engine), cache(cache),
+            image_size(res.getInputWidth() * res.getInputHeight()),
+            queue(utils::cl_wrapper.getContext(), utils::cl_wrapper.getDefaultDevice()),
+            // This kernel convert a char array to a float array, and scale every element by a
+            // given factor
+            kernel(utils::cl_wrapper.getKernels().getKernel("NormalizeCharToFloat.cl",
+                                                            "normalizeCharToFloat")),
+            // The decoders are joined before the slots they write into are released
+            decoders(n_thread) {
+        for (auto &slot : slots)
+          slot.buffer = cl::Buffer(CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR,
+                                   std::max<size_t>(tensor_size * image_size, 1));
+      }
 
-      std::vector<size_t> ids;
-      std::vector<long> classes;
+      ~LoadingPipeline() {
+        // Abandon the pending decodes if loading failed
+        decoders.stop();
+        decoders.join();
+        for (auto &slot : slots) {
+          if (slot.data) queue.enqueueUnmapMemObject(slot.buffer, slot.data);
+        }
+        queue.finish();
+      }
 
-      for (size_t i = 0; i < count; ++i) {
-        auto &file = files[index + i];
-        // Load and transform the input image
-        auto image = pipeline.loadAndTransform(file.path);
+      void run() {
+        const size_t n_tensor = (ids.size() + tensor_size - 1) / tensor_size;
+        for (size_t t = 0; t < std::min(kStagingSlots, n_tensor); t++) decode(t);
+        for (size_t t = 0; t < n_tensor; t++) {
+          upload(t);
+          if (t + kStagingSlots < n_tensor) decode(t + kStagingSlots);
+        }
+        queue.finish();
+      }
 
-        // Copy the image to the Device
-        // We need to load the image to the cl device before applying the kernel
-        cl::Buffer img_buffer(CL_MEM_READ_WRITE, image.getSize());
-        queue.enqueueWriteBuffer(img_buffer, CL_TRUE, 0, image.getSize(), image.getData());
+    private:
+      // The number of samples in a tensor. The last one may be smaller than tensor_size
+      size_t tensorCount(size_t t) const {
+        return std::min(tensor_size, ids.size() - t * tensor_size);
+      }
 
-        kernel.setArg(0, img_buffer);
-        auto matrix = tensor[i];
-        kernel.setArg(1, matrix.getBuffer());
-        kernel.setArg(2, matrix.getOffset());
+      void decode(size_t t) {
+        auto &slot = slots[t % kStagingSlots];
+        // The map waits for the previous upload from this slot to complete
+        slot.data = static_cast<unsigned char *>(
+                queue.enqueueMapBuffer(slot.buffer, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 0,
+                                       tensorCount(t) * image_size));
+
+        for (size_t i = 0; i < tensorCount(t); i++) {
+          auto task = [this, sample = t * tensor_size + i, dst = slot.data + i * image_size] {
+            reader(sample, dst);
+          };
+          slot.decodes.emplace_back(
+                  boost::asio::post(decoders, std::packaged_task<void(void)>(task)));
+        }
+      }
 
-        // We also normalize the matrix by a given factor
-        kernel.setArg(3, 255.0f);
+      void upload(size_t t) {
+        auto &slot = slots[t % kStagingSlots];
+        const size_t count = tensorCount(t);
+        // Rethrows the errors of the decoders
+        for (auto &f : slot.decodes) f.get();
+        slot.decodes.clear();
+        if (batch_engine) {
+          auto batch = image::ImageBatch::view(slot.data, res.getInputWidth(),
+                                               res.getInputHeight(), count);
+          batch_engine->apply(batch);
+        }
+        if (cache) cache->write(reinterpret_cast<const char *>(slot.data), count * image_size);
+        queue.enqueueUnmapMemObject(slot.buffer, slot.data);
+        slot.data = nullptr;
+
+        const size_t first = t * tensor_size;
+        std::vector<size_t> tensor_ids(ids.begin() + first, ids.begin() + first + count);
+        std::vector<long> tensor_classes(class_ids.begin() + first,
+                                         class_ids.begin() + first + count);
+
+        if (res.getStorage() == InputStorage::uint8) {
+          // The bytes are kept as is, and only normalized when a batch is sliced
+          math::clU8Tensor tensor(res.getInputWidth(), res.getInputHeight(), count);
+          queue.enqueueCopyBuffer(slot.buffer, tensor.getBuffer(), 0, 0, tensor.sizeInBytes());
+          res.append(std::move(tensor), tensor_ids, tensor_classes);
+          return;
+        }
 
-        // Convert the image to float and normalize it by 255
-        queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(image.getSize()),
+        // Convert the whole tensor to float and normalize it by 255 in a single launch
+        math::clFTensor tensor(res.getInputWidth(), res.getInputHeight(), count);
+        kernel.setArg(0, slot.buffer);
+        kernel.setArg(1, (cl_ulong) 0);
+        kernel.setArg(2, tensor.getBuffer());
+        kernel.setArg(3, (cl_ulong) tensor.getOffsetInFloats());
+        kernel.setArg(4, 255.0f);
+        queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(count * image_size),
                                    cl::NullRange);
-        ids.push_back(file.input_id);
-        classes.push_back(file.class_id);
+
+        // Append the tensor to the input set
+        res.append(std::move(tensor), tensor_ids, tensor_classes);
+      }
+
+      const std::vector<size_t> &ids;
+      const std::vector<long> &class_ids;
+      const size_t tensor_size;
+      SampleReader reader;
+      InputSet &res;
+      const tr::TransformEngine *batch_engine;
+      std::ostream *cache;
+      const size_t image_size;
+
+      cl::CommandQueue queue;
+      cl::Kernel kernel;
+      std::array<StagingSlot, kStagingSlots> slots;
+      boost::asio::thread_pool decoders;
+    };
+
+    // Upper bound of the decoded bytes of a chunk of the device pipeline. At most kStagingSlots
+    // chunks are in flight, whatever the resolution of the images
+    constexpr size_t kDeviceChunkBytes = 128 * 1024 * 1024;
+
+    /**
+     * @brief Loads the samples of an input set, transforming them on the device. Decoder threads
+     * only decode the images, which are uploaded with their original size, then resized,
+     * transformed and normalized by the device engine into a slice of the current tensor.
+     *
+     * Full-resolution images can be large, so the samples are decoded by chunks of about
+     * kDeviceChunkBytes, estimated from the size of the images decoded so far. At most
+     * kStagingSlots chunks are in flight
+     */
+    class DeviceLoadingPipeline {
+    public:
+      DeviceLoadingPipeline(const std::vector<InputFileMetadata> &files, size_t tensor_size,
+                            size_t n_thread, const tr::clTransformEngine &engine, InputSet &res)
+          : files(files), tensor_size(tensor_size), n_thread(n_thread), engine(engine), res(res),
+            queue(utils::cl_wrapper.getContext(), utils::cl_wrapper.getDefaultDevice()),
+            decoders(n_thread) {}
+
+      ~DeviceLoadingPipeline() {
+        // Abandon the pending decodes if loading failed
+        decoders.stop();
+        decoders.join();
+        queue.finish();
+      }
+
+      void run() {
+        while (chunks.size() < kStagingSlots and next_sample < files.size()) decode();
+        while (not chunks.empty()) {
+          upload(chunks.front());
+          chunks.pop_front();
+          while (chunks.size() < kStagingSlots and next_sample < files.size()) decode();
+        }
+        queue.finish();
+      }
+
+    private:
+      struct Chunk {
+        // The samples [begin, end[ of the set
+        size_t begin = 0, end = 0;
+        std::vector<image::GrayscaleImage> images;
+        std::vector<std::future<void>> decodes;
+      };
+
+      // Returns the number of samples of the next chunk. Chunks never cross tensor boundaries
+      size_t nextChunkSize() const {
+        const size_t tensor_end = std::min((next_sample / tensor_size + 1) * tensor_size,
+                                           files.size());
+        // Until an image is decoded, its size is unknown: decode one image per thread
+        size_t count = n_thread;
+        if (decoded_images > 0) {
+          const size_t average = std::max<size_t>(decoded_bytes / decoded_images, 1);
+          count = std::max<size_t>(kDeviceChunkBytes / average, 1);
+        }
+        return std::min(count, tensor_end - next_sample);
+      }
+
+      void decode() {
+        // Elements of a deque are not moved when another one is added, the decoders can write
+        // into the chunk
+        auto &chunk = chunks.emplace_back();
+        chunk.begin = next_sample;
+        chunk.end = next_sample + nextChunkSize();
+        next_sample = chunk.end;
+        chunk.images.resize(chunk.end - chunk.begin);
+        for (size_t i = chunk.begin; i < chunk.end; i++) {
+          auto task = [&path = files[i].path, &dst = chunk.images[i - chunk.begin]] {
+            dst = image::ImageSerializer::load(path);
+          };
+          chunk.decodes.emplace_back(
+                  boost::asio::post(decoders, std::packaged_task<void(void)>(task)));
+        }
+      }
+
+      void upload(Chunk &chunk) {
+        // Rethrows the errors of the decoders
+        for (auto &f : chunk.decodes) f.get();
+        chunk.decodes.clear();
+        for (const auto &image : chunk.images) decoded_bytes += image.getSize();
+        decoded_images += chunk.images.size();
+
+        // A new tensor is started on a tensor boundary
+        const size_t tensor_begin = chunk.begin / tensor_size * tensor_size;
+        const size_t count = std::min(tensor_size, files.size() - tensor_begin);
+        const bool bytes = res.getStorage() == InputStorage::uint8;
+        if (chunk.begin == tensor_begin) {
+          const size_t width = res.getInputWidth(), height = res.getInputHeight();
+          if (bytes) byte_tensor = math::clU8Tensor(width, height, count);
+          else
+            float_tensor = math::clFTensor(width, height, count);
+        }
+
+        // The images are copied to the device before the engine returns, so the chunk can be
+        // released right away
+        const size_t local_begin = chunk.begin - tensor_begin, local_end = chunk.end - tensor_begin;
+        if (bytes) {
+          math::clU8Tensor slice = byte_tensor.slice(local_begin, local_end);
+          engine.transformToBytes(chunk.images, slice, queue);
+        } else {
+          math::clFTensor slice = float_tensor.slice(local_begin, local_end);
+          engine.transform(chunk.images, slice, queue);
+        }
+        chunk.images.clear();
+        if (chunk.end != tensor_begin + count) return;
+
+        std::vector<size_t> tensor_ids;
+        std::vector<long> tensor_classes;
+        for (size_t i = tensor_begin; i < tensor_begin + count; i++) {
+          tensor_ids.push_back(files[i].input_id);
+          tensor_classes.push_back(files[i].class_id);
+        }
+        if (bytes) res.append(std::move(byte_tensor), tensor_ids, tensor_classes);
+        else
+          res.append(std::move(float_tensor), tensor_ids, tensor_classes);
+      }
+
+      const std::vector<InputFileMetadata> &files;
+      const size_t tensor_size;
+      const size_t n_thread;
+      const tr::clTransformEngine &engine;
+      InputSet &res;
+
+      size_t next_sample = 0;
+      size_t decoded_bytes = 0, decoded_images = 0;
+      // The tensor being filled, depending on the storage of the set
+      math::clFTensor float_tensor;
+      math::clU8Tensor byte_tensor;
+
+      cl::CommandQueue queue;
+      std::deque<Chunk> chunks;
+      boost::asio::thread_pool decoders;
+    };
+
+    // Return the entries of a directory sorted by path, so that every process enumerates the
+    // samples in the same order
+    std::vector<fs::directory_entry> sortedEntries(const fs::path &path) {
+      std::vector<fs::directory_entry> entries;
+      for (const auto &entry : fs::directory_iterator(path)) entries.push_back(entry);
+      std::sort(entries.begin(), entries.end(),
+                [](const auto &a, const auto &b) { return a.path() < b.path(); });
+      return entries;
+    }
+
+    // Cache files start with this magic, followed by the CacheHeader
+    constexpr std::array<char, 8> kCacheMagic = {'N', 'N', 'S', 'E', 'T', 'v', '1', '\0'};
+
+    /**
+     * @brief Header of a cache file. It is followed by the class names (each one prefixed by its
+     * length), the sample ids, the class ids, and the pixels of every sample
+     */
+    struct CacheHeader {
+      std::array<char, 8> magic;
+      uint64_t key;
+      uint64_t width, height;
+      uint64_t n_sample, n_class;
+    };
+
+    /**
+     * @brief Returns the key of the cache of a set of files. It changes whenever a file is added,
+     * removed or modified, or when the images are transformed differently
+     */
+    uint64_t cacheKey(const std::vector<InputFileMetadata> &files,
+                      const std::vector<std::string> &classes, size_t width, size_t height,
+                      const tr::TransformEngine &pre_engine,
+                      const tr::TransformEngine &post_engine) {
+      std::ostringstream description;
+      description << width << 'x' << height << '\n'
+                  << pre_engine.getIdentifier() << '\n'
+                  << post_engine.getIdentifier() << '\n';
+      for (const auto &c : classes) description << c << '\n';
+      for (const auto &file : files) {
+        description << file.path.string() << ' ' << file.input_id << ' ' << file.class_id << ' '
+                    << fs::file_size(file.path) << ' '
+                    << fs::last_write_time(file.path).time_since_epoch().count() << '\n';
+      }
+      return std::hash<std::string>{}(description.str());
+    }
+
+    /**
+     * @brief A read-only memory mapping of a whole file
+     */
+    class MappedFile {
+    public:
+      explicit MappedFile(const fs::path &path) {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("MappedFile: Cannot open " + path.string());
+        struct stat st {};
+        if (::fstat(fd, &st) == 0 and st.st_size > 0) {
+          size = static_cast<size_t>(st.st_size);
+          void *ptr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (ptr != MAP_FAILED) data = static_cast<const unsigned char *>(ptr);
+        }
+        ::close(fd);
+        if (not data) throw std::runtime_error("MappedFile: Cannot map " + path.string());
+      }
+
+      MappedFile(const MappedFile &) = delete;
+      MappedFile &operator=(const MappedFile &) = delete;
+
+      ~MappedFile() { ::munmap(const_cast<unsigned char *>(data), size); }
+
+      const unsigned char *data = nullptr;
+      size_t size = 0;
+    };
+
+    /**
+     * @brief Reads the values stored at the cursor of a mapped file, and moves the cursor past
+     * them. Returns false if the file is too short
+     */
+    template<typename T>
+    bool readCache(const MappedFile &file, size_t &cursor, T *values, size_t count = 1) {
+      if (cursor + sizeof(T) * count > file.size) return false;
+      std::memcpy(values, file.data + cursor, sizeof(T) * count);
+      cursor += sizeof(T) * count;
+      return true;
+    }
+
+    /**
+     * @brief Loads an input set from a cache file, without decoding any image
+     * @return False if the cache does not match the given key or is corrupted, in which case
+     * nothing is loaded
+     */
+    bool loadCache(const fs::path &cache_path, uint64_t key, InputSet &res, size_t tensor_size,
+                   size_t n_thread, bool shuffle_samples) {
+      MappedFile file(cache_path);
+      size_t cursor = 0;
+      CacheHeader header{};
+      if (not readCache(file, cursor, &header) or header.magic != kCacheMagic or
+          header.key != key or header.width != res.getInputWidth() or
+          header.height != res.getInputHeight())
+        return false;
+
+      // The class names are only checked, the caller already knows them
+      for (size_t i = 0; i < header.n_class; i++) {
+        uint64_t length = 0;
+        if (not readCache(file, cursor, &length) or cursor + length > file.size) return false;
+        cursor += length;
       }
-      // Wait until all the images are loaded
-      queue.finish();
 
-      // Append the tensor to the input set
-      res.append(std::move(tensor), ids, classes);
+      std::vector<size_t> ids(header.n_sample);
+      std::vector<long> class_ids(header.n_sample);
+      std::vector<uint64_t> stored_ids(header.n_sample);
+      std::vector<int64_t> stored_classes(header.n_sample);
+      if (not readCache(file, cursor, stored_ids.data(), header.n_sample) or
+          not readCache(file, cursor, stored_classes.data(), header.n_sample))
+        return false;
+
+      const size_t image_size = header.width * header.height;
+      if (cursor + header.n_sample * image_size != file.size) return false;
+      const unsigned char *pixels = file.data + cursor;
+
+      std::vector<size_t> order(header.n_sample);
+      std::iota(order.begin(), order.end(), 0);
+      if (shuffle_samples)
+        std::shuffle(order.begin(), order.end(), std::mt19937(std::random_device{}()));
+      for (size_t i = 0; i < order.size(); i++) {
+        ids[i] = stored_ids[order[i]];
+        class_ids[i] = stored_classes[order[i]];
+      }
+
+      LoadingPipeline(
+              ids, class_ids, tensor_size, n_thread,
+              [&](size_t i, unsigned char *dst) {
+                std::memcpy(dst, pixels + order[i] * image_size, image_size);
+              },
+              res)
+              .run();
+      return true;
+    }
+
+    void writeCacheHeader(std::ostream &out, uint64_t key, const InputSet &res,
+                          const std::vector<std::string> &classes, const std::vector<size_t> &ids,
+                          const std::vector<long> &class_ids) {
+      CacheHeader header{kCacheMagic, key, res.getInputWidth(), res.getInputHeight(), ids.size(),
+                         classes.size()};
+      out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+      for (const auto &c : classes) {
+        uint64_t length = c.size();
+        out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+        out.write(c.data(), static_cast<std::streamsize>(c.size()));
+      }
+      std::vector<uint64_t> stored_ids(ids.begin(), ids.end());
+      std::vector<int64_t> stored_classes(class_ids.begin(), class_ids.end());
+      out.write(reinterpret_cast<const char *>(stored_ids.data()),
+                static_cast<std::streamsize>(sizeof(uint64_t) * stored_ids.size()));
+      out.write(reinterpret_cast<const char *>(stored_classes.data()),
+                static_cast<std::streamsize>(sizeof(int64_t) * stored_classes.size()));
     }
 
-    // Take a list of samples metadata, and load them
-    void loadFiles(InputSet &res, size_t tensor_size, const tr::TransformEngine &pre_engine,
-                   const tr::TransformEngine &post_engine, std::vector<InputFileMetadata> &files,
-                   bool shuffle_samples) {
+    // Take a list of samples metadata, and load them. If cache_dir is not empty, the samples are
+    // read from a cache of the previous loads when possible, or a new cache is written. If
+    // on_device is true and every transformation can run on the device, the images are
+    // transformed on the device and the cache is not used
+    void loadFiles(InputSet &res, size_t tensor_size, size_t n_thread,
+                   const tr::TransformEngine &pre_engine, const tr::TransformEngine &post_engine,
+                   std::vector<InputFileMetadata> &files, const std::vector<std::string> &classes,
+                   bool shuffle_samples, const fs::path &cache_dir, bool on_device) {
+      if (n_thread == 0) n_thread = std::max(std::thread::hardware_concurrency(), 1u);
+
+      if (on_device) {
+        if (tr::clTransformEngine::supports(pre_engine) and
+            tr::clTransformEngine::supports(post_engine)) {
+          tr::clTransformEngine device_engine(res.getInputWidth(), res.getInputHeight());
+          device_engine.addTransformations(pre_engine);
+          device_engine.addTransformations(post_engine);
+          if (shuffle_samples)
+            std::shuffle(files.begin(), files.end(), std::mt19937(std::random_device{}()));
+          DeviceLoadingPipeline(files, tensor_size, n_thread, device_engine, res).run();
+          return;
+        }
+        tscl::logger("InputSetLoader: Some transformations cannot run on the device, the images "
+                     "are transformed on the host",
+                     tscl::Log::Warning);
+      }
+
+      uint64_t key = 0;
+      fs::path cache_path;
+      if (not cache_dir.empty()) {
+        key = cacheKey(files, classes, res.getInputWidth(), res.getInputHeight(), pre_engine,
+                       post_engine);
+        std::ostringstream name;
+        name << std::hex << std::setw(16) << std::setfill('0') << key << ".cache";
+        cache_path = cache_dir / name.str();
+        if (fs::exists(cache_path) and
+            loadCache(cache_path, key, res, tensor_size, n_thread, shuffle_samples)) {
+          tscl::logger("Loaded " + std::to_string(res.getSize()) + " samples from cache " +
+                       cache_path.string());
+          return;
+        }
+      }
+
       // Shuffle the samples if needed
       if (shuffle_samples)
         std::shuffle(files.begin(), files.end(), std::mt19937(std::random_device{}()));
 
-      // Create the transformation pipeline
+      // Create the transformation pipeline. If every transformation is pointwise, the decoders
+      // only resize the images, and the transformations are applied on whole tensors in a single
+      // sweep
       tr::TransformEngine resize_engine;
       resize_engine.addTransformation(
               std::make_shared<tr::Resize>(res.getInputWidth(), res.getInputHeight()));
-      TransformationPipeline pipeline({resize_engine, pre_engine, post_engine});
+      const bool batch_transforms = pre_engine.isPointwise() and post_engine.isPointwise();
+      tr::TransformEngine batch_engine;
+      if (batch_transforms) {
+        for (const auto &engine : {&pre_engine, &post_engine}) {
+          for (const auto &transformation : engine->getTransformations())
+            batch_engine.addTransformation(transformation);
+        }
+      }
+      TransformationPipeline pipeline =
+              batch_transforms ? TransformationPipeline({resize_engine})
+                               : TransformationPipeline({resize_engine, pre_engine, post_engine});
+      const tr::TransformEngine *tensor_engine = batch_transforms ? &batch_engine : nullptr;
+
+      std::vector<size_t> ids;
+      std::vector<long> class_ids;
+      for (const auto &file : files) {
+        ids.push_back(file.input_id);
+        class_ids.push_back(file.class_id);
+      }
 
+      const size_t image_size = res.getInputWidth() * res.getInputHeight();
+      auto reader = [&](size_t i, unsigned char *dst) {
+        auto image = pipeline.loadAndTransform(files[i].path);
+        if (image.getSize() != image_size)
+          throw std::runtime_error("InputSetLoader: " + files[i].path.string() +
+                                   " does not have the size of the input set once transformed");
+        std::copy(image.getData(), image.getData() + image_size, dst);
+      };
+
+      if (cache_path.empty()) {
+        LoadingPipeline(ids, class_ids, tensor_size, n_thread, reader, res, tensor_engine).run();
+        return;
+      }
 
-      for (size_t index = 0; index < files.size();
-           index += std::min(files.size() - index, tensor_size)) {
-        // Let async handle the threading policy
-        loadTensor(files, index, tensor_size, pipeline, res);
+      // The cache is written to a temporary file first, so that an interrupted load never
+      // leaves a truncated cache behind
+      fs::create_directories(cache_dir);
+      fs::path tmp_path = cache_path;
+      tmp_path += ".tmp";
+      {
+        std::ofstream cache(tmp_path, std::ios::binary | std::ios::trunc);
+        writeCacheHeader(cache, key, res, classes, ids, class_ids);
+        LoadingPipeline(ids, class_ids, tensor_size, n_thread, reader, res, tensor_engine, &cache)
+                .run();
+        if (not cache) {
+          tscl::logger("Failed to write the cache " + tmp_path.string(), tscl::Log::Warning);
+          cache.close();
+          fs::remove(tmp_path);
+          return;
+        }
       }
+      fs::rename(tmp_path, cache_path);
     }
   }   // namespace
 
-  InputSet InputSetLoader::loadWithClasses(const std::filesystem::path &path,
-                                           bool shuffle_samples) const {
+  std::vector<std::string> InputSetLoader::listClasses(const std::filesystem::path &path) {
+    if (not fs::exists(path))
+      throw std::runtime_error("InputSetLoader::listClasses: The input path does not exist");
+
+    std::vector<std::string> classes;
+    for (const auto &entry : sortedEntries(path)) {
+      if (entry.is_directory()) classes.push_back(entry.path().filename().string());
+    }
+    return classes;
+  }
+
+  InputSet InputSetLoader::loadWithClasses(const std::filesystem::path &path, bool shuffle_samples,
+                                           size_t shard_index, size_t shard_count) const {
     if (not fs::exists(path))
       throw std::runtime_error("InputSetLoader::loadWithClasses: The input path does not exist");
-    InputSet res(input_width, input_height);
+    InputSet res(input_width, input_height, storage);
 
     std::vector<InputFileMetadata> files;
-    std::vector<std::string> classes;
+    std::vector<std::string> classes = listClasses(path);
+    size_t next_id = 0;
 
     // Load the following layout :
     // <root_dir>
@@ -148,34 +649,35 @@ namespace control {
     //     <image_1> (class_id: 1, id: 2)
     //     <image_2> (class_id: 1, id: 3)
     //   ...
-    for (const auto &entry : fs::directory_iterator(path)) {
-      if (not entry.is_directory()) continue;
-
-      // Add a new class
-      classes.push_back(entry.path().filename().string());
-
+    for (size_t class_id = 0; class_id < classes.size(); class_id++) {
       size_t count = 0;
-      for (const auto &file : fs::directory_iterator(entry.path())) {
+      for (const auto &file : sortedEntries(path / classes[class_id])) {
         if (not file.is_regular_file()) continue;
 
-        files.push_back({file.path(), files.size(), static_cast<long>(classes.size() - 1)});
+        // Only keep the samples that belong to our shard
+        size_t id = next_id++;
+        if (id % shard_count == shard_index)
+          files.push_back({file.path(), id, static_cast<long>(class_id)});
         if (count++ > 16384) break;
       }
     }
 
     tscl::logger("Loading " + std::to_string(files.size()) + " samples with classes");
     // Load all the samples
-    loadFiles(res, tensor_size, preprocess_engine, postprocess_engine, files, shuffle_samples);
+    loadFiles(res, tensor_size, n_thread, preprocess_engine, postprocess_engine, files, classes,
+              shuffle_samples, cache_directory, device_preprocessing);
     // Update the classes with the new classes
     res.updateClasses(classes);
     return res;
   }
 
   InputSet InputSetLoader::loadWithoutClasses(const std::filesystem::path &path,
-                                              bool shuffle_samples) const {
-    InputSet res(input_width, input_height);
+                                              bool shuffle_samples, size_t shard_index,
+                                              size_t shard_count) const {
+    InputSet res(input_width, input_height, storage);
 
     std::vector<InputFileMetadata> files;
+    size_t next_id = 0;
 
     std::stack<std::filesystem::path> dirs;
     dirs.push(path);
@@ -193,13 +695,14 @@ namespace control {
       auto curr_dir = dirs.top();
       dirs.pop();
 
-      for (const auto &entry : fs::directory_iterator(curr_dir)) {
+      for (const auto &entry : sortedEntries(curr_dir)) {
         if (entry.is_directory()) {
           // Defer the subdirectory
           dirs.push(entry.path());
         } else if (entry.is_regular_file()) {
-          // Store metadata about this sample
-          files.push_back({entry.path(), files.size(), -1});
+          // Store metadata about this sample if it belongs to our shard
+          size_t id = next_id++;
+          if (id % shard_count == shard_index) files.push_back({entry.path(), id, -1});
         }
       }
     }
@@ -207,15 +710,25 @@ namespace control {
     tscl::logger("Loading " + std::to_string(files.size()) + " samples without classes");
 
     // Load all the samples
-    loadFiles(res, tensor_size, preprocess_engine, postprocess_engine, files, shuffle_samples);
+    loadFiles(res, tensor_size, n_thread, preprocess_engine, postprocess_engine, files, {},
+              shuffle_samples, cache_directory, device_preprocessing);
     return res;
   }
 
   InputSet InputSetLoader::load(const std::filesystem::path &path, bool load_classes,
                                 bool shuffle_samples) const {
+    return loadShard(path, load_classes, shuffle_samples, 0, 1);
+  }
+
+  InputSet InputSetLoader::loadShard(const std::filesystem::path &path, bool load_classes,
+                                     bool shuffle_samples, size_t shard_index,
+                                     size_t shard_count) const {
+    if (shard_count == 0 or shard_index >= shard_count)
+      throw std::invalid_argument("InputSetLoader::loadShard: Invalid shard index");
+
     tscl::logger("Loading input set from " + path.string(), tscl::Log::Information);
-    if (load_classes) return loadWithClasses(path, shuffle_samples);
+    if (load_classes) return loadWithClasses(path, shuffle_samples, shard_index, shard_count);
     else
-      return loadWithoutClasses(path, shuffle_samples);
+      return loadWithoutClasses(path, shuffle_samples, shard_index, shard_count);
   }
 }   // namespace control
\ No newline at end of file
@@ -16,31 +16,35 @@ namespace control {
 
   ModelEvaluation ModelEvaluator::evaluate(const nnet::Model &model,
                                            const InputSet &input_set) const {
-    size_t nclass = input_set.getClassCount();
+    return computeStatistics(computeConfusionMatrix(model, input_set));
+  }
+
+  math::Matrix<size_t> ModelEvaluator::computeConfusionMatrix(const nnet::Model &model,
+                                                              const InputSet &input_set) {
     math::Matrix<size_t> confusion_matrix(input_set.getClassCount(), input_set.getClassCount());
     confusion_matrix.fill(0);
 
-    // On huge input sets, the evaluation can take quite some time
-    // No reason not to use OpenMP here
-    // On huge input sets, the evaluation can take quite some time
-    // No reason not to use OpenMP here
-#pragma omp declare reduction (add_matrix : math::Matrix<size_t> : omp_out += omp_in ) initializer ( omp_priv(omp_orig) )
-#pragma omp parallel for reduction(add_matrix                                                      \
-                                   : confusion_matrix) schedule(dynamic) default(none)             \
-        shared(input_set, model, utils::cl_wrapper)                                                \
-                num_threads(1)   // 4 max thread to avoid overloading the GPU
-    for (auto &input : input_set) {
-      long true_class = input.getClass();
-      auto buf = model.predict(utils::cl_wrapper.getDefaultQueue(), input.getData());
-      size_t predicted_class = buf.imax();
-
-      confusion_matrix(predicted_class, true_class)++;
+    // Samples stored as bytes hold no float data, so we run the model on the tensors, which are
+    // normalized one at a time
+    auto &queue = utils::cl_wrapper.getDefaultQueue();
+    for (size_t t = 0, index = 0; t < input_set.getTensorCount(); t++) {
+      math::clFTensor inputs = input_set.getFloatTensor(t, queue);
+      for (size_t i = 0; i < inputs.getDepth(); i++, index++) {
+        long true_class = input_set.getClassOf(index);
+        auto buf = model.predict(queue, inputs[i]);
+        size_t predicted_class = buf.imax();
+
+        confusion_matrix(predicted_class, true_class)++;
+      }
     }
+    return confusion_matrix;
+  }
 
+  ModelEvaluation ModelEvaluator::computeStatistics(const math::Matrix<size_t> &confusion_matrix) {
+    size_t nclass = confusion_matrix.getRows();
 
     double avg_precision = 0, avg_recall = 0, avg_f1 = 0;
-    std::vector<double> precisions(input_set.getClassCount()), recalls(input_set.getClassCount()),
-            f1s(input_set.getClassCount());
+    std::vector<double> precisions(nclass), recalls(nclass), f1s(nclass);
 
 #pragma omp parallel for reduction(+: avg_precision, avg_recall, avg_f1) default(none) \
         shared(nclass, confusion_matrix, precisions, recalls, f1s) schedule(dynamic)
@@ -82,8 +86,15 @@ namespace control {
   ModelEvolutionTracker::ModelEvolutionTracker(std::filesystem::path output_path,
                                                nnet::Model &model,
                                                const TrainingCollection &training_collection)
-      : do_eval_on_test(false), model(&model), output_path(std::move(output_path)),
-        training_collection(&training_collection) {
+      : ModelEvolutionTracker(std::move(output_path), model, training_collection,
+                              std::make_unique<ModelEvaluator>()) {}
+
+  ModelEvolutionTracker::ModelEvolutionTracker(std::filesystem::path output_path,
+                                               nnet::Model &model,
+                                               const TrainingCollection &training_collection,
+                                               std::unique_ptr<ModelEvaluator> evaluator)
+      : do_eval_on_test(false), model(&model), evaluator(std::move(evaluator)),
+        output_path(std::move(output_path)), training_collection(&training_collection) {
     if (not fs::exists(this->output_path)) fs::create_directories(this->output_path);
     setupStreams(eval_set_avg_output_streams, eval_set_output_streams, "eval");
   }
@@ -135,11 +146,11 @@ namespace control {
 
   ModelEvaluation ModelEvolutionTracker::evaluate() {
     ModelEvaluation evaluation =
-            evaluator.evaluate(*model, training_collection->getEvaluationSet());
+            evaluator->evaluate(*model, training_collection->getEvaluationSet());
     writeToStreams(evaluation, eval_set_avg_output_streams, eval_set_output_streams);
 
     if (do_eval_on_test) {
-      evaluation = evaluator.evaluate(*model, training_collection->getTrainingSet());
+      evaluation = evaluator->evaluate(*model, training_collection->getTrainingSet());
       writeToStreams(evaluation, training_set_avg_output_streams, training_set_output_streams);
     }
     epoch++;
@@ -152,6 +163,9 @@ namespace control {
 
   void ModelEvolutionTracker::writeToStreams(ModelEvaluation &eval, ClassOutputStreams &avg_streams,
                                              std::vector<ClassOutputStreams> &streams) const {
+    // The process did not receive the results of a distributed evaluation
+    if (eval.f1score.empty()) return;
+
     if (eval.f1score.size() != streams.size())
       throw std::runtime_error("ModelEvaluation::writeToStreams: size mismatch");
 
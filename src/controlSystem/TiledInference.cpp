@@ -0,0 +1,224 @@
+#include "TiledInference.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace control {
+
+  namespace {
+    /**
+     * @brief A batch of tiles being extracted on the device
+     */
+    struct TileBatch {
+      size_t first_tile = 0;
+      math::clFTensor tiles;
+      cl::Event extracted;
+    };
+
+    /**
+     * @brief Waits for the commands of a queue when leaving a scope, so that no command keeps
+     * using host memory or buffers that are released, even if an exception is thrown
+     */
+    class QueueFinisher {
+    public:
+      explicit QueueFinisher(cl::CommandQueue &queue) : queue(queue) {}
+      QueueFinisher(const QueueFinisher &other) = delete;
+      QueueFinisher &operator=(const QueueFinisher &other) = delete;
+
+      ~QueueFinisher() {
+        // Destructors must not throw, the error is already reported if we are unwinding
+        try {
+          queue.finish();
+        } catch (...) {}
+      }
+
+    private:
+      cl::CommandQueue &queue;
+    };
+  }   // namespace
+
+  TiledInference::TiledInference(const nnet::Model &model, size_t tile_width, size_t tile_height,
+                                 size_t stride_x, size_t stride_y, size_t batch_size)
+      : model(&model), tile_width(tile_width), tile_height(tile_height), stride_x(stride_x),
+        stride_y(stride_y), batch_size(batch_size) {
+    if (tile_width == 0 or tile_height == 0 or stride_x == 0 or stride_y == 0 or batch_size == 0)
+      throw std::invalid_argument("TiledInference::TiledInference: Null tile size, stride or batch "
+                                  "size");
+    // Pixels between two tiles would not be covered by any of them
+    if (stride_x > tile_width or stride_y > tile_height)
+      throw std::invalid_argument("TiledInference::TiledInference: The stride is larger than a "
+                                  "tile");
+  }
+
+  std::vector<size_t> TiledInference::tileOrigins(size_t size, size_t tile, size_t stride) {
+    if (tile == 0 or stride == 0)
+      throw std::invalid_argument("TiledInference::tileOrigins: Null tile size or stride");
+    if (size < tile) return {};
+    std::vector<size_t> res;
+    for (size_t origin = 0; origin + tile <= size; origin += stride) res.push_back(origin);
+    // Align a last tile on the border if the stride does not fall on it
+    if (res.back() + tile < size) res.push_back(size - tile);
+    return res;
+  }
+
+  math::FloatMatrix TiledInference::predictTiles(const image::GrayscaleImage &image,
+                                                 cl::CommandQueue &queue, float factor) const {
+    const size_t width = image.getWidth(), height = image.getHeight();
+    if (width < tile_width or height < tile_height)
+      throw std::invalid_argument("TiledInference::predictTiles: The image is smaller than a tile");
+
+    std::vector<size_t> x_origins = tileOrigins(width, tile_width, stride_x);
+    std::vector<size_t> y_origins = tileOrigins(height, tile_height, stride_y);
+    const size_t n_tiles = x_origins.size() * y_origins.size();
+    std::vector<cl_uint> x_values(x_origins.begin(), x_origins.end());
+    std::vector<cl_uint> y_values(y_origins.begin(), y_origins.end());
+
+    cl::Context context = utils::cl_wrapper.getContext();
+    cl::Buffer x_buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                        x_values.size() * sizeof(cl_uint), x_values.data());
+    cl::Buffer y_buffer(context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR,
+                        y_values.size() * sizeof(cl_uint), y_values.data());
+
+    // The image is uploaded by bands on its own queue: a row of tiles only waits for the rows of
+    // pixels it covers
+    cl::CommandQueue transfer_queue(context, queue.getInfo<CL_QUEUE_DEVICE>());
+    QueueFinisher transfer_finisher(transfer_queue);
+    cl::Buffer pixels(context, CL_MEM_READ_ONLY, image.getSize());
+    std::vector<cl::Event> band_uploaded(y_origins.size());
+    size_t uploaded_rows = 0;
+    for (size_t row = 0; row < y_origins.size(); row++) {
+      const size_t end = y_origins[row] + tile_height;
+      transfer_queue.enqueueWriteBuffer(pixels, CL_FALSE, uploaded_rows * width,
+                                        (end - uploaded_rows) * width,
+                                        image.begin() + uploaded_rows * width, nullptr,
+                                        &band_uploaded[row]);
+      uploaded_rows = end;
+    }
+    transfer_queue.flush();
+
+    auto extract = [&](size_t first_tile) {
+      TileBatch batch;
+      batch.first_tile = first_tile;
+      const size_t count = std::min(batch_size, n_tiles - first_tile);
+      batch.tiles = math::clFTensor(tile_width, tile_height, count);
+
+      cl::Kernel kernel =
+              utils::cl_wrapper.getKernels().getKernel("Tiling.cl", "extractTiles");
+      kernel.setArg(0, pixels);
+      kernel.setArg(1, (cl_ulong) width);
+      kernel.setArg(2, x_buffer);
+      kernel.setArg(3, y_buffer);
+      kernel.setArg(4, (cl_ulong) x_origins.size());
+      kernel.setArg(5, (cl_ulong) first_tile);
+      kernel.setArg(6, batch.tiles.getBuffer());
+      kernel.setArg(7, (cl_ulong) batch.tiles.getOffsetInFloats());
+      kernel.setArg(8, (cl_ulong) tile_width);
+      kernel.setArg(9, (cl_ulong) tile_height);
+      kernel.setArg(10, factor);
+      // Bands are uploaded in order, the last row of tiles of the batch is the last one to wait for
+      std::vector<cl::Event> wait = {band_uploaded[(first_tile + count - 1) / x_origins.size()]};
+      queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                 cl::NDRange(tile_width, tile_height, count), cl::NullRange,
+                                 &wait, &batch.extracted);
+      queue.flush();
+      return batch;
+    };
+
+    math::FloatMatrix res;
+    // The outputs are read asynchronously into res, the queue must be done with it before it is
+    // released
+    QueueFinisher finisher(queue);
+    TileBatch current = extract(0);
+    while (current.first_tile < n_tiles) {
+      const size_t next_tile = current.first_tile + current.tiles.getDepth();
+      // The next batch is extracted while the model runs on the current one. Models may run on
+      // their own queue, so we wait for the extraction explicitly
+      TileBatch next;
+      next.first_tile = n_tiles;
+      if (next_tile < n_tiles) next = extract(next_tile);
+      current.extracted.wait();
+
+      math::clFTensor output = model->predict(queue, current.tiles);
+      const size_t output_size = output.getRows() * output.getCols();
+      if (res.getSize() == 0) res = math::FloatMatrix(n_tiles, output_size);
+      queue.enqueueReadBuffer(output.getBuffer(), CL_FALSE,
+                              output.getOffsetInFloats() * sizeof(float), output.sizeInBytes(),
+                              res.getData() + current.first_tile * output_size);
+      current = std::move(next);
+    }
+
+    queue.finish();
+    return res;
+  }
+
+  math::FloatMatrix TiledInference::predictHeatmap(const image::GrayscaleImage &image,
+                                                   size_t class_index, cl::CommandQueue &queue,
+                                                   float factor) const {
+    math::FloatMatrix scores = predictTiles(image, queue, factor);
+    return averageTiles(scores, class_index, image.getWidth(), image.getHeight(), tile_width,
+                        tile_height, stride_x, stride_y);
+  }
+
+  math::FloatMatrix TiledInference::averageTiles(const math::FloatMatrix &scores,
+                                                 size_t class_index, size_t width, size_t height,
+                                                 size_t tile_width, size_t tile_height,
+                                                 size_t stride_x, size_t stride_y) {
+    if (class_index >= scores.getCols())
+      throw std::invalid_argument("TiledInference::averageTiles: The model has " +
+                                  std::to_string(scores.getCols()) + " outputs");
+    if (stride_x > tile_width or stride_y > tile_height)
+      throw std::invalid_argument("TiledInference::averageTiles: The stride is larger than a "
+                                  "tile");
+
+    std::vector<size_t> x_origins = tileOrigins(width, tile_width, stride_x);
+    std::vector<size_t> y_origins = tileOrigins(height, tile_height, stride_y);
+    if (x_origins.empty() or y_origins.empty() or
+        scores.getRows() != x_origins.size() * y_origins.size())
+      throw std::invalid_argument("TiledInference::averageTiles: The scores do not match the "
+                                  "tiles of the image");
+
+    // Each tile adds its score to its area of a difference array, which is then integrated. This
+    // costs one pass over the image instead of one pass per tile
+    std::vector<double> sums((width + 1) * (height + 1), 0.0);
+    std::vector<double> counts((width + 1) * (height + 1), 0.0);
+    auto add = [&](size_t x, size_t y, double score, double count) {
+      sums[y * (width + 1) + x] += score;
+      counts[y * (width + 1) + x] += count;
+    };
+    for (size_t ty = 0; ty < y_origins.size(); ty++) {
+      for (size_t tx = 0; tx < x_origins.size(); tx++) {
+        const double score = scores(ty * x_origins.size() + tx, class_index);
+        const size_t x0 = x_origins[tx], y0 = y_origins[ty];
+        const size_t x1 = x0 + tile_width, y1 = y0 + tile_height;
+        add(x0, y0, score, 1);
+        add(x1, y0, -score, -1);
+        add(x0, y1, -score, -1);
+        add(x1, y1, score, 1);
+      }
+    }
+
+    math::FloatMatrix res(height, width);
+    for (size_t y = 0; y < height; y++) {
+      for (size_t x = 0; x < width; x++) {
+        const size_t i = y * (width + 1) + x;
+        if (x > 0) {
+          sums[i] += sums[i - 1];
+          counts[i] += counts[i - 1];
+        }
+        if (y > 0) {
+          sums[i] += sums[i - width - 1];
+          counts[i] += counts[i - width - 1];
+        }
+        if (x > 0 and y > 0) {
+          sums[i] -= sums[i - width - 2];
+          counts[i] -= counts[i - width - 2];
+        }
+        // Every pixel is covered by at least one tile
+        res(y, x) = (float) (sums[i] / counts[i]);
+      }
+    }
+    return res;
+  }
+
+}   // namespace control
@@ -7,8 +7,8 @@ namespace control {
     training_targets.clear();
     size_t nclass = training_set.getClasses().size();
 
-    for (size_t sample_index = 0; auto &tensor : training_set.getTensors()) {
-      size_t size = tensor.getDepth();
+    for (size_t sample_index = 0, t = 0; t < training_set.getTensorCount(); t++) {
+      size_t size = training_set.getTensorDepth(t);
       math::clFTensor buf(nclass, 1, size);
 
       for (size_t j = 0; j < size; j++) {
@@ -27,6 +27,8 @@ namespace control {
     res.reserve(npart);
 
     const auto &dataset = training_set;
+    if (dataset.getStorage() != InputStorage::float32)
+      throw std::runtime_error("TrainingCollection::splitTrainingSet: Not supported by uint8 sets");
 
     size_t tensor_per_part = dataset.getTensorCount() / npart;
     size_t tensor_remainder = dataset.getTensorCount() % npart;
@@ -11,9 +11,11 @@ namespace control {
   TrainingCollection TrainingCollectionLoader::load(const std::filesystem::path &path) {
     TrainingCollection res(input_set_loader.getInputWidth(), input_set_loader.getInputHeight());
 
+    input_set_loader.setStorage(training_storage);
     res.training_set = input_set_loader.load(path / "train", /*load_classes*/ true,
                                              /* shuffle samples */ true);
 
+    input_set_loader.setStorage(InputStorage::float32);
     res.eval_set = input_set_loader.load(path / "eval", /*load_classes*/ true,
                                          /* shuffle samples */ true);
 
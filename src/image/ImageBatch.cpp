@@ -0,0 +1,74 @@
+#include "ImageBatch.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace image {
+
+  ImageBatch::ImageBatch(size_t width, size_t height, size_t count)
+      : width(width), height(height), count(count) {
+    if (getSize() == 0) return;
+    storage = std::make_unique<grayscale_t[]>(getSize());
+    data = storage.get();
+  }
+
+  ImageBatch ImageBatch::view(grayscale_t *data, size_t width, size_t height, size_t count) {
+    ImageBatch res;
+    res.data = data;
+    res.width = width;
+    res.height = height;
+    res.count = count;
+    return res;
+  }
+
+  ImageBatch &ImageBatch::operator=(ImageBatch &&other) noexcept {
+    if (this == &other) return *this;
+
+    storage = std::move(other.storage);
+    data = other.data;
+    width = other.width;
+    height = other.height;
+    count = other.count;
+
+    other.data = nullptr;
+    other.width = 0;
+    other.height = 0;
+    other.count = 0;
+    return *this;
+  }
+
+  grayscale_t *ImageBatch::getImage(size_t i) {
+    if (i >= count) throw std::out_of_range("ImageBatch::getImage: Index out of range");
+    return data + i * getImageSize();
+  }
+
+  const grayscale_t *ImageBatch::getImage(size_t i) const {
+    if (i >= count) throw std::out_of_range("ImageBatch::getImage: Index out of range");
+    return data + i * getImageSize();
+  }
+
+  GrayscaleImage ImageBatch::getImageCopy(size_t i) const {
+    const grayscale_t *src = getImage(i);
+    GrayscaleImage res(width, height);
+    std::copy(src, src + getImageSize(), res.getData());
+    return res;
+  }
+
+  void ImageBatch::setImage(size_t i, const GrayscaleImage &image) {
+    if (image.getWidth() != width or image.getHeight() != height)
+      throw std::invalid_argument("ImageBatch::setImage: The image does not have the size of the "
+                                  "batch");
+    std::copy(image.begin(), image.end(), getImage(i));
+  }
+
+  std::vector<double> ImageBatch::createRatioHistogram(size_t i) const {
+    const grayscale_t *src = getImage(i);
+    // Same computation as GrayscaleImage::createRatioHistogram(), so that both give the same ratios
+    double increment_value = 1.0 / ((double) getImageSize());
+    std::vector<double> histogram(nb_colors);
+    std::for_each(src, src + getImageSize(),
+                  [&histogram, increment_value](auto e) { histogram[e] += increment_value; });
+    return histogram;
+  }
+
+}   // namespace image
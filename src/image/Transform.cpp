@@ -2,6 +2,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <math.h>
@@ -18,91 +20,218 @@ namespace image::transform {
 
   namespace filtering_subfunctions {
 
-    float gaussian2D(float x_distance, float y_distance) {
-      float sigma = 1.84f;
-      return expf(-(x_distance * x_distance + y_distance * y_distance) / (2 * sigma * sigma)) *
-             (1 / (2 * M_PI * sigma * sigma));
+    constexpr float kGaussianSigma = 1.84f;
+    // Needs to be odd (2n+1)
+    constexpr size_t kGaussianDimension = 11;
+    // Images smaller than this are filtered on a single thread
+    constexpr size_t kParallelFilterThreshold = 256 * 256;
+
+    /**
+     * @brief Returns the normalized 1D gaussian of the given dimension. The 2D gaussian is the
+     * outer product of this kernel with itself
+     */
+    std::vector<float> gaussianKernel(size_t dimension) {
+      std::vector<float> kernel(dimension);
+      float half_d = std::floor(dimension / 2.0f);
+      for (size_t i = 0; i < dimension; i++) {
+        float distance = (float) i - half_d;
+        kernel[i] = expf(-(distance * distance) / (2 * kGaussianSigma * kGaussianSigma));
+      }
+      float sum = std::accumulate(kernel.begin(), kernel.end(), 0.0f);
+      for (auto &w : kernel) w /= sum;
+      return kernel;
     }
 
-    std::vector<float> gaussianFilter(size_t dimension) {
-      std::vector<float> filter(dimension * dimension);
-      int half_d = std::floor(dimension / 2.0f);
-      for (int y = 0; y < dimension; y++) {
-        for (int x = 0; x <= dimension; x++) {
-          float x_dist_from_center = fabs(x - half_d);
-          float y_dist_from_center = fabs(y - half_d);
-          filter[y * dimension + x] = gaussian2D(x_dist_from_center, y_dist_from_center);
+    /**
+     * @brief Convolves each row of the source with the kernel, replicating the border pixels.
+     * The rows are padded in a scratch buffer, so that the inner loop is branchless and
+     * contiguous
+     */
+    void horizontalPass(const grayscale_t *src, float *dst, size_t width, size_t height,
+                        const std::vector<float> &kernel) {
+      const size_t half_d = kernel.size() / 2;
+#pragma omp parallel if (width * height >= kParallelFilterThreshold)
+      {
+        std::vector<float> padded(width + 2 * half_d);
+#pragma omp for
+        for (size_t y = 0; y < height; y++) {
+          const grayscale_t *src_row = src + y * width;
+          std::fill_n(padded.begin(), half_d, (float) src_row[0]);
+          std::copy(src_row, src_row + width, padded.begin() + half_d);
+          std::fill_n(padded.begin() + half_d + width, half_d, (float) src_row[width - 1]);
+
+          float *dst_row = dst + y * width;
+          std::fill_n(dst_row, width, 0.0f);
+          for (size_t k = 0; k < kernel.size(); k++) {
+            const float w = kernel[k];
+            const float *in = padded.data() + k;
+            for (size_t x = 0; x < width; x++) dst_row[x] += w * in[x];
+          }
         }
       }
-      return filter;
     }
 
-    float applyFilterAt(const GrayscaleImage &img, size_t orig_x, size_t orig_y,
-                        std::vector<float> const &filter, size_t dimension) {
-      float sum = .0f;
-      size_t half_dimension = std::floor(dimension / 2.0);
-      size_t filter_idx = 0;
-      for (size_t y = 0; y < dimension; y++)
-        for (size_t x = 0; x < dimension; x++)
-          sum += (float) img(orig_x + x - half_dimension, orig_y + y - half_dimension) *
-                 filter[filter_idx++];
-      return sum;
+    /**
+     * @brief Convolves each column of the source with the kernel, replicating the border rows.
+     * Whole rows are accumulated at once, so that the inner loop stays contiguous
+     */
+    void verticalPass(const float *src, grayscale_t *dst, size_t width, size_t height,
+                      const std::vector<float> &kernel) {
+      const auto half_d = (ptrdiff_t) (kernel.size() / 2);
+      const auto last_row = (ptrdiff_t) height - 1;
+#pragma omp parallel if (width * height >= kParallelFilterThreshold)
+      {
+        std::vector<float> acc(width);
+#pragma omp for
+        for (size_t y = 0; y < height; y++) {
+          std::fill(acc.begin(), acc.end(), 0.0f);
+          for (size_t k = 0; k < kernel.size(); k++) {
+            ptrdiff_t src_y = std::clamp((ptrdiff_t) (y + k) - half_d, (ptrdiff_t) 0, last_row);
+            const float w = kernel[k];
+            const float *in = src + src_y * width;
+            for (size_t x = 0; x < width; x++) acc[x] += w * in[x];
+          }
+
+          grayscale_t *dst_row = dst + y * width;
+          for (size_t x = 0; x < width; x++)
+            dst_row[x] = (grayscale_t) std::min(acc[x] + 0.5f, (float) max_brightness);
+        }
+      }
     }
   }   // namespace filtering_subfunctions
 
 
-  float _get2DVectorNorm(size_t orig_x, size_t orig_y, size_t dest_x, size_t dest_y) {
-    size_t xdist = dest_x - orig_x;
-    size_t ydist = dest_y - orig_y;
-    return sqrtf(xdist * xdist + ydist * ydist);
-  }
+  namespace resize_subfunctions {
+
+    // Fixed-point precision of the resampling weights, which sum to 1 << kWeightBits
+    constexpr int kWeightBits = 14;
+    // Extra bits of precision kept between the horizontal and the vertical pass
+    constexpr int kIntermediateBits = 8;
+    // Images smaller than this are resized on a single thread
+    constexpr size_t kParallelResizeThreshold = 256 * 256;
+
+    /**
+     * @brief The source pixels contributing to each output pixel along one axis. Output pixel i
+     * is the weighted sum of the taps source pixels starting at first[i]
+     */
+    struct Contributions {
+      size_t taps = 0;
+      std::vector<size_t> first;
+      // taps weights per output pixel, in fixed-point
+      std::vector<int32_t> weights;
+    };
+
+    /**
+     * @brief Converts floating-point weights to fixed-point weights summing exactly to
+     * 1 << kWeightBits. The rounding error is given to the largest weight
+     */
+    void quantizeWeights(const std::vector<double> &weights, int32_t *dst) {
+      int32_t sum = 0;
+      size_t largest = 0;
+      for (size_t k = 0; k < weights.size(); k++) {
+        dst[k] = (int32_t) std::lround(weights[k] * (1 << kWeightBits));
+        sum += dst[k];
+        if (weights[k] > weights[largest]) largest = k;
+      }
+      dst[largest] += (1 << kWeightBits) - sum;
+    }
 
+    /**
+     * @brief Computes the contributions of a resize from src_size to dst_size pixels. Reductions
+     * average the area covered by each output pixel, which avoids aliasing on large factors.
+     * Enlargements use a linear interpolation mapping the borders onto each other, as before
+     */
+    Contributions computeContributions(size_t src_size, size_t dst_size) {
+      Contributions res;
+      res.first.resize(dst_size);
+
+      if (src_size > dst_size) {
+        const double scale = (double) src_size / dst_size;
+        res.taps = std::min<size_t>((size_t) std::ceil(scale) + 1, src_size);
+        res.weights.assign(dst_size * res.taps, 0);
+        std::vector<double> weights(res.taps);
+        for (size_t i = 0; i < dst_size; i++) {
+          const double begin = i * scale, end = (i + 1) * scale;
+          // Shift the window to the left if it would go past the last source pixel
+          const size_t first = std::min((size_t) begin, src_size - res.taps);
+          for (size_t k = 0; k < res.taps; k++) {
+            const double pixel_begin = (double) (first + k), pixel_end = pixel_begin + 1;
+            weights[k] = std::max(0.0, std::min(end, pixel_end) - std::max(begin, pixel_begin)) /
+                         scale;
+          }
+          res.first[i] = first;
+          quantizeWeights(weights, res.weights.data() + i * res.taps);
+        }
+        return res;
+      }
 
-  /**
-   * @brief Sub-function for resizing (stable on both up-scaling and down-scaling, but not really
-   * efficient on up-scaling)
-   *
-   * @param factors Pair: (source.input_width-1)/(dest.input_width-1) ; (source.input_height-1)/(dest.input_height-1)
-   * @param source source image
-   * @param dest destination image
-   */
-  void downscaling(std::pair<double, double> factors, GrayscaleImage const &source,
-                   GrayscaleImage &dest) {
-    for (size_t x = 0; x < dest.getWidth(); x++) {
-      size_t source_x = std::round(x * factors.first);
-      dest(x, 0) = source(source_x, 0);                                           // top row
-      dest(x, dest.getHeight() - 1) = source(source_x, source.getHeight() - 1);   // bottom row
-    }
-
-    for (size_t y = 0; y < dest.getHeight(); y++) {
-      size_t source_y = std::round(y * factors.second);
-      dest(0, y) = source(0, source_y);                                         // left col
-      dest(dest.getWidth() - 1, y) = source(source.getWidth() - 1, source_y);   // right col
-    }
-
-    for (size_t x = 1; x < dest.getWidth() - 1; x++) {
-      for (size_t y = 1; y < dest.getHeight() - 1; y++) {
-        size_t orig_left_x = (size_t) std::floor(factors.first * x);
-        size_t orig_right_x = (size_t) std::ceil(factors.first * x);
-        size_t orig_up_y = (size_t) std::floor(factors.second * y);
-        size_t orig_down_y = (size_t) std::ceil(factors.second * y);
-        float top_left_norm = _get2DVectorNorm(x, y, orig_left_x, orig_up_y);
-        float top_right_norm = _get2DVectorNorm(x, y, orig_right_x, orig_up_y);
-        float bottom_left_norm = _get2DVectorNorm(x, y, orig_left_x, orig_down_y);
-        float bottom_right_norm = _get2DVectorNorm(x, y, orig_right_x, orig_down_y);
-
-        float cumul_norm = 2 * (top_left_norm + bottom_right_norm);
-
-        grayscale_t mean =
-                (grayscale_t) std::round((source(orig_left_x, orig_up_y) * top_left_norm +
-                                          source(orig_left_x, orig_down_y) * bottom_left_norm +
-                                          source(orig_right_x, orig_up_y) * top_right_norm +
-                                          source(orig_right_x, orig_down_y) * bottom_right_norm) /
-                                         (cumul_norm));
-        dest(x, y) = mean;
+      res.taps = std::min<size_t>(2, src_size);
+      res.weights.assign(dst_size * res.taps, 0);
+      const double factor = dst_size > 1 ? (double) (src_size - 1) / (dst_size - 1) : 0.0;
+      std::vector<double> weights(res.taps);
+      for (size_t i = 0; i < dst_size; i++) {
+        const double position = i * factor;
+        const size_t first = std::min((size_t) position, src_size - res.taps);
+        const double fraction = position - first;
+        weights[0] = 1.0 - fraction;
+        if (res.taps > 1) weights[1] = fraction;
+        res.first[i] = first;
+        quantizeWeights(weights, res.weights.data() + i * res.taps);
+      }
+      return res;
+    }
+
+    /**
+     * @brief Resamples every row of the source, keeping kIntermediateBits of extra precision
+     */
+    void horizontalPass(const GrayscaleImage &source, std::vector<uint16_t> &dst,
+                        const Contributions &columns, size_t dst_width) {
+      const size_t src_width = source.getWidth(), src_height = source.getHeight();
+      constexpr int shift = kWeightBits - kIntermediateBits;
+      const grayscale_t *src = source.getData();
+#pragma omp parallel for if (src_width * src_height >= kParallelResizeThreshold)
+      for (size_t y = 0; y < src_height; y++) {
+        const grayscale_t *src_row = src + y * src_width;
+        uint16_t *dst_row = dst.data() + y * dst_width;
+        for (size_t x = 0; x < dst_width; x++) {
+          const grayscale_t *in = src_row + columns.first[x];
+          const int32_t *weights = columns.weights.data() + x * columns.taps;
+          int32_t acc = 0;
+          for (size_t k = 0; k < columns.taps; k++) acc += weights[k] * in[k];
+          dst_row[x] = (uint16_t) ((acc + (1 << (shift - 1))) >> shift);
+        }
       }
     }
-  }
+
+    /**
+     * @brief Resamples every column of the intermediate image. Whole rows are accumulated at once,
+     * so that the inner loop stays contiguous
+     */
+    void verticalPass(const std::vector<uint16_t> &src, GrayscaleImage &dest,
+                      const Contributions &rows) {
+      const size_t width = dest.getWidth(), height = dest.getHeight();
+      constexpr int shift = kWeightBits + kIntermediateBits;
+      grayscale_t *dst = dest.getData();
+#pragma omp parallel if (width * height * rows.taps >= kParallelResizeThreshold)
+      {
+        std::vector<int32_t> acc(width);
+#pragma omp for
+        for (size_t y = 0; y < height; y++) {
+          std::fill(acc.begin(), acc.end(), 0);
+          for (size_t k = 0; k < rows.taps; k++) {
+            const int32_t w = rows.weights[y * rows.taps + k];
+            const uint16_t *in = src.data() + (rows.first[y] + k) * width;
+            for (size_t x = 0; x < width; x++) acc[x] += w * in[x];
+          }
+
+          grayscale_t *dst_row = dst + y * width;
+          for (size_t x = 0; x < width; x++)
+            dst_row[x] = (grayscale_t) std::min<int32_t>((acc[x] + (1 << (shift - 1))) >> shift,
+                                                         max_brightness);
+        }
+      }
+    }
+  }   // namespace resize_subfunctions
 
   bool Crop::transform(GrayscaleImage &image) const {
     if (orig_x < 0 || orig_y < 0 || width <= 0 || height <= 0) {
@@ -125,6 +254,11 @@ namespace image::transform {
     return true;
   }
 
+  std::string Crop::getIdentifier() const {
+    return "crop(" + std::to_string(width) + "," + std::to_string(height) + "," +
+           std::to_string(orig_x) + "," + std::to_string(orig_y) + ")";
+  }
+
   bool Resize::transform(GrayscaleImage &image) const {
     if (width <= 0 || height <= 0) {
       throw std::invalid_argument("Resize can not be applied on this image: new dimensions needs "
@@ -132,48 +266,78 @@ namespace image::transform {
     } else if (height == image.getHeight() &&
                width == image.getWidth())   // Case where we don't need to resize the image.
       return true;
-    const image::GrayscaleImage source =
-            image;   // In order to modify the image ref, we first need to copy it.
-    image.setSize(width, height);
-    std::pair<double, double> factors((double) (source.getWidth() - 1) / (width - 1),
-                                      (double) (source.getHeight() - 1) / (height - 1));
-    // Works for both up & down scaling.
-    // A upscaling(...) function will be defined soon to enhance that particular case.
-    downscaling(factors, source, image);
+    if (image.getSize() == 0)
+      throw std::invalid_argument("Resize::transform: Cannot resize an empty image");
+    // The resize is separable: the rows are resampled first, since the source is usually much
+    // larger than the destination
+    auto columns = resize_subfunctions::computeContributions(image.getWidth(), width);
+    auto rows = resize_subfunctions::computeContributions(image.getHeight(), height);
+    std::vector<uint16_t> intermediate(image.getHeight() * width);
+    resize_subfunctions::horizontalPass(image, intermediate, columns, width);
+
+    GrayscaleImage res(width, height);
+    resize_subfunctions::verticalPass(intermediate, res, rows);
+    image = std::move(res);
     return true;
   }
 
-  bool Restriction::transform(GrayscaleImage &image) const {
-    unsigned compare_step = desired_step + 1;
-    std::for_each(image.begin(), image.end(), [compare_step](auto &e) {
-      unsigned modulo_value = (e % compare_step);
-      if (modulo_value != 0) { e -= modulo_value; }
-    });
+  std::string Resize::getIdentifier() const {
+    return "resize(" + std::to_string(width) + "," + std::to_string(height) + ")";
+  }
+
+  bool Transformation::transformBatch(ImageBatch &batch) const {
+    for (size_t i = 0; i < batch.getCount(); i++) {
+      GrayscaleImage image = batch.getImageCopy(i);
+      transform(image);
+      batch.setImage(i, image);
+    }
     return true;
   }
 
-  // TODO: Improve performance, really slow.
-  bool Filter::transform(GrayscaleImage &image) const {
-    size_t dimension = 11;   // Needs to be odd (2n+1)
-    size_t half_d = std::floor(dimension / 2.0);
-    std::vector<float> filter = filtering_subfunctions::gaussianFilter(dimension);
+  bool PointwiseTransformation::transformBatch(ImageBatch &batch) const {
+    if (not needsHistogram()) {
+      LookupTable lut = getLookupTable({});
+      std::for_each(batch.begin(), batch.end(), [&lut](auto &e) { e = lut[e]; });
+      return true;
+    }
+
+    for (size_t i = 0; i < batch.getCount(); i++) {
+      LookupTable lut = getLookupTable(batch.createRatioHistogram(i));
+      grayscale_t *image = batch.getImage(i);
+      std::for_each(image, image + batch.getImageSize(), [&lut](auto &e) { e = lut[e]; });
+    }
+    return true;
+  }
 
+  bool PointwiseTransformation::transform(GrayscaleImage &image) const {
+    LookupTable lut = getLookupTable(needsHistogram() ? image.createRatioHistogram()
+                                                      : std::vector<double>());
+    std::for_each(image.begin(), image.end(), [&lut](auto &e) { e = lut[e]; });
+    return true;
+  }
 
-    for (size_t y = half_d; y < image.getHeight() - half_d; y++)
-      for (size_t x = half_d; x < image.getWidth() - half_d; x++)
-        image(x, y) =
-                (grayscale_t) filtering_subfunctions::applyFilterAt(image, x, y, filter, dimension);
+  LookupTable Restriction::getLookupTable(const std::vector<double> &ratio_histogram) const {
+    size_t compare_step = desired_step + 1;
+    LookupTable res;
+    for (size_t i = 0; i < nb_colors; i++) res[i] = (grayscale_t) (i - i % compare_step);
+    return res;
+  }
 
-    for (size_t y = 0; y < image.getHeight(); y++) {
-      for (size_t x = 0; x < half_d; x++) image(x, y) = (grayscale_t) 0U;
-      for (size_t x = image.getWidth() - half_d; x < image.getWidth(); x++)
-        image(x, y) = (grayscale_t) 0U;
-    }
-    for (size_t x = half_d; x < image.getWidth() - half_d; x++) {
-      for (size_t y = 0; y < half_d; y++) image(x, y) = (grayscale_t) 0U;
-      for (size_t y = image.getHeight() - half_d; y < image.getHeight(); y++)
-        image(x, y) = (grayscale_t) 0U;
-    }
+  std::string Restriction::getIdentifier() const {
+    return "restriction(" + std::to_string(desired_step) + ")";
+  }
+
+  bool Filter::transform(GrayscaleImage &image) const {
+    const size_t width = image.getWidth(), height = image.getHeight();
+    if (width == 0 or height == 0) return true;
+
+    // The gaussian is separable: a horizontal pass into a scratch buffer followed by a vertical
+    // pass back into the image replaces the 2D convolution
+    std::vector<float> kernel =
+            filtering_subfunctions::gaussianKernel(filtering_subfunctions::kGaussianDimension);
+    std::vector<float> scratch(width * height);
+    filtering_subfunctions::horizontalPass(image.getData(), scratch.data(), width, height, kernel);
+    filtering_subfunctions::verticalPass(scratch.data(), image.getData(), width, height, kernel);
     return true;
   }
 
@@ -207,48 +371,46 @@ namespace image::transform {
   }
 
 
-  bool Equalize::transform(GrayscaleImage &image) const {
-    std::vector<double> ratio_histogram = image.createRatioHistogram();
-
-    std::vector<grayscale_t> associations(nb_colors);
+  LookupTable Equalize::getLookupTable(const std::vector<double> &ratio_histogram) const {
+    LookupTable res;
     double cumulated_ratios = 0;
     for (size_t i = 0; i < nb_colors; i++) {
       cumulated_ratios += ratio_histogram[i];
-      associations[i] = (grayscale_t) std::round(cumulated_ratios * max_brightness);
+      res[i] = (grayscale_t) std::round(cumulated_ratios * max_brightness);
     }
-
-    std::for_each(image.begin(), image.end(), [associations](auto &e) { e = associations[e]; });
-
-    return true;
+    return res;
   }
 
-  void binaryScalingByCap(GrayscaleImage &image, grayscale_t cap) {
-    std::for_each(image.begin(), image.end(), [cap](auto &e) { e = e <= cap ? 0U : 255U; });
-  }
+  namespace {
+    LookupTable binaryScalingByCap(grayscale_t cap) {
+      LookupTable res;
+      for (size_t i = 0; i < nb_colors; i++) res[i] = i <= cap ? 0U : 255U;
+      return res;
+    }
+  }   // namespace
 
-  bool BinaryScale::transform(GrayscaleImage &image) const {
+  LookupTable BinaryScale::getLookupTable(const std::vector<double> &ratio_histogram) const {
     float half_brightness = max_brightness / 2.0;
-    binaryScalingByCap(image, half_brightness);
-    return true;
+    return binaryScalingByCap(half_brightness);
   }
 
-  bool BinaryScaleByMedian::transform(GrayscaleImage &image) const {
-    std::vector<double> brightness_histogram = image.createRatioHistogram();
+  LookupTable
+  BinaryScaleByMedian::getLookupTable(const std::vector<double> &ratio_histogram) const {
     grayscale_t median_brightness = 254;
     double cumul = 0.0;
     for (size_t i = 0; i < max_brightness; i++) {
-      cumul += brightness_histogram[i];
+      cumul += ratio_histogram[i];
       if (cumul >= .5) {
         median_brightness = (grayscale_t) i;
         break;
       }
     }
-    binaryScalingByCap(image, median_brightness);
-    return true;
+    return binaryScalingByCap(median_brightness);
   }
 
-  bool Inversion::transform(GrayscaleImage &image) const {
-    std::for_each(image.begin(), image.end(), [](auto &e) { e = max_brightness - e; });
-    return true;
+  LookupTable Inversion::getLookupTable(const std::vector<double> &ratio_histogram) const {
+    LookupTable res;
+    for (size_t i = 0; i < nb_colors; i++) res[i] = (grayscale_t) (max_brightness - i);
+    return res;
   }
 }   // namespace image::transform
@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <numeric>
+#include <type_traits>
 
 #include "Transform.hpp"
 namespace image::transform {
@@ -62,6 +65,69 @@ namespace image::transform {
       return "_";
     }
 
+    using TransformIterator = std::vector<std::shared_ptr<Transformation>>::const_iterator;
+
+    const PointwiseTransformation *asPointwise(const std::shared_ptr<Transformation> &tr) {
+      return dynamic_cast<const PointwiseTransformation *>(tr.get());
+    }
+
+    bool needsHistogram(TransformIterator begin, TransformIterator end) {
+      return std::any_of(begin, end,
+                         [](const auto &tr) { return asPointwise(tr)->needsHistogram(); });
+    }
+
+    /**
+     * @brief Composes a run of pointwise transformations into a single lookup table. The histogram
+     * is only computed once: the histogram seen by each transformation is derived from it by
+     * remapping it through the previous tables
+     * @param histogram The ratio histogram of the image, only used if needsHistogram() is true
+     */
+    LookupTable composeRun(TransformIterator begin, TransformIterator end,
+                           std::vector<double> histogram) {
+      const bool needs_histogram = needsHistogram(begin, end);
+      LookupTable composed;
+      std::iota(composed.begin(), composed.end(), 0);
+      for (auto it = begin; it != end; ++it) {
+        const auto *tr = asPointwise(*it);
+        LookupTable lut =
+                tr->getLookupTable(tr->needsHistogram() ? histogram : std::vector<double>());
+        for (auto &e : composed) e = lut[e];
+
+        if (needs_histogram) {
+          std::vector<double> remapped(nb_colors, 0.0);
+          for (size_t i = 0; i < nb_colors; i++) remapped[lut[i]] += histogram[i];
+          histogram = std::move(remapped);
+        }
+      }
+      return composed;
+    }
+
+    void applyTable(const LookupTable &lut, grayscale_t *data, size_t size) {
+      for (size_t i = 0; i < size; i++) data[i] = lut[data[i]];
+    }
+
+    /**
+     * @brief Applies the transformations of the list in order, applying each run of pointwise
+     * transformations with apply_run
+     */
+    template<typename Image, typename RunFunction>
+    void applyAll(const std::vector<std::shared_ptr<Transformation>> &transformations,
+                  Image &image, RunFunction apply_run) {
+      for (auto it = transformations.begin(); it != transformations.end();) {
+        if (not asPointwise(*it)) {
+          if constexpr (std::is_same_v<Image, ImageBatch>) (*it)->transformBatch(image);
+          else
+            (*it)->transform(image);
+          ++it;
+          continue;
+        }
+        auto run_end = std::find_if(it, transformations.end(),
+                                    [](const auto &tr) { return not asPointwise(tr); });
+        apply_run(it, run_end);
+        it = run_end;
+      }
+    }
+
   }   // namespace
 
   void TransformEngine::loadFromFile(std::string const &fileName) {
@@ -96,13 +162,43 @@ namespace image::transform {
 
   GrayscaleImage TransformEngine::transform(GrayscaleImage const &image) const {
     GrayscaleImage copy = image;
-    for (const std::shared_ptr<Transformation> &tr : transformations) tr->transform(copy);
-
+    apply(copy);
     return copy;
   }
 
   void TransformEngine::apply(GrayscaleImage &image) const {
-    for (const std::shared_ptr<Transformation> &tr : transformations) tr->transform(image);
+    applyAll(transformations, image, [&](TransformIterator begin, TransformIterator end) {
+      auto lut = composeRun(begin, end,
+                            needsHistogram(begin, end) ? image.createRatioHistogram()
+                                                       : std::vector<double>());
+      applyTable(lut, image.getData(), image.getSize());
+    });
+  }
+
+  void TransformEngine::apply(ImageBatch &batch) const {
+    applyAll(transformations, batch, [&](TransformIterator begin, TransformIterator end) {
+      // Without histograms, the table is the same for every image
+      if (not needsHistogram(begin, end)) {
+        applyTable(composeRun(begin, end, {}), batch.getData(), batch.getSize());
+        return;
+      }
+      for (size_t i = 0; i < batch.getCount(); i++) {
+        auto lut = composeRun(begin, end, batch.createRatioHistogram(i));
+        applyTable(lut, batch.getImage(i), batch.getImageSize());
+      }
+    });
+  }
+
+  bool TransformEngine::isPointwise() const {
+    return std::all_of(transformations.begin(), transformations.end(),
+                       [](const auto &tr) { return asPointwise(tr) != nullptr; });
+  }
+
+  std::string TransformEngine::getIdentifier() const {
+    std::string res;
+    for (const std::shared_ptr<Transformation> &tr : transformations)
+      res += tr->getIdentifier() + ';';
+    return res;
   }
 
 }   // namespace image::transform
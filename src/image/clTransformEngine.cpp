@@ -0,0 +1,306 @@
+#include "clTransformEngine.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <type_traits>
+
+namespace image::transform {
+
+  namespace {
+    // Operations of buildLookupTables. Must match the definitions in Transform.cl
+    constexpr cl_int kStaticLut = 0;
+    constexpr cl_int kEqualize = 1;
+    constexpr cl_int kMedianBinaryScale = 2;
+
+    /**
+     * @brief Returns true if the transformation can be described to the device: either its lookup
+     * table does not depend on the image, or the device knows how to build it
+     */
+    bool isSupported(const Transformation &transformation) {
+      const auto *pointwise = dynamic_cast<const PointwiseTransformation *>(&transformation);
+      if (not pointwise) return false;
+      return not pointwise->needsHistogram() or dynamic_cast<const Equalize *>(pointwise) or
+             dynamic_cast<const BinaryScaleByMedian *>(pointwise);
+    }
+
+    /**
+     * @brief The operations building the lookup table of an image. Consecutive transformations
+     * that do not depend on the histogram are composed on the host into a single static table
+     */
+    struct LookupProgram {
+      std::vector<cl_int> ops;
+      // One table per operation, only meaningful for the static ones
+      std::vector<LookupTable> luts;
+      bool needs_histogram = false;
+    };
+
+    LookupTable identityTable() {
+      LookupTable res;
+      std::iota(res.begin(), res.end(), 0);
+      return res;
+    }
+
+    LookupProgram compile(const std::vector<std::shared_ptr<PointwiseTransformation>> &transforms) {
+      LookupProgram res;
+      for (const auto &tr : transforms) {
+        if (tr->needsHistogram()) {
+          res.ops.push_back(dynamic_cast<const Equalize *>(tr.get()) ? kEqualize
+                                                                      : kMedianBinaryScale);
+          res.luts.push_back(identityTable());
+          res.needs_histogram = true;
+          continue;
+        }
+
+        LookupTable lut = tr->getLookupTable({});
+        if (res.ops.empty() or res.ops.back() != kStaticLut) {
+          res.ops.push_back(kStaticLut);
+          res.luts.push_back(identityTable());
+        }
+        for (auto &e : res.luts.back()) e = lut[e];
+      }
+
+      if (res.ops.empty()) {
+        res.ops.push_back(kStaticLut);
+        res.luts.push_back(identityTable());
+      }
+      return res;
+    }
+
+    /**
+     * @brief The images of a batch packed in a single device buffer, along with their offsets and
+     * the geometry of the region to resize (see Transform.cl)
+     */
+    // Upper bound of the size of the device buffer holding the source images of a pack
+    constexpr size_t kMaxPackBytes = 128 * 1024 * 1024;
+
+    struct PackedImages {
+      cl::Buffer pixels, offsets, geometry;
+    };
+
+    template<typename T>
+    cl::Buffer makeReadOnlyBuffer(const std::vector<T> &values) {
+      return cl::Buffer(CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(T) * values.size(),
+                        const_cast<T *>(values.data()));
+    }
+  }   // namespace
+
+  clTransformEngine::clTransformEngine(size_t width, size_t height) : width(width), height(height) {
+    if (width == 0 or height == 0)
+      throw std::invalid_argument("clTransformEngine: The output dimensions must be non-zero");
+  }
+
+  void clTransformEngine::setCrop(size_t new_crop_width, size_t new_crop_height,
+                                  size_t new_orig_x, size_t new_orig_y) {
+    if (new_crop_width == 0 or new_crop_height == 0)
+      throw std::invalid_argument("clTransformEngine::setCrop: The crop must be non-empty");
+    crop = true;
+    crop_width = new_crop_width;
+    crop_height = new_crop_height;
+    orig_x = new_orig_x;
+    orig_y = new_orig_y;
+  }
+
+  void clTransformEngine::addTransformation(
+          std::shared_ptr<PointwiseTransformation> transformation) {
+    if (not isSupported(*transformation))
+      throw std::invalid_argument("clTransformEngine::addTransformation: " +
+                                  transformation->getIdentifier() +
+                                  " cannot be applied on the device");
+    transformations.push_back(std::move(transformation));
+  }
+
+  void clTransformEngine::addTransformations(const TransformEngine &engine) {
+    if (not supports(engine))
+      throw std::invalid_argument("clTransformEngine::addTransformations: The engine contains "
+                                  "transformations that cannot be applied on the device");
+    for (const auto &tr : engine.getTransformations())
+      transformations.push_back(std::dynamic_pointer_cast<PointwiseTransformation>(tr));
+  }
+
+  bool clTransformEngine::supports(const TransformEngine &engine) {
+    const auto &list = engine.getTransformations();
+    return std::all_of(list.begin(), list.end(), [](const auto &tr) { return isSupported(*tr); });
+  }
+
+  math::clFTensor clTransformEngine::transform(const std::vector<GrayscaleImage> &images,
+                                               cl::CommandQueue &queue, float factor) const {
+    // We need to return if the size is 0 else OpenCL will throw
+    if (images.empty()) return {};
+    math::clFTensor res(width, height, images.size());
+    transformImpl(images, res, queue, factor);
+    return res;
+  }
+
+  void clTransformEngine::transform(const std::vector<GrayscaleImage> &images,
+                                    math::clFTensor &output, cl::CommandQueue &queue,
+                                    float factor) const {
+    transformImpl(images, output, queue, factor);
+  }
+
+  math::clU8Tensor clTransformEngine::transformToBytes(const std::vector<GrayscaleImage> &images,
+                                                       cl::CommandQueue &queue) const {
+    if (images.empty()) return {};
+    math::clU8Tensor res(width, height, images.size());
+    transformImpl(images, res, queue, 1.0f);
+    return res;
+  }
+
+  void clTransformEngine::transformToBytes(const std::vector<GrayscaleImage> &images,
+                                           math::clU8Tensor &output,
+                                           cl::CommandQueue &queue) const {
+    transformImpl(images, output, queue, 1.0f);
+  }
+
+  template<class Tensor>
+  void clTransformEngine::transformImpl(const std::vector<GrayscaleImage> &images, Tensor &output,
+                                        cl::CommandQueue &queue, float factor) const {
+    if (images.empty()) return;
+    if (output.getRows() != width or output.getCols() != height or
+        output.getDepth() != images.size())
+      throw std::invalid_argument("clTransformEngine::transform: The output tensor does not match "
+                                  "the images and the output dimensions");
+
+    // The images of a pack are copied to a single device buffer, which cannot be larger than the
+    // maximum allocation size of the device
+    const size_t max_alloc =
+            queue.getInfo<CL_QUEUE_DEVICE>().getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+    const size_t pack_limit = std::min<size_t>(kMaxPackBytes, max_alloc);
+
+    size_t begin = 0, pack_size = 0;
+    for (size_t i = 0; i < images.size(); i++) {
+      if (images[i].getSize() > max_alloc)
+        throw std::invalid_argument("clTransformEngine::transform: Image " + std::to_string(i) +
+                                    " is larger than the maximum allocation size of the device");
+      if (i > begin and pack_size + images[i].getSize() > pack_limit) {
+        Tensor pack = output.slice(begin, i);
+        transformPack(images, begin, pack, queue, factor);
+        begin = i;
+        pack_size = 0;
+      }
+      pack_size += images[i].getSize();
+    }
+    if (begin < images.size()) {
+      Tensor pack = output.slice(begin, images.size());
+      transformPack(images, begin, pack, queue, factor);
+    }
+  }
+
+  template<class Tensor>
+  void clTransformEngine::transformPack(const std::vector<GrayscaleImage> &images, size_t first,
+                                        Tensor &res, cl::CommandQueue &queue, float factor) const {
+    constexpr bool to_bytes = std::is_same_v<Tensor, math::clU8Tensor>;
+    const size_t n_images = res.getDepth(), image_size = width * height;
+
+    size_t output_offset;
+    if constexpr (to_bytes) output_offset = res.getOffsetInBytes();
+    else
+      output_offset = res.getOffsetInFloats();
+
+    // Every image is uploaded with its own size, so the images are packed one after the other
+    std::vector<cl_ulong> offsets(n_images);
+    std::vector<cl_uint> geometry;
+    size_t total_size = 0;
+    for (size_t i = 0; i < n_images; i++) {
+      const auto &image = images[first + i];
+      size_t region_x = 0, region_y = 0;
+      size_t region_width = image.getWidth(), region_height = image.getHeight();
+      if (crop) {
+        if (orig_x + crop_width > image.getWidth() or orig_y + crop_height > image.getHeight())
+          throw std::invalid_argument("clTransformEngine::transform: The crop region does not fit "
+                                      "in image " +
+                                      std::to_string(first + i));
+        region_x = orig_x;
+        region_y = orig_y;
+        region_width = crop_width;
+        region_height = crop_height;
+      }
+      if (region_width == 0 or region_height == 0)
+        throw std::invalid_argument("clTransformEngine::transform: Image " +
+                                    std::to_string(first + i) + " is empty");
+
+      offsets[i] = total_size;
+      geometry.insert(geometry.end(),
+                      {(cl_uint) image.getWidth(), (cl_uint) region_x, (cl_uint) region_y,
+                       (cl_uint) region_width, (cl_uint) region_height});
+      total_size += image.getSize();
+    }
+
+    PackedImages packed;
+    packed.pixels = cl::Buffer(CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, total_size);
+    auto *data = static_cast<grayscale_t *>(queue.enqueueMapBuffer(
+            packed.pixels, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, 0, total_size));
+    for (size_t i = 0; i < n_images; i++)
+      std::copy(images[first + i].begin(), images[first + i].end(), data + offsets[i]);
+    queue.enqueueUnmapMemObject(packed.pixels, data);
+    packed.offsets = makeReadOnlyBuffer(offsets);
+    packed.geometry = makeReadOnlyBuffer(geometry);
+
+    LookupProgram program = compile(transformations);
+    auto &kernels = utils::cl_wrapper.getKernels();
+
+    auto resize = [&](const cl::Buffer &lut, const cl::Buffer &output, size_t offset,
+                      bool normalize) {
+      cl::Kernel kernel = kernels.getKernel(
+              "Transform.cl", normalize ? "resizeTransformNormalize" : "resizeTransformBytes");
+      kernel.setArg(0, packed.pixels);
+      kernel.setArg(1, packed.offsets);
+      kernel.setArg(2, packed.geometry);
+      kernel.setArg(3, lut);
+      kernel.setArg(4, output);
+      kernel.setArg(5, (cl_ulong) offset);
+      kernel.setArg(6, (cl_ulong) width);
+      kernel.setArg(7, (cl_ulong) height);
+      if (normalize) kernel.setArg(8, factor);
+      queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(width, height, n_images),
+                                 cl::NullRange);
+    };
+
+    // The lookup table is the same for every image: resize, transform and normalize in one launch
+    if (not program.needs_histogram) {
+      cl::Buffer lut = makeReadOnlyBuffer(program.luts);
+      resize(lut, res.getBuffer(), output_offset, not to_bytes);
+      return;
+    }
+
+    // Otherwise, the lookup table of each image is built from the histogram of the resized image
+    math::clU8Tensor resized(width, height, n_images);
+    cl::Buffer identity = makeReadOnlyBuffer(std::vector<LookupTable>{identityTable()});
+    resize(identity, resized.getBuffer(), resized.getOffsetInBytes(), false);
+
+    cl::Buffer histograms(CL_MEM_READ_WRITE, sizeof(cl_uint) * nb_colors * n_images);
+    cl::Kernel histogram_kernel = kernels.getKernel("Transform.cl", "imageHistograms");
+    histogram_kernel.setArg(0, resized.getBuffer());
+    histogram_kernel.setArg(1, (cl_ulong) resized.getOffsetInBytes());
+    histogram_kernel.setArg(2, (cl_ulong) image_size);
+    histogram_kernel.setArg(3, histograms);
+    queue.enqueueNDRangeKernel(histogram_kernel, cl::NullRange, cl::NDRange(nb_colors * n_images),
+                               cl::NDRange(nb_colors));
+
+    cl::Buffer ops = makeReadOnlyBuffer(program.ops);
+    cl::Buffer static_luts = makeReadOnlyBuffer(program.luts);
+    cl::Buffer luts(CL_MEM_READ_WRITE, sizeof(LookupTable) * n_images);
+    cl::Kernel build_kernel = kernels.getKernel("Transform.cl", "buildLookupTables");
+    build_kernel.setArg(0, histograms);
+    build_kernel.setArg(1, (cl_ulong) image_size);
+    build_kernel.setArg(2, ops);
+    build_kernel.setArg(3, (cl_ulong) program.ops.size());
+    build_kernel.setArg(4, static_luts);
+    build_kernel.setArg(5, luts);
+    queue.enqueueNDRangeKernel(build_kernel, cl::NullRange, cl::NDRange(nb_colors * n_images),
+                               cl::NDRange(nb_colors));
+
+    cl::Kernel apply_kernel = kernels.getKernel(
+            "Transform.cl", to_bytes ? "applyLookupTablesBytes" : "applyLookupTables");
+    apply_kernel.setArg(0, resized.getBuffer());
+    apply_kernel.setArg(1, (cl_ulong) resized.getOffsetInBytes());
+    apply_kernel.setArg(2, (cl_ulong) image_size);
+    apply_kernel.setArg(3, luts);
+    apply_kernel.setArg(4, res.getBuffer());
+    apply_kernel.setArg(5, (cl_ulong) output_offset);
+    if (not to_bytes) apply_kernel.setArg(6, factor);
+    queue.enqueueNDRangeKernel(apply_kernel, cl::NullRange, cl::NDRange(image_size, n_images),
+                               cl::NullRange);
+  }
+
+}   // namespace image::transform
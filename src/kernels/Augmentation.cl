@@ -0,0 +1,125 @@
+// Flags selecting the enabled augmentations. Must match the host side in Augmentation.cpp
+#define FLAG_HORIZONTAL_FLIP 1
+#define FLAG_VERTICAL_FLIP 2
+#define FLAG_ROTATION 4
+
+// Index of each random draw of a sample
+#define DRAW_HORIZONTAL_FLIP 0
+#define DRAW_VERTICAL_FLIP 1
+#define DRAW_ROTATION 2
+#define DRAW_TRANSLATION_X 3
+#define DRAW_TRANSLATION_Y 4
+#define DRAW_CONTRAST 5
+#define DRAW_BRIGHTNESS 6
+
+/**
+ * Finalizer of splitmix64. Consecutive inputs give uncorrelated outputs
+ */
+ulong mix64(ulong z) {
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9UL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebUL;
+  return z ^ (z >> 31);
+}
+
+/**
+ * Counter-based generator: the value only depends on its arguments, so every work-item can draw
+ * the values of its sample without sharing any state. Returns a float in [0, 1[
+ */
+float uniform(ulong seed, ulong epoch, ulong sample, uint draw) {
+  const ulong golden = 0x9e3779b97f4a7c15UL;
+  const ulong r = mix64(mix64(mix64(seed + epoch * golden) + sample * golden) + draw);
+  return (float) (r >> 40) * (1.0f / (1 << 24));
+}
+
+/**
+ * Returns a value in [-amplitude, amplitude[
+ */
+float jitter(ulong seed, ulong epoch, ulong sample, uint draw, float amplitude) {
+  return amplitude * (2.0f * uniform(seed, epoch, sample, draw) - 1.0f);
+}
+
+/**
+ * Returns the index in the source image of the pixel that lands at (x, y) once the sample is
+ * flipped, rotated and translated. Pixels translated from outside the image replicate the border
+ */
+size_t sourceIndex(size_t x, size_t y, ulong width, ulong height, ulong seed, ulong epoch,
+                   ulong sample, uint flags, uint max_translation) {
+  int sx = x, sy = y;
+  if (max_translation > 0) {
+    const uint span = 2 * max_translation + 1;
+    sx -= (int) (uniform(seed, epoch, sample, DRAW_TRANSLATION_X) * span) - (int) max_translation;
+    sy -= (int) (uniform(seed, epoch, sample, DRAW_TRANSLATION_Y) * span) - (int) max_translation;
+    sx = clamp(sx, 0, (int) width - 1);
+    sy = clamp(sy, 0, (int) height - 1);
+  }
+
+  // Rotations are only enabled on square images
+  if (flags & FLAG_ROTATION) {
+    const int n = width - 1, tx = sx;
+    switch ((uint) (uniform(seed, epoch, sample, DRAW_ROTATION) * 4)) {
+      case 1:
+        sx = sy;
+        sy = n - tx;
+        break;
+      case 2:
+        sx = n - sx;
+        sy = n - sy;
+        break;
+      case 3:
+        sx = n - sy;
+        sy = tx;
+        break;
+      default:
+        break;
+    }
+  }
+
+  if ((flags & FLAG_HORIZONTAL_FLIP) && uniform(seed, epoch, sample, DRAW_HORIZONTAL_FLIP) < 0.5f)
+    sx = width - 1 - sx;
+  if ((flags & FLAG_VERTICAL_FLIP) && uniform(seed, epoch, sample, DRAW_VERTICAL_FLIP) < 0.5f)
+    sy = height - 1 - sy;
+  return sy * width + sx;
+}
+
+float adjustIntensity(float value, ulong seed, ulong epoch, ulong sample, float contrast,
+                      float brightness) {
+  const float gain = 1.0f + jitter(seed, epoch, sample, DRAW_CONTRAST, contrast);
+  return value * gain + jitter(seed, epoch, sample, DRAW_BRIGHTNESS, brightness);
+}
+
+/**
+ * Augments a batch of images. Image i of the batch is identified by sample_ids[i], and its
+ * augmentation only depends on this identifier, the seed and the epoch. The global size is
+ * (width, height, n_images)
+ */
+__kernel void augment(__global const float *input, ulong input_offset, __global float *output,
+                      ulong output_offset, ulong width, ulong height, ulong seed, ulong epoch,
+                      __global const ulong *sample_ids, uint flags, uint max_translation,
+                      float contrast, float brightness) {
+  const size_t x = get_global_id(0), y = get_global_id(1), image = get_global_id(2);
+  const ulong sample = sample_ids[image];
+  const size_t base = image * width * height;
+  const size_t src =
+          sourceIndex(x, y, width, height, seed, epoch, sample, flags, max_translation);
+  output[output_offset + base + y * width + x] = adjustIntensity(
+          input[input_offset + base + src], seed, epoch, sample, contrast, brightness);
+}
+
+/**
+ * Same as augment, but reads images stored as bytes and divides them by the given factor first, so
+ * that the normalization and the augmentation are done in a single pass
+ */
+__kernel void augmentBytes(__global const uchar *input, ulong input_offset,
+                           __global float *output, ulong output_offset, ulong width, ulong height,
+                           ulong seed, ulong epoch, __global const ulong *sample_ids,
+                           uint flags, uint max_translation, float contrast, float brightness,
+                           float factor) {
+  const size_t x = get_global_id(0), y = get_global_id(1), image = get_global_id(2);
+  const ulong sample = sample_ids[image];
+  const size_t base = image * width * height;
+  const size_t src =
+          sourceIndex(x, y, width, height, seed, epoch, sample, flags, max_translation);
+  output[output_offset + base + y * width + x] =
+          adjustIntensity((float) input[input_offset + base + src] / factor, seed, epoch, sample,
+                          contrast, brightness);
+}
@@ -0,0 +1,446 @@
+/**
+ * Builds the im2col matrices of a batch of images, for every branch at once.
+ * The input holds n_branch * n_input images, branch-major. The matrix of each branch has
+ * kernel_h * kernel_w rows and n_input * output_h * output_w columns, so that the whole branch is
+ * convolved with all of its filters by a single GEMM. Elements of the padding are set to 0.
+ *
+ * Dimension 0 is the output pixel, dimension 1 the image, dimension 2 the element of the kernel
+ */
+__kernel void im2col(__global const float *input, ulong input_offset, __global float *col,
+                     ulong input_h, ulong input_w, ulong kernel_w, ulong output_w, ulong n_input,
+                     ulong stride_h, ulong stride_w, ulong pad_h, ulong pad_w) {
+  const size_t pixel = get_global_id(0);
+  const size_t image = get_global_id(1);
+  const size_t kernel_index = get_global_id(2);
+
+  const size_t n_pixel = get_global_size(0);
+  const size_t n_kernel = get_global_size(2);
+  const size_t branch = image / n_input;
+  const size_t image_in_branch = image % n_input;
+
+  const long row = (long) ((pixel / output_w) * stride_h + kernel_index / kernel_w) - (long) pad_h;
+  const long column =
+          (long) ((pixel % output_w) * stride_w + kernel_index % kernel_w) - (long) pad_w;
+
+  float value = 0.f;
+  if (row >= 0 && row < (long) input_h && column >= 0 && column < (long) input_w)
+    value = input[input_offset + image * input_h * input_w + row * input_w + column];
+
+  const size_t branch_cols = n_input * n_pixel;
+  col[branch * n_kernel * branch_cols + kernel_index * branch_cols + image_in_branch * n_pixel +
+      pixel] = value;
+}
+
+/**
+ * Inverse of im2col: accumulates the columns of the im2col matrices back into a batch of images.
+ * Each input pixel sums the elements of every column that read it, which makes this kernel the
+ * adjoint of im2col, as required to backpropagate the error of a convolution.
+ *
+ * Dimension 0 is the input pixel, dimension 1 the image
+ */
+__kernel void col2im(__global const float *col, __global float *output, ulong input_w,
+                     ulong kernel_h, ulong kernel_w, ulong output_h, ulong output_w, ulong n_input,
+                     ulong stride_h, ulong stride_w, ulong pad_h, ulong pad_w) {
+  const size_t pixel = get_global_id(0);
+  const size_t image = get_global_id(1);
+  const size_t n_input_pixel = get_global_size(0);
+
+  const size_t n_pixel = output_h * output_w;
+  const size_t n_kernel = kernel_h * kernel_w;
+  const size_t branch = image / n_input;
+  const size_t image_in_branch = image % n_input;
+  const size_t branch_cols = n_input * n_pixel;
+
+  // Coordinates of the pixel in the padded image
+  const size_t y = pixel / input_w + pad_h;
+  const size_t x = pixel % input_w + pad_w;
+
+  __global const float *branch_col =
+          col + branch * n_kernel * branch_cols + image_in_branch * n_pixel;
+  float sum = 0.f;
+  for (size_t kh = 0; kh < kernel_h && kh <= y; kh++) {
+    if ((y - kh) % stride_h != 0) continue;
+    const size_t oh = (y - kh) / stride_h;
+    if (oh >= output_h) continue;
+
+    for (size_t kw = 0; kw < kernel_w && kw <= x; kw++) {
+      if ((x - kw) % stride_w != 0) continue;
+      const size_t ow = (x - kw) / stride_w;
+      if (ow >= output_w) continue;
+      sum += branch_col[(kh * kernel_w + kw) * branch_cols + oh * output_w + ow];
+    }
+  }
+  output[image * n_input_pixel + pixel] = sum;
+}
+
+/**
+ * Winograd F(2x2, 3x3) filter transform: U = G g G^T, with
+ * G = [1 0 0; 1/2 1/2 1/2; 1/2 -1/2 1/2; 0 0 1].
+ * Element e of the 4x4 transformed filter f is written at u[e * n_filter_total + f].
+ *
+ * Dimension 0 is the filter
+ */
+__kernel void winogradFilter(__global const float *filters, ulong filters_offset,
+                             __global float *u) {
+  const size_t filter = get_global_id(0);
+  const size_t n_filter_total = get_global_size(0);
+  __global const float *g = filters + filters_offset + filter * 9;
+
+  // tmp = G g, a 4x3 matrix
+  float tmp[4][3];
+  for (int j = 0; j < 3; j++) {
+    tmp[0][j] = g[j];
+    tmp[1][j] = 0.5f * (g[j] + g[3 + j] + g[6 + j]);
+    tmp[2][j] = 0.5f * (g[j] - g[3 + j] + g[6 + j]);
+    tmp[3][j] = g[6 + j];
+  }
+
+  // u = tmp G^T, a 4x4 matrix
+  for (int i = 0; i < 4; i++) {
+    u[(i * 4 + 0) * n_filter_total + filter] = tmp[i][0];
+    u[(i * 4 + 1) * n_filter_total + filter] = 0.5f * (tmp[i][0] + tmp[i][1] + tmp[i][2]);
+    u[(i * 4 + 2) * n_filter_total + filter] = 0.5f * (tmp[i][0] - tmp[i][1] + tmp[i][2]);
+    u[(i * 4 + 3) * n_filter_total + filter] = tmp[i][2];
+  }
+}
+
+/**
+ * Winograd F(2x2, 3x3) input transform: V = B^T d B, with
+ * B^T = [1 0 -1 0; 0 1 1 0; 0 -1 1 0; 0 1 0 -1],
+ * where d is the 4x4 tile of the padded input that produces the 2x2 output tile.
+ * Element e of the transformed tile is written at v[(e * n_image + image) * n_tile + tile].
+ *
+ * Dimension 0 is the tile, dimension 1 the image
+ */
+__kernel void winogradInput(__global const float *input, ulong input_offset, __global float *v,
+                            ulong input_h, ulong input_w, ulong tiles_w, ulong pad_h,
+                            ulong pad_w) {
+  const size_t tile = get_global_id(0);
+  const size_t image = get_global_id(1);
+  const size_t n_tile = get_global_size(0);
+  const size_t n_image = get_global_size(1);
+
+  const long first_row = (long) (tile / tiles_w) * 2 - (long) pad_h;
+  const long first_col = (long) (tile % tiles_w) * 2 - (long) pad_w;
+  __global const float *src = input + input_offset + image * input_h * input_w;
+
+  float d[4][4];
+  for (int i = 0; i < 4; i++) {
+    const long row = first_row + i;
+    for (int j = 0; j < 4; j++) {
+      const long col = first_col + j;
+      d[i][j] = (row >= 0 && row < (long) input_h && col >= 0 && col < (long) input_w)
+                        ? src[row * input_w + col]
+                        : 0.f;
+    }
+  }
+
+  // tmp = B^T d
+  float tmp[4][4];
+  for (int j = 0; j < 4; j++) {
+    tmp[0][j] = d[0][j] - d[2][j];
+    tmp[1][j] = d[1][j] + d[2][j];
+    tmp[2][j] = d[2][j] - d[1][j];
+    tmp[3][j] = d[1][j] - d[3][j];
+  }
+
+  // v = tmp B
+  for (int i = 0; i < 4; i++) {
+    const float row[4] = {tmp[i][0] - tmp[i][2], tmp[i][1] + tmp[i][2], tmp[i][2] - tmp[i][1],
+                          tmp[i][1] - tmp[i][3]};
+    for (int j = 0; j < 4; j++) v[((i * 4 + j) * n_image + image) * n_tile + tile] = row[j];
+  }
+}
+
+/**
+ * Winograd F(2x2, 3x3) output transform: Y = A^T m A, with A^T = [1 1 1 0; 0 1 -1 -1].
+ * Element e of the transformed output tile is read at m[(e * n_output + output) * n_tile + tile].
+ * Parts of the 2x2 tile lying outside of the output are discarded.
+ *
+ * Dimension 0 is the tile, dimension 1 the output image
+ */
+__kernel void winogradOutput(__global const float *m, __global float *output, ulong output_h,
+                             ulong output_w, ulong tiles_w) {
+  const size_t tile = get_global_id(0);
+  const size_t image = get_global_id(1);
+  const size_t n_tile = get_global_size(0);
+  const size_t n_output = get_global_size(1);
+
+  float t[4][4];
+  for (int e = 0; e < 16; e++) t[e / 4][e % 4] = m[(e * n_output + image) * n_tile + tile];
+
+  // tmp = A^T t, a 2x4 matrix
+  float tmp[2][4];
+  for (int j = 0; j < 4; j++) {
+    tmp[0][j] = t[0][j] + t[1][j] + t[2][j];
+    tmp[1][j] = t[1][j] - t[2][j] - t[3][j];
+  }
+
+  const size_t first_row = (tile / tiles_w) * 2;
+  const size_t first_col = (tile % tiles_w) * 2;
+  __global float *dst = output + image * output_h * output_w;
+  for (int i = 0; i < 2; i++) {
+    if (first_row + i >= output_h) break;
+    const float y[2] = {tmp[i][0] + tmp[i][1] + tmp[i][2], tmp[i][1] - tmp[i][2] - tmp[i][3]};
+    for (int j = 0; j < 2; j++) {
+      if (first_col + j < output_w) dst[(first_row + i) * output_w + first_col + j] = y[j];
+    }
+  }
+}
+
+// Each work-group of the direct convolution kernels is made of DIRECT_WG x DIRECT_WG work-items,
+// each of them computing DIRECT_OUT x DIRECT_OUT pixels of a DIRECT_TILE x DIRECT_TILE tile
+#define DIRECT_WG 8
+#define DIRECT_OUT 2
+#define DIRECT_TILE (DIRECT_WG * DIRECT_OUT)
+
+/**
+ * Direct convolution (cross-correlation) of every image with all the filters of its branch.
+ * A work-group loads a tile of its input image and the filters of the branch in local memory,
+ * then computes the corresponding output tile for every filter, so that the tile is read once
+ * from global memory for all of them. The output is laid out as [branch][filter][input].
+ *
+ * Dimensions 0 and 1 are the columns and rows of the output, divided by DIRECT_OUT,
+ * dimension 2 the input image. The local size must be (DIRECT_WG, DIRECT_WG, 1)
+ */
+__kernel void directConvolution(__global const float *input, ulong input_offset,
+                                __global const float *filters, ulong filters_offset,
+                                __global float *output, ulong input_h, ulong input_w,
+                                ulong output_h, ulong output_w, ulong kernel_h, ulong kernel_w,
+                                ulong stride_h, ulong stride_w, ulong pad_h, ulong pad_w,
+                                ulong n_input, ulong n_filter, __local float *tile,
+                                __local float *local_filters) {
+  const size_t lx = get_local_id(0);
+  const size_t ly = get_local_id(1);
+  const size_t local_id = ly * DIRECT_WG + lx;
+  const size_t image = get_global_id(2);
+  const size_t branch = image / n_input;
+  const size_t image_in_branch = image % n_input;
+  const size_t n_kernel = kernel_h * kernel_w;
+
+  const size_t out_row = get_group_id(1) * DIRECT_TILE;
+  const size_t out_col = get_group_id(0) * DIRECT_TILE;
+  const size_t tile_h = (DIRECT_TILE - 1) * stride_h + kernel_h;
+  const size_t tile_w = (DIRECT_TILE - 1) * stride_w + kernel_w;
+  const long in_row = (long) (out_row * stride_h) - (long) pad_h;
+  const long in_col = (long) (out_col * stride_w) - (long) pad_w;
+
+  __global const float *src = input + input_offset + image * input_h * input_w;
+  for (size_t i = local_id; i < tile_h * tile_w; i += DIRECT_WG * DIRECT_WG) {
+    const long row = in_row + (long) (i / tile_w);
+    const long col = in_col + (long) (i % tile_w);
+    tile[i] = (row >= 0 && row < (long) input_h && col >= 0 && col < (long) input_w)
+                      ? src[row * input_w + col]
+                      : 0.f;
+  }
+  __global const float *branch_filters = filters + filters_offset + branch * n_filter * n_kernel;
+  for (size_t i = local_id; i < n_filter * n_kernel; i += DIRECT_WG * DIRECT_WG)
+    local_filters[i] = branch_filters[i];
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for (size_t f = 0; f < n_filter; f++) {
+    float acc[DIRECT_OUT][DIRECT_OUT] = {{0.f}};
+    __local const float *filter = local_filters + f * n_kernel;
+    for (size_t kh = 0; kh < kernel_h; kh++) {
+      for (size_t kw = 0; kw < kernel_w; kw++) {
+        const float w = filter[kh * kernel_w + kw];
+        for (int a = 0; a < DIRECT_OUT; a++) {
+          const size_t row = (ly * DIRECT_OUT + a) * stride_h + kh;
+          for (int b = 0; b < DIRECT_OUT; b++)
+            acc[a][b] += w * tile[row * tile_w + (lx * DIRECT_OUT + b) * stride_w + kw];
+        }
+      }
+    }
+
+    __global float *dst =
+            output + ((branch * n_filter + f) * n_input + image_in_branch) * output_h * output_w;
+    for (int a = 0; a < DIRECT_OUT; a++) {
+      const size_t row = out_row + ly * DIRECT_OUT + a;
+      for (int b = 0; b < DIRECT_OUT; b++) {
+        const size_t col = out_col + lx * DIRECT_OUT + b;
+        if (row < output_h && col < output_w) dst[row * output_w + col] = acc[a][b];
+      }
+    }
+  }
+}
+
+/**
+ * Direct computation of the error on the inputs of a convolution: the errors of every filter of
+ * the branch are convolved (with the flipped filter) and summed, then scaled by alpha.
+ * A work-group computes a tile of one input image. For each filter, the tile of errors it
+ * depends on is loaded in local memory.
+ *
+ * Dimensions 0 and 1 are the columns and rows of the input, divided by DIRECT_OUT,
+ * dimension 2 the input image. The local size must be (DIRECT_WG, DIRECT_WG, 1)
+ */
+__kernel void directConvolutionInputError(
+        __global const float *errors, ulong errors_offset, __global const float *filters,
+        ulong filters_offset, __global float *output, ulong input_h, ulong input_w,
+        ulong output_h, ulong output_w, ulong kernel_h, ulong kernel_w, ulong stride_h,
+        ulong stride_w, ulong pad_h, ulong pad_w, ulong n_input, ulong n_filter, float alpha,
+        __local float *tile, __local float *local_filters) {
+  const size_t lx = get_local_id(0);
+  const size_t ly = get_local_id(1);
+  const size_t local_id = ly * DIRECT_WG + lx;
+  const size_t image = get_global_id(2);
+  const size_t branch = image / n_input;
+  const size_t image_in_branch = image % n_input;
+  const size_t n_kernel = kernel_h * kernel_w;
+
+  const size_t in_row = get_group_id(1) * DIRECT_TILE;
+  const size_t in_col = get_group_id(0) * DIRECT_TILE;
+  const size_t tile_h = (DIRECT_TILE + kernel_h - 2) / stride_h + 2;
+  const size_t tile_w = (DIRECT_TILE + kernel_w - 2) / stride_w + 2;
+
+  // First output position whose window reaches the tile, rounded up
+  const long top = (long) (in_row + pad_h) - (long) (kernel_h - 1);
+  const long left = (long) (in_col + pad_w) - (long) (kernel_w - 1);
+  const long first_oh = top >= 0 ? (top + (long) stride_h - 1) / (long) stride_h
+                                 : -((-top) / (long) stride_h);
+  const long first_ow = left >= 0 ? (left + (long) stride_w - 1) / (long) stride_w
+                                  : -((-left) / (long) stride_w);
+
+  __global const float *branch_filters = filters + filters_offset + branch * n_filter * n_kernel;
+  for (size_t i = local_id; i < n_filter * n_kernel; i += DIRECT_WG * DIRECT_WG)
+    local_filters[i] = branch_filters[i];
+
+  float acc[DIRECT_OUT][DIRECT_OUT] = {{0.f}};
+  for (size_t f = 0; f < n_filter; f++) {
+    __global const float *src =
+            errors + errors_offset +
+            ((branch * n_filter + f) * n_input + image_in_branch) * output_h * output_w;
+    // Waits for the previous filter to be fully used before overwriting the tile
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (size_t i = local_id; i < tile_h * tile_w; i += DIRECT_WG * DIRECT_WG) {
+      const long oh = first_oh + (long) (i / tile_w);
+      const long ow = first_ow + (long) (i % tile_w);
+      tile[i] = (oh >= 0 && oh < (long) output_h && ow >= 0 && ow < (long) output_w)
+                        ? src[oh * output_w + ow]
+                        : 0.f;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    __local const float *filter = local_filters + f * n_kernel;
+    for (int a = 0; a < DIRECT_OUT; a++) {
+      // Coordinates of the pixel in the padded input
+      const size_t y = in_row + ly * DIRECT_OUT + a + pad_h;
+      for (int b = 0; b < DIRECT_OUT; b++) {
+        const size_t x = in_col + lx * DIRECT_OUT + b + pad_w;
+        for (size_t kh = 0; kh < kernel_h && kh <= y; kh++) {
+          if ((y - kh) % stride_h != 0) continue;
+          const size_t row = (long) ((y - kh) / stride_h) - first_oh;
+          for (size_t kw = 0; kw < kernel_w && kw <= x; kw++) {
+            if ((x - kw) % stride_w != 0) continue;
+            const size_t col = (long) ((x - kw) / stride_w) - first_ow;
+            acc[a][b] += tile[row * tile_w + col] * filter[kh * kernel_w + kw];
+          }
+        }
+      }
+    }
+  }
+
+  __global float *dst = output + image * input_h * input_w;
+  for (int a = 0; a < DIRECT_OUT; a++) {
+    const size_t row = in_row + ly * DIRECT_OUT + a;
+    for (int b = 0; b < DIRECT_OUT; b++) {
+      const size_t col = in_col + lx * DIRECT_OUT + b;
+      if (row < input_h && col < input_w) dst[row * input_w + col] = alpha * acc[a][b];
+    }
+  }
+}
+
+// Each work-group of the fused kernel is made of FUSED_WG x FUSED_WG work-items, each of them
+// computing one pixel of the pooled output
+#define FUSED_WG 16
+
+// Same values as af::ActivationFunctionType
+#define AF_IDENTITY 0
+#define AF_SIGMOID 1
+#define AF_RELU 2
+#define AF_LEAKY_RELU 3
+#define AF_SQUARE 4
+
+float activate(float x, int type) {
+  switch (type) {
+    case AF_SIGMOID:
+      return 1.0f / (1.0f + exp(-x));
+    case AF_RELU:
+      return fmax(0.f, x);
+    case AF_LEAKY_RELU:
+      return x > 0 ? x : 0.01f * x;
+    case AF_SQUARE:
+      return x * x;
+    default:
+      return x;
+  }
+}
+
+/**
+ * Convolution, activation function and pooling fused in a single kernel, for inference.
+ * A work-group computes the activated convolution over the region covered by its pooling windows
+ * into local memory, then pools it, so that only the pooled output is written to global memory.
+ * The output is laid out as [branch][filter][input], like the convolution.
+ *
+ * Dimensions 0 and 1 are the columns and rows of the pooled output, dimension 2 the output map.
+ * The local size must be (FUSED_WG, FUSED_WG, 1)
+ */
+__kernel void fusedConvolutionPooling(
+        __global const float *input, ulong input_offset, __global const float *filters,
+        ulong filters_offset, __global float *output, ulong input_h, ulong input_w, ulong conv_h,
+        ulong conv_w, ulong kernel_h, ulong kernel_w, ulong stride_h, ulong stride_w, ulong pad_h,
+        ulong pad_w, ulong output_h, ulong output_w, ulong pool_h, ulong pool_w,
+        ulong pool_stride_h, ulong pool_stride_w, ulong pool_pad_h, ulong pool_pad_w,
+        ulong n_input, ulong n_filter, int activation, int is_max, __local float *region) {
+  const size_t lx = get_local_id(0);
+  const size_t ly = get_local_id(1);
+  const size_t local_id = ly * FUSED_WG + lx;
+  const size_t map = get_global_id(2);
+  // Maps are laid out as [branch][filter][input], and filters as [branch][filter]
+  const size_t branch = map / (n_filter * n_input);
+  const size_t image = branch * n_input + map % n_input;
+  const size_t n_kernel = kernel_h * kernel_w;
+
+  const size_t region_h = (FUSED_WG - 1) * pool_stride_h + pool_h;
+  const size_t region_w = (FUSED_WG - 1) * pool_stride_w + pool_w;
+  const long region_row = (long) (get_group_id(1) * FUSED_WG * pool_stride_h) - (long) pool_pad_h;
+  const long region_col = (long) (get_group_id(0) * FUSED_WG * pool_stride_w) - (long) pool_pad_w;
+
+  __global const float *src = input + input_offset + image * input_h * input_w;
+  __global const float *filter = filters + filters_offset + (map / n_input) * n_kernel;
+  // The padding of the pooling is ignored by the maximum, and counts as zeros in the average
+  const float pad_value = is_max ? -INFINITY : 0.f;
+  for (size_t i = local_id; i < region_h * region_w; i += FUSED_WG * FUSED_WG) {
+    const long row = region_row + (long) (i / region_w);
+    const long col = region_col + (long) (i % region_w);
+    if (row < 0 || row >= (long) conv_h || col < 0 || col >= (long) conv_w) {
+      region[i] = pad_value;
+      continue;
+    }
+
+    const long in_row = row * (long) stride_h - (long) pad_h;
+    const long in_col = col * (long) stride_w - (long) pad_w;
+    float acc = 0.f;
+    for (size_t kh = 0; kh < kernel_h; kh++) {
+      const long r = in_row + (long) kh;
+      if (r < 0 || r >= (long) input_h) continue;
+      for (size_t kw = 0; kw < kernel_w; kw++) {
+        const long c = in_col + (long) kw;
+        if (c >= 0 && c < (long) input_w) acc += filter[kh * kernel_w + kw] * src[r * input_w + c];
+      }
+    }
+    region[i] = activate(acc, activation);
+  }
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  const size_t out_row = get_global_id(1);
+  const size_t out_col = get_global_id(0);
+  if (out_row >= output_h || out_col >= output_w) return;
+
+  float res = pad_value;
+  for (size_t ph = 0; ph < pool_h; ph++) {
+    __local const float *line = region + (ly * pool_stride_h + ph) * region_w + lx * pool_stride_w;
+    for (size_t pw = 0; pw < pool_w; pw++) res = is_max ? fmax(res, line[pw]) : res + line[pw];
+  }
+  if (!is_max) res /= (float) (pool_h * pool_w);
+  output[(map * output_h + out_row) * output_w + out_col] = res;
+}
@@ -1,7 +1,6 @@
 
-__kernel void normalizeCharToFloat(__global unsigned char *input, __global float *output,
-                                   ulong offset, float factor) {
-  const int row = get_global_id(0);
-  output[row + offset] = (float) input[row];
-  output[row + offset] /= factor;
+__kernel void normalizeCharToFloat(__global unsigned char *input, ulong input_offset,
+                                   __global float *output, ulong offset, float factor) {
+  const size_t row = get_global_id(0);
+  output[row + offset] = (float) input[row + input_offset] / factor;
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+/**
+ * Average pooling of a batch of images. The padding counts as zeros in the average.
+ *
+ * Dimension 0 is the output pixel, dimension 1 the image
+ */
+__kernel void avgPooling(__global const float *input, ulong input_offset, __global float *output,
+                         ulong input_h, ulong input_w, ulong output_w, ulong pool_h, ulong pool_w,
+                         ulong stride_h, ulong stride_w, ulong pad_h, ulong pad_w) {
+  const size_t pixel = get_global_id(0);
+  const size_t image = get_global_id(1);
+  const size_t n_pixel = get_global_size(0);
+
+  const long first_row = (long) ((pixel / output_w) * stride_h) - (long) pad_h;
+  const long first_col = (long) ((pixel % output_w) * stride_w) - (long) pad_w;
+  const long last_row = min(first_row + (long) pool_h, (long) input_h);
+  const long last_col = min(first_col + (long) pool_w, (long) input_w);
+
+  __global const float *src = input + input_offset + image * input_h * input_w;
+  float sum = 0.f;
+  for (long row = max(first_row, 0L); row < last_row; row++) {
+    for (long col = max(first_col, 0L); col < last_col; col++) sum += src[row * input_w + col];
+  }
+  output[image * n_pixel + pixel] = sum / (float) (pool_h * pool_w);
+}
+
+/**
+ * Backward pass of the average pooling: each input pixel receives the errors of every output
+ * whose window covers it, divided by the size of the window.
+ *
+ * Dimension 0 is the input pixel, dimension 1 the image
+ */
+__kernel void avgPoolingBackward(__global const float *errors, ulong errors_offset,
+                                 __global float *output, ulong input_w, ulong output_h,
+                                 ulong output_w, ulong pool_h, ulong pool_w, ulong stride_h,
+                                 ulong stride_w, ulong pad_h, ulong pad_w) {
+  const size_t pixel = get_global_id(0);
+  const size_t image = get_global_id(1);
+  const size_t n_pixel = get_global_size(0);
+
+  // Coordinates of the pixel in the padded input
+  const size_t y = pixel / input_w + pad_h;
+  const size_t x = pixel % input_w + pad_w;
+
+  __global const float *src = errors + errors_offset + image * output_h * output_w;
+  float sum = 0.f;
+  for (size_t k = 0; k < pool_h && k <= y; k++) {
+    if ((y - k) % stride_h != 0) continue;
+    const size_t oh = (y - k) / stride_h;
+    if (oh >= output_h) continue;
+
+    for (size_t l = 0; l < pool_w && l <= x; l++) {
+      if ((x - l) % stride_w != 0) continue;
+      const size_t ow = (x - l) / stride_w;
+      if (ow < output_w) sum += src[oh * output_w + ow];
+    }
+  }
+  output[image * n_pixel + pixel] = sum / (float) (pool_h * pool_w);
+}
+
+
+/**
+ * Returns the index in its image of the maximum of the window of an output pixel. Cells of the
+ * window lying in the padding are ignored, and the first maximum wins on ties
+ */
+size_t findMax(__global const float *src, size_t pixel, ulong input_h, ulong input_w,
+               ulong output_w, ulong pool_h, ulong pool_w, ulong stride_h, ulong stride_w,
+               ulong pad_h, ulong pad_w) {
+  const long first_row = (long) ((pixel / output_w) * stride_h) - (long) pad_h;
+  const long first_col = (long) ((pixel % output_w) * stride_w) - (long) pad_w;
+  const long last_row = min(first_row + (long) pool_h, (long) input_h);
+  const long last_col = min(first_col + (long) pool_w, (long) input_w);
+
+  size_t res = max(first_row, 0L) * input_w + max(first_col, 0L);
+  for (long row = max(first_row, 0L); row < last_row; row++) {
+    for (long col = max(first_col, 0L); col < last_col; col++) {
+      if (src[res] < src[row * input_w + col]) res = row * input_w + col;
+    }
+  }
+  return res;
+}
+
+/**
+ * Max pooling of a batch of images.
+ *
+ * Dimension 0 is the output pixel, dimension 1 the image
+ */
+__kernel void maxPooling(__global const float *input, ulong input_offset, __global float *output,
+                         ulong input_h, ulong input_w, ulong output_w, ulong pool_h, ulong pool_w,
+                         ulong stride_h, ulong stride_w, ulong pad_h, ulong pad_w) {
+  const size_t pixel = get_global_id(0);
+  const size_t image = get_global_id(1);
+  const size_t n_pixel = get_global_size(0);
+
+  __global const float *src = input + input_offset + image * input_h * input_w;
+  const size_t index = findMax(src, pixel, input_h, input_w, output_w, pool_h, pool_w, stride_h,
+                               stride_w, pad_h, pad_w);
+  output[image * n_pixel + pixel] = src[index];
+}
+
+/**
+ * Same as maxPooling, but also saves the index of the maximum of each output pixel in its image,
+ * for the backward pass
+ */
+__kernel void maxPoolingForward(__global const float *input, ulong input_offset,
+                                __global float *output, __global uint *indices, ulong input_h,
+                                ulong input_w, ulong output_w, ulong pool_h, ulong pool_w,
+                                ulong stride_h, ulong stride_w, ulong pad_h, ulong pad_w) {
+  const size_t pixel = get_global_id(0);
+  const size_t image = get_global_id(1);
+  const size_t n_pixel = get_global_size(0);
+
+  __global const float *src = input + input_offset + image * input_h * input_w;
+  const size_t index = findMax(src, pixel, input_h, input_w, output_w, pool_h, pool_w, stride_h,
+                               stride_w, pad_h, pad_w);
+  output[image * n_pixel + pixel] = src[index];
+  indices[image * n_pixel + pixel] = index;
+}
+
+/**
+ * Backward pass of the max pooling: each input pixel receives the errors of every output whose
+ * maximum it was. The windows covering the pixel are gathered, so that no atomics are needed.
+ *
+ * Dimension 0 is the input pixel, dimension 1 the image
+ */
+__kernel void maxPoolingBackward(__global const float *errors, ulong errors_offset,
+                                 __global const uint *indices, __global float *output,
+                                 ulong input_w, ulong output_h, ulong output_w, ulong pool_h,
+                                 ulong pool_w, ulong stride_h, ulong stride_w, ulong pad_h,
+                                 ulong pad_w) {
+  const size_t pixel = get_global_id(0);
+  const size_t image = get_global_id(1);
+  const size_t n_pixel = get_global_size(0);
+
+  // Coordinates of the pixel in the padded input
+  const size_t y = pixel / input_w + pad_h;
+  const size_t x = pixel % input_w + pad_w;
+
+  __global const float *src = errors + errors_offset + image * output_h * output_w;
+  __global const uint *max_index = indices + image * output_h * output_w;
+  float sum = 0.f;
+  for (size_t k = 0; k < pool_h && k <= y; k++) {
+    if ((y - k) % stride_h != 0) continue;
+    const size_t oh = (y - k) / stride_h;
+    if (oh >= output_h) continue;
+
+    for (size_t l = 0; l < pool_w && l <= x; l++) {
+      if ((x - l) % stride_w != 0) continue;
+      const size_t ow = (x - l) / stride_w;
+      if (ow < output_w && max_index[oh * output_w + ow] == pixel) sum += src[oh * output_w + ow];
+    }
+  }
+  output[image * n_pixel + pixel] = sum;
+}
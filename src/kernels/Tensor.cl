@@ -0,0 +1,19 @@
+/**
+ * Swaps the two outer dimensions of a tensor of blocks: the input is seen as an
+ * (n_outer, n_inner) grid of blocks of block_size floats, and block (i, j) is written at
+ * position (j, i) of the output.
+ *
+ * Dimension 0 is the element of the block, dimension 1 the block
+ */
+__kernel void transposeBlocks(__global const float *input, ulong input_offset,
+                              __global float *output, ulong output_offset, ulong n_inner) {
+  const size_t element = get_global_id(0);
+  const size_t block = get_global_id(1);
+  const size_t block_size = get_global_size(0);
+  const size_t n_outer = get_global_size(1) / n_inner;
+
+  const size_t outer = block / n_inner;
+  const size_t inner = block % n_inner;
+  output[output_offset + (inner * n_outer + outer) * block_size + element] =
+          input[input_offset + block * block_size + element];
+}
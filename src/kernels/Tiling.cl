@@ -0,0 +1,18 @@
+/**
+ * Extracts a batch of tiles from an image stored as bytes, and normalizes them by the given
+ * factor. Tile i of the batch is tile first_tile + i of the grid, whose origin is
+ * (x_origins[i % tiles_per_row], y_origins[i / tiles_per_row]). The global size is
+ * (tile_width, tile_height, n_tiles)
+ */
+__kernel void extractTiles(__global const uchar *image, ulong image_width,
+                           __global const uint *x_origins, __global const uint *y_origins,
+                           ulong tiles_per_row, ulong first_tile, __global float *output,
+                           ulong output_offset, ulong tile_width, ulong tile_height,
+                           float factor) {
+  const size_t x = get_global_id(0), y = get_global_id(1), tile = get_global_id(2);
+  const size_t grid_index = first_tile + tile;
+  const size_t src_x = x_origins[grid_index % tiles_per_row] + x;
+  const size_t src_y = y_origins[grid_index / tiles_per_row] + y;
+  output[output_offset + (tile * tile_height + y) * tile_width + x] =
+          (float) image[src_y * image_width + src_x] / factor;
+}
@@ -0,0 +1,200 @@
+// Number of gray levels. Kernels working on histograms or lookup tables use work-groups of this
+// size, one work-item per level
+#define N_LEVELS 256
+
+// Operations of buildLookupTables. Must match the host side in clTransformEngine.cpp
+#define OP_STATIC_LUT 0
+#define OP_EQUALIZE 1
+#define OP_MEDIAN_BINARY_SCALE 2
+
+// Each source image is described by 5 values in the geometry buffer: its width, then the origin
+// and the size of the region that is resized
+#define GEOMETRY_STRIDE 5
+
+/**
+ * The source pixels contributing to an output pixel along one axis, as in resize_subfunctions in
+ * Transform.cpp. Reductions average the area covered by the output pixel, which avoids aliasing on
+ * large factors. Enlargements use a linear interpolation mapping the borders onto each other
+ */
+typedef struct {
+  uint first, taps;
+  // On reductions, the covered interval [begin, end[ in source pixels. On enlargements, begin is
+  // the fraction between the two taps
+  float begin, end, scale;
+  int area;
+} Span;
+
+Span makeSpan(uint src_size, size_t dst_size, size_t i) {
+  Span res;
+  if (src_size > dst_size) {
+    res.area = 1;
+    res.scale = (float) src_size / dst_size;
+    res.begin = i * res.scale;
+    res.end = (i + 1) * res.scale;
+    res.taps = min((uint) ceil(res.scale) + 1, src_size);
+    // Shift the window to the left if it would go past the last source pixel
+    res.first = min((uint) res.begin, src_size - res.taps);
+    return res;
+  }
+
+  res.area = 0;
+  const float factor = dst_size > 1 ? (float) (src_size - 1) / (dst_size - 1) : 0.0f;
+  const float position = i * factor;
+  res.taps = min(2u, src_size);
+  res.first = min((uint) position, src_size - res.taps);
+  res.begin = position - res.first;
+  res.end = res.scale = 0.0f;
+  return res;
+}
+
+float spanWeight(const Span *span, uint k) {
+  if (!span->area) return k == 0 ? 1.0f - span->begin : span->begin;
+  const float pixel_begin = span->first + k;
+  return max(0.0f, min(span->end, pixel_begin + 1.0f) - max(span->begin, pixel_begin)) /
+         span->scale;
+}
+
+/**
+ * Resamples the region of a source image at the given output pixel. The resampling is separable,
+ * every output pixel reads the taps of its row span times the taps of its column span
+ */
+uchar resizedPixel(__global const uchar *pixels, __global const ulong *offsets,
+                   __global const uint *geometry, size_t image, size_t x, size_t y,
+                   size_t out_width, size_t out_height) {
+  __global const uint *g = geometry + image * GEOMETRY_STRIDE;
+  const uint width = g[0], region_x = g[1], region_y = g[2];
+  const uint region_width = g[3], region_height = g[4];
+  __global const uchar *src = pixels + offsets[image] + region_y * width + region_x;
+
+  const Span columns = makeSpan(region_width, out_width, x);
+  const Span rows = makeSpan(region_height, out_height, y);
+  float sum = 0.0f;
+  for (uint ky = 0; ky < rows.taps; ky++) {
+    const float wy = spanWeight(&rows, ky);
+    if (wy == 0.0f) continue;
+    __global const uchar *row = src + (rows.first + ky) * width + columns.first;
+    float row_sum = 0.0f;
+    for (uint kx = 0; kx < columns.taps; kx++) row_sum += spanWeight(&columns, kx) * row[kx];
+    sum += wy * row_sum;
+  }
+  return convert_uchar_sat_rte(sum);
+}
+
+/**
+ * Resizes a batch of images, maps every pixel through a lookup table and normalizes it by the
+ * given factor. The global size is (out_width, out_height, n_images)
+ */
+__kernel void resizeTransformNormalize(__global const uchar *pixels,
+                                       __global const ulong *offsets,
+                                       __global const uint *geometry, __global const uchar *lut,
+                                       __global float *output, ulong output_offset,
+                                       ulong out_width, ulong out_height, float factor) {
+  const size_t x = get_global_id(0), y = get_global_id(1), image = get_global_id(2);
+  const uchar value =
+          lut[resizedPixel(pixels, offsets, geometry, image, x, y, out_width, out_height)];
+  output[output_offset + (image * out_height + y) * out_width + x] = (float) value / factor;
+}
+
+/**
+ * Same as resizeTransformNormalize, but keeps the transformed pixels as bytes
+ */
+__kernel void resizeTransformBytes(__global const uchar *pixels, __global const ulong *offsets,
+                                   __global const uint *geometry, __global const uchar *lut,
+                                   __global uchar *output, ulong output_offset, ulong out_width,
+                                   ulong out_height) {
+  const size_t x = get_global_id(0), y = get_global_id(1), image = get_global_id(2);
+  output[output_offset + (image * out_height + y) * out_width + x] =
+          lut[resizedPixel(pixels, offsets, geometry, image, x, y, out_width, out_height)];
+}
+
+/**
+ * Computes the histogram of each image of a batch. One work-group of N_LEVELS work-items per
+ * image
+ */
+__kernel void imageHistograms(__global const uchar *images, ulong input_offset, ulong image_size,
+                              __global uint *histograms) {
+  __local uint local_histogram[N_LEVELS];
+  const size_t level = get_local_id(0), image = get_group_id(0);
+  local_histogram[level] = 0;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  __global const uchar *src = images + input_offset + image * image_size;
+  for (size_t i = level; i < image_size; i += N_LEVELS) atomic_inc(&local_histogram[src[i]]);
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  histograms[image * N_LEVELS + level] = local_histogram[level];
+}
+
+/**
+ * Builds the lookup table of each image of a batch, by composing a sequence of operations.
+ * Operations that depend on the histogram see the histogram of the image transformed by the
+ * previous operations. One work-group of N_LEVELS work-items per image
+ */
+__kernel void buildLookupTables(__global const uint *histograms, ulong image_size,
+                                __global const int *ops, ulong n_ops,
+                                __global const uchar *static_luts, __global uchar *luts) {
+  __local float histogram[N_LEVELS], remapped[N_LEVELS];
+  __local uchar lut[N_LEVELS];
+  const size_t level = get_local_id(0), image = get_group_id(0);
+  histogram[level] = (float) histograms[image * N_LEVELS + level] / image_size;
+  uchar composed = level;
+  barrier(CLK_LOCAL_MEM_FENCE);
+
+  for (size_t op = 0; op < n_ops; op++) {
+    if (ops[op] == OP_STATIC_LUT) {
+      lut[level] = static_luts[op * N_LEVELS + level];
+    } else if (ops[op] == OP_EQUALIZE) {
+      float cumulated = 0.0f;
+      for (size_t k = 0; k <= level; k++) cumulated += histogram[k];
+      lut[level] = convert_uchar_sat(round(cumulated * (N_LEVELS - 1)));
+    } else {
+      // Every work-item finds the median on its own, which is cheaper than a reduction here
+      uint median = N_LEVELS - 2;
+      float cumulated = 0.0f;
+      for (uint k = 0; k < N_LEVELS - 1; k++) {
+        cumulated += histogram[k];
+        if (cumulated >= 0.5f) {
+          median = k;
+          break;
+        }
+      }
+      lut[level] = level <= median ? 0 : N_LEVELS - 1;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    composed = lut[composed];
+    float sum = 0.0f;
+    for (size_t k = 0; k < N_LEVELS; k++) {
+      if (lut[k] == level) sum += histogram[k];
+    }
+    remapped[level] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    histogram[level] = remapped[level];
+    barrier(CLK_LOCAL_MEM_FENCE);
+  }
+  luts[image * N_LEVELS + level] = composed;
+}
+
+/**
+ * Maps the pixels of each image through its own lookup table, and normalizes them by the given
+ * factor. The global size is (image_size, n_images)
+ */
+__kernel void applyLookupTables(__global const uchar *images, ulong input_offset,
+                                ulong image_size, __global const uchar *luts,
+                                __global float *output, ulong output_offset, float factor) {
+  const size_t i = get_global_id(0), image = get_global_id(1);
+  const size_t index = image * image_size + i;
+  output[output_offset + index] = (float) luts[image * N_LEVELS + images[input_offset + index]] /
+                                  factor;
+}
+
+/**
+ * Same as applyLookupTables, but keeps the transformed pixels as bytes
+ */
+__kernel void applyLookupTablesBytes(__global const uchar *images, ulong input_offset,
+                                     ulong image_size, __global const uchar *luts,
+                                     __global uchar *output, ulong output_offset) {
+  const size_t i = get_global_id(0), image = get_global_id(1);
+  const size_t index = image * image_size + i;
+  output[output_offset + index] = luts[image * N_LEVELS + images[input_offset + index]];
+}
@@ -99,7 +99,7 @@ namespace math {
     for (size_t i = 0; i < ndiv; i++) {
       clFTensor part = shallowCopy();
       part.depth = i < z_dim_remainder ? z_dim_part + 1 : z_dim_part;
-      part.offset = local_offset;
+      part.offset = offset + local_offset;
       part.is_view = true;
       local_offset += part.depth;
       parts.push_back(std::move(part));
@@ -113,7 +113,7 @@ namespace math {
     }
     clFTensor slice = shallowCopy();
     slice.depth = end - begin;
-    slice.offset = begin;
+    slice.offset = offset + begin;
     slice.is_view = true;
     return slice;
   }
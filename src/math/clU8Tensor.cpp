@@ -0,0 +1,46 @@
+#include "clU8Tensor.hpp"
+
+namespace math {
+
+  clU8Tensor::clU8Tensor(size_t width, size_t height, size_t depth)
+      : rows(width), cols(height), depth(depth) {
+    data = cl::Buffer(CL_MEM_READ_WRITE, sizeInBytes());
+  }
+
+  clU8Tensor clU8Tensor::shallowCopy() const {
+    clU8Tensor copy;
+    copy.rows = rows;
+    copy.cols = cols;
+    copy.depth = depth;
+    copy.data = data;
+    copy.offset = offset;
+    return copy;
+  }
+
+  clU8Tensor clU8Tensor::slice(size_t begin, size_t end) const {
+    if (begin > depth or begin > end or end > depth) {
+      throw std::out_of_range("clU8Tensor::slice: begin or end index out of range");
+    }
+    clU8Tensor slice = shallowCopy();
+    slice.depth = end - begin;
+    slice.offset = offset + begin;
+    return slice;
+  }
+
+  clFTensor clU8Tensor::toFloat(cl::CommandQueue &queue, float factor) const {
+    clFTensor res(rows, cols, depth);
+    // We need to return if the size is 0 else OpenCL will throw
+    if (size() == 0) return res;
+
+    cl::Kernel kernel = utils::cl_wrapper.getKernels().getKernel("NormalizeCharToFloat.cl",
+                                                                 "normalizeCharToFloat");
+    kernel.setArg(0, data);
+    kernel.setArg(1, (cl_ulong) getOffsetInBytes());
+    kernel.setArg(2, res.getBuffer());
+    kernel.setArg(3, (cl_ulong) res.getOffsetInFloats());
+    kernel.setArg(4, factor);
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(size()), cl::NullRange);
+    return res;
+  }
+
+}   // namespace math
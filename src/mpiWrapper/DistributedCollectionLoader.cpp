@@ -0,0 +1,110 @@
+#include "DistributedCollectionLoader.hpp"
+
+#include <array>
+#include <exception>
+#include <functional>
+
+using namespace control;
+
+namespace mpiw {
+  namespace {
+    /**
+     * @brief Rethrows the local error if there is one, or throws if another process failed. Every
+     * process throws together, so that none of them waits in a later collective
+     */
+    void throwIfAnyFailed(bool any_failed, const std::exception_ptr &local_error) {
+      if (local_error) std::rethrow_exception(local_error);
+      if (any_failed)
+        throw std::runtime_error("DistributedCollectionLoader::load: Loading failed on another "
+                                 "process");
+    }
+
+    /**
+     * @brief Ensures every process found the same classes, using a single reduction.
+     * The reduction is made with MPI_MIN over (x, ~x) pairs, which gives both the minimum and the
+     * maximum of each value: they are only equal if every process holds the same value.
+     * The local error, if any, is part of the reduction
+     */
+    void agreeOnClasses(MPI_Comm comm, size_t input_width, size_t input_height,
+                        const std::vector<std::string> &classes,
+                        const std::exception_ptr &local_error) {
+      std::string joined_names;
+      for (const auto &c : classes) joined_names += c + '\n';
+
+      std::array<unsigned long, 5> metadata = {local_error ? 1ul : 0ul, input_width, input_height,
+                                               classes.size(),
+                                               std::hash<std::string>{}(joined_names)};
+      std::array<unsigned long, 10> local{}, global{};
+      for (size_t i = 0; i < metadata.size(); i++) {
+        local[i] = metadata[i];
+        local[i + metadata.size()] = ~metadata[i];
+      }
+
+      MPI_Allreduce(local.data(), global.data(), (int) local.size(), MPI_UNSIGNED_LONG, MPI_MIN,
+                    comm);
+
+      // The first value is the failure flag, whose maximum tells if any process failed
+      throwIfAnyFailed(~global[metadata.size()] != 0, local_error);
+      for (size_t i = 1; i < metadata.size(); i++) {
+        if (global[i] != ~global[i + metadata.size()])
+          throw std::runtime_error("DistributedCollectionLoader::load: processes do not see the "
+                                   "same dataset");
+      }
+    }
+
+    /**
+     * @brief Collective version of throwIfAnyFailed()
+     */
+    void agreeOnSuccess(MPI_Comm comm, const std::exception_ptr &local_error) {
+      int failed = local_error ? 1 : 0, any_failed = 0;
+      MPI_Allreduce(&failed, &any_failed, 1, MPI_INT, MPI_MAX, comm);
+      throwIfAnyFailed(any_failed != 0, local_error);
+    }
+  }   // namespace
+
+  DistributedCollectionLoader::DistributedCollectionLoader(MPI_Comm comm, size_t tensor_size,
+                                                           size_t input_width, size_t input_height)
+      : comm(comm), input_set_loader(tensor_size, input_width, input_height) {
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+  }
+
+  TrainingCollection DistributedCollectionLoader::load(const std::filesystem::path &path,
+                                                       EvalSetMode eval_mode) const {
+    const size_t width = input_set_loader.getInputWidth();
+    const size_t height = input_set_loader.getInputHeight();
+    TrainingCollection res(width, height);
+
+    // Only the directories are enumerated here, so the check is cheap compared to the loading.
+    // Errors are shared with the other processes before throwing, so that no process is left
+    // waiting in a collective
+    std::vector<std::string> classes;
+    std::exception_ptr error;
+    try {
+      classes = InputSetLoader::listClasses(path / "train");
+      if (classes.empty())
+        throw std::runtime_error("DistributedCollectionLoader::load: Training set has no classes");
+    } catch (...) { error = std::current_exception(); }
+    agreeOnClasses(comm, width, height, classes, error);
+
+    try {
+      res.getTrainingSet() = input_set_loader.loadShard(path / "train", /*load_classes*/ true,
+                                                        /* shuffle samples */ true, rank, size);
+      if (eval_mode == EvalSetMode::full)
+        res.getEvaluationSet() = input_set_loader.load(path / "eval", /*load_classes*/ true,
+                                                       /* shuffle samples */ true);
+      else if (eval_mode == EvalSetMode::shard)
+        res.getEvaluationSet() = input_set_loader.loadShard(
+                path / "eval", /*load_classes*/ true, /* shuffle samples */ true, rank, size);
+
+      if (eval_mode != EvalSetMode::none and res.getEvaluationSet().getClasses() != classes)
+        throw std::runtime_error("DistributedCollectionLoader::load: Training and eval sets have "
+                                 "different classes");
+    } catch (...) { error = std::current_exception(); }
+    agreeOnSuccess(comm, error);
+
+    // Also builds the training targets
+    res.updateClasses(classes);
+    return res;
+  }
+}   // namespace mpiw
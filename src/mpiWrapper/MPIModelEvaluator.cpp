@@ -0,0 +1,25 @@
+#include "MPIModelEvaluator.hpp"
+
+namespace control {
+
+  MPIModelEvaluator::MPIModelEvaluator(MPI_Comm comm) : comm(comm) {}
+
+  ModelEvaluation MPIModelEvaluator::evaluate(const nnet::Model &model,
+                                              const InputSet &input_set) const {
+    static_assert(sizeof(size_t) == sizeof(unsigned long), "size_t must match MPI_UNSIGNED_LONG");
+
+    int rank = 0;
+    MPI_Comm_rank(comm, &rank);
+
+    auto local_matrix = computeConfusionMatrix(model, input_set);
+    // Only the root needs the global matrix, the other processes pass an unused buffer
+    math::Matrix<size_t> global_matrix(rank == 0 ? local_matrix.getRows() : 0,
+                                       rank == 0 ? local_matrix.getCols() : 0);
+
+    MPI_Reduce(local_matrix.getData(), global_matrix.getData(), (int) local_matrix.getSize(),
+               MPI_UNSIGNED_LONG, MPI_SUM, 0, comm);
+
+    if (rank != 0) return {};
+    return computeStatistics(global_matrix);
+  }
+}   // namespace control
@@ -0,0 +1,23 @@
+#include "MPIPipelineEvaluator.hpp"
+
+namespace control {
+
+  MPIPipelineEvaluator::MPIPipelineEvaluator(MPI_Comm comm) : comm(comm) {}
+
+  ModelEvaluation MPIPipelineEvaluator::evaluate(const nnet::Model &model,
+                                                 const InputSet &input_set) const {
+    int rank = 0;
+    MPI_Comm_rank(comm, &rank);
+
+    // The other stages must run the model once for every sample of the first stage
+    unsigned long n_samples = rank == 0 ? input_set.getSize() : 0;
+    MPI_Bcast(&n_samples, 1, MPI_UNSIGNED_LONG, 0, comm);
+
+    if (rank == 0) return computeStatistics(computeConfusionMatrix(model, input_set));
+
+    math::clFMatrix empty;
+    for (size_t i = 0; i < n_samples; i++)
+      (void) model.predict(utils::cl_wrapper.getDefaultQueue(), empty);
+    return {};
+  }
+}   // namespace control
@@ -25,14 +25,13 @@ namespace control {
       auto end = chrono::steady_clock::now();
       auto duration = chrono::duration_cast<chrono::milliseconds>(end - start);
 
-      if (rank == 0) {
-        auto evaluation = evaluator->evaluate();
-        if (is_verbose) {
-          std::stringstream ss;
-          ss << "(" << duration.count() << "ms) Epoch " << curr_epoch << ": " << evaluation
-             << std::endl;
-          tscl::logger(ss.str(), tscl::Log::Information);
-        }
+      // Every process takes part in the evaluation, which may be distributed
+      auto evaluation = evaluator->evaluate();
+      if (rank == 0 and is_verbose) {
+        std::stringstream ss;
+        ss << "(" << duration.count() << "ms) Epoch " << curr_epoch << ": " << evaluation
+           << std::endl;
+        tscl::logger(ss.str(), tscl::Log::Information);
       }
     }
 
@@ -1,4 +1,5 @@
 #include "CNN.hpp"
+#include "CNNStorageBP.hpp"
 
 namespace nnet {
 
@@ -33,81 +34,70 @@ namespace nnet {
 
     math::clFTensor output = inputs.shallowCopy();
 
-    for (auto &layer : layers) {
-      output = layer->compute(queue, output);
-      queue.finish();
-      std::cout << "output INTERMEDIAIRE : " << output << std::endl;
+    for (size_t i = 0; i < layers.size(); i++) {
+      // A convolution followed by a pooling layer is computed by a single kernel
+      auto *convolution = dynamic_cast<CNNConvolutionLayer *>(layers[i].get());
+      auto *pooling = i + 1 < layers.size()
+                              ? dynamic_cast<CNNPoolingLayer *>(layers[i + 1].get())
+                              : nullptr;
+      if (convolution and pooling and convolution->supportsFusion(*pooling)) {
+        output = convolution->computeFused(queue, output, *pooling);
+        i++;
+      } else
+        output = layers[i]->compute(queue, output);
     }
 
-    reorganizeForward(queue, output, inputs.getDepth(),
-                      topology.getNBranchFinal());
+    // Predictions may run concurrently on several queues, so the buffer is not shared
+    math::clFTensor buffer;
+    reorganizeForward(queue, output, inputs.getDepth(), topology.getNBranchFinal(), buffer);
 
     queue.finish();
 
     return output;
   }
 
-  void reorganizeForward(cl::CommandQueue &queue, math::clFTensor &tensor, const size_t nInput,
-                         const size_t nBranch) {
-    if (nInput < 2 || nBranch < 2)
-    {
-      tensor.reshape(nBranch * tensor.getRows() * tensor.getCols(), 1, nInput);
-      return;
+  namespace {
+    /**
+     * @brief Swaps the two outer dimensions of a tensor whose matrices are laid out as
+     * (nOuter, nInner), with a single kernel launch
+     * @param res The tensor the matrices are written to, laid out as (nInner, nOuter). It is only
+     * reallocated if its size differs from the size of the input
+     */
+    void transposeBlocks(cl::CommandQueue &queue, const math::clFTensor &tensor,
+                         const size_t nInner, math::clFTensor &res) {
+      CNNStorageBP::reserve(res, tensor.getRows(), tensor.getCols(), tensor.getDepth());
+      auto kernel = utils::cl_wrapper.getKernels().getKernel("Tensor.cl", "transposeBlocks");
+      kernel.setArg(0, tensor.getBuffer());
+      kernel.setArg(1, (cl_ulong) tensor.getOffsetInFloats());
+      kernel.setArg(2, res.getBuffer());
+      kernel.setArg(3, (cl_ulong) res.getOffsetInFloats());
+      kernel.setArg(4, (cl_ulong) nInner);
+      queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                 cl::NDRange(tensor.getRows() * tensor.getCols(),
+                                             tensor.getDepth()),
+                                 cl::NullRange);
     }
+  }   // namespace
 
-    const size_t size_matrix = tensor.getRows() * tensor.getRows() * sizeof(float);
-    math::clFTensor buffer(tensor.getRows(), tensor.getCols(), (nInput - 1) * nBranch);
-
-    size_t index = 0;
-    for (size_t i = 1; i < nInput; i++) {
-      for (size_t j = 0; j < nBranch; j++) {
-        queue.enqueueCopyBuffer(tensor.getBuffer(), buffer.getBuffer(),
-                                tensor.getOffsetInBytes() + (i + j * nInput) * size_matrix,
-                                buffer.getOffsetInBytes() + index * size_matrix, size_matrix);
-        index++;
-      }
-    }
-
-    for (size_t i = 1; i < nBranch; i++) {
-      queue.enqueueCopyBuffer(tensor.getBuffer(), tensor.getBuffer(),
-                              tensor.getOffsetInBytes() + i * nInput * size_matrix,
-                              tensor.getOffsetInBytes() + i * size_matrix, size_matrix);
+  void reorganizeForward(cl::CommandQueue &queue, math::clFTensor &tensor, const size_t nInput,
+                         const size_t nBranch, math::clFTensor &buffer) {
+    const size_t output_size = nBranch * tensor.getRows() * tensor.getCols();
+    // The CNN output is branch-major, while the perceptron expects the branches of each input to
+    // be contiguous. When one of the dimensions is 1, both layouts are the same
+    if (nInput > 1 and nBranch > 1) {
+      transposeBlocks(queue, tensor, nInput, buffer);
+      tensor = buffer.shallowCopy();
     }
-
-    queue.enqueueCopyBuffer(buffer.getBuffer(), tensor.getBuffer(), buffer.getOffsetInBytes(),
-                            tensor.getOffsetInBytes() + nBranch * size_matrix,
-                            buffer.getDepth() * size_matrix);
-
-    tensor.reshape(nBranch * tensor.getRows() * tensor.getCols(), 1, nInput);
+    tensor.reshape(output_size, 1, nInput);
   }
 
   void reorganizeBackward(cl::CommandQueue &queue, math::clFTensor &tensor, const size_t nInput,
-                          const size_t nBranch, const std::pair<size_t, size_t> size) {
-    if (nInput < 2 || nBranch < 2) return;
-
+                          const size_t nBranch, const std::pair<size_t, size_t> size,
+                          math::clFTensor &buffer) {
     tensor.reshape(size.first, size.second, nInput * nBranch);
-
-    const size_t size_matrix = tensor.getRows() * tensor.getRows() * sizeof(float);
-    math::clFTensor buffer(tensor.getRows(), tensor.getCols(), (nInput - 1) * nBranch);
-
-    queue.enqueueCopyBuffer(tensor.getBuffer(), buffer.getBuffer(),
-                            tensor.getOffsetInBytes() + nBranch * size_matrix,
-                            buffer.getOffsetInBytes(), buffer.getDepth() * size_matrix);
-
-
-    for (size_t i = nBranch - 1; i > 0; i--) {
-      queue.enqueueCopyBuffer(tensor.getBuffer(), tensor.getBuffer(),
-                              tensor.getOffsetInBytes() + i * size_matrix,
-                              tensor.getOffsetInBytes() + i * nInput * size_matrix, size_matrix);
-    }
-
-    size_t index = 0;
-    for (size_t i = 1; i < nInput; i++) {
-      for (size_t j = 0; j < nBranch; j++) {
-        queue.enqueueCopyBuffer(buffer.getBuffer(), tensor.getBuffer(), index * size_matrix,
-                                (i + j * nInput) * size_matrix, size_matrix);
-        index++;
-      }
+    if (nInput > 1 and nBranch > 1) {
+      transposeBlocks(queue, tensor, nBranch, buffer);
+      tensor = buffer.shallowCopy();
     }
   }
 
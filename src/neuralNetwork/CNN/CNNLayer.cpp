@@ -4,58 +4,293 @@
 namespace nnet {
 
   namespace {
-    math::clFTensor reduceFilter(cl::CommandQueue &queue, const math::clFTensor &tensor,
-                                 const size_t nInput, const size_t nFilter, const size_t nBranch) {
-      const size_t n_total_filter = nFilter * nBranch;
-      math::clFTensor res(tensor.getRows(), tensor.getCols(), n_total_filter);
-      res.fill(0.f, queue, false);
-
-
-      const size_t n = tensor.getRows() * tensor.getCols();
-      std::vector<float> alphas(n_total_filter, 1.f);
+    // Must match the definitions of Convolution.cl
+    constexpr size_t kDirectWorkGroupSize = 8;
+    constexpr size_t kDirectTileSize = 16;
+
+    // Inputs up to this number of pixels are convolved by the direct kernels, whose single launch
+    // costs less than the im2col expansion and the GEMM setup on small images
+    constexpr size_t kDirectMaxInputPixels = 32 * 32;
+    // Upper bound of the local memory used by the direct kernels, in floats
+    constexpr size_t kDirectMaxLocalFloats = 4096;
+
+    // Must match the definition of Convolution.cl
+    constexpr size_t kFusedWorkGroupSize = 16;
+    // Upper bound of the local memory used by the fused convolution and pooling, in floats
+    constexpr size_t kFusedMaxLocalFloats = 4096;
+
+    /**
+     * @brief Returns the rows and columns of the activated convolution held in local memory by a
+     * work-group of the fused kernel
+     */
+    std::pair<size_t, size_t> fusedRegionSize(const CNNPoolingLayer &pooling) {
+      const auto &pool_size = pooling.getPoolingSize();
+      const auto &pool_stride = pooling.getStride();
+      return {(kFusedWorkGroupSize - 1) * pool_stride.first + pool_size.first,
+              (kFusedWorkGroupSize - 1) * pool_stride.second + pool_size.second};
+    }
 
-      std::vector<size_t> x_offset(n_total_filter);
-      std::vector<size_t> res_offset(n_total_filter);
-      for (size_t i = 0; i < x_offset.size(); i++) {
-        x_offset[i] = nInput * i * n;
-        res_offset[i] = i * n;
-      }
+    /**
+     * @brief Returns the number of floats of the input tile and of the error tile held in local
+     * memory by the direct kernels
+     */
+    std::pair<size_t, size_t> directTileFloats(const std::pair<size_t, size_t> kernelSize,
+                                               const std::pair<size_t, size_t> stride) {
+      const size_t input_tile = ((kDirectTileSize - 1) * stride.first + kernelSize.first) *
+                                ((kDirectTileSize - 1) * stride.second + kernelSize.second);
+      const size_t error_tile = ((kDirectTileSize + kernelSize.first - 2) / stride.first + 2) *
+                                ((kDirectTileSize + kernelSize.second - 2) / stride.second + 2);
+      return {input_tile, error_tile};
+    }
 
-      for (size_t i = 0; i < nInput; i++) {
-        clblast::AxpyBatched<float>(n, alphas.data(), tensor.getBuffer()(), x_offset.data(), 1,
-                                    res.getBuffer()(), res_offset.data(), 1, n_total_filter,
-                                    &queue(), nullptr);
-        for (auto &val : x_offset) val += n;
-      }
-      res.ipscale(1.f / static_cast<float>(nInput), queue);
-      return res;
+    /**
+     * @brief Returns the global range of the direct kernels for images of the given size
+     */
+    cl::NDRange directRange(const std::pair<size_t, size_t> imageSize, const size_t nImage) {
+      const size_t groups_h = (imageSize.first + kDirectTileSize - 1) / kDirectTileSize;
+      const size_t groups_w = (imageSize.second + kDirectTileSize - 1) / kDirectTileSize;
+      return {groups_w * kDirectWorkGroupSize, groups_h * kDirectWorkGroupSize, nImage};
     }
 
-    math::clFTensor reduceInput(cl::CommandQueue &queue, const math::clFTensor &tensor,
-                                const size_t nInput, const size_t nFilter, const size_t nBranch) {
-      math::clFTensor res(tensor.getRows(), tensor.getCols(), nInput * nBranch);
-      res.fill(0.f, queue, false);
+    /**
+     * @brief Builds the im2col matrix of every branch of the input with a single kernel launch
+     * @param input The input tensor, holding nBranch branches of images
+     * @param kernelSize The size of the filters
+     * @param outputSize The size of the output of the convolution
+     * @param nBranch The number of branches of the input
+     * @param stride The stride of the convolution
+     * @param padding The zero padding added on each side of the input
+     * @param res Receives a tensor of depth nBranch, whose matrices have
+     * (kernel rows * kernel cols) rows and (images per branch * output rows * output cols) columns
+     */
+    void im2col(cl::CommandQueue &queue, const math::clFTensor &input,
+                const std::pair<size_t, size_t> kernelSize,
+                const std::pair<size_t, size_t> outputSize, const size_t nBranch,
+                const std::pair<size_t, size_t> stride, const std::pair<size_t, size_t> padding,
+                math::clFTensor &res) {
+      const size_t n_input = input.getDepth() / nBranch;
+      const size_t n_kernel = kernelSize.first * kernelSize.second;
+      const size_t n_pixel = outputSize.first * outputSize.second;
+      CNNStorageBP::reserve(res, n_kernel, n_input * n_pixel, nBranch);
+
+      auto kernel = utils::cl_wrapper.getKernels().getKernel("Convolution.cl", "im2col");
+      kernel.setArg(0, input.getBuffer());
+      kernel.setArg(1, (cl_ulong) input.getOffsetInFloats());
+      kernel.setArg(2, res.getBuffer());
+      kernel.setArg(3, (cl_ulong) input.getRows());
+      kernel.setArg(4, (cl_ulong) input.getCols());
+      kernel.setArg(5, (cl_ulong) kernelSize.second);
+      kernel.setArg(6, (cl_ulong) outputSize.second);
+      kernel.setArg(7, (cl_ulong) n_input);
+      kernel.setArg(8, (cl_ulong) stride.first);
+      kernel.setArg(9, (cl_ulong) stride.second);
+      kernel.setArg(10, (cl_ulong) padding.first);
+      kernel.setArg(11, (cl_ulong) padding.second);
+      queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                 cl::NDRange(n_pixel, input.getDepth(), n_kernel), cl::NullRange);
+    }
 
-      const size_t n = tensor.getRows() * tensor.getCols();
-      std::vector<float> alphas(nInput, 1.f);
+    /**
+     * @brief Accumulates im2col matrices back into images. This is the adjoint of im2col
+     * @param col The im2col matrices, one per branch
+     * @param inputSize The size of the images to rebuild
+     * @param kernelSize The size of the filters
+     * @param outputSize The size of the output of the convolution
+     * @param nBranch The number of branches
+     * @param stride The stride of the convolution
+     * @param padding The zero padding added on each side of the input
+     * @param res Receives (images per branch * nBranch) images of size inputSize
+     */
+    void col2im(cl::CommandQueue &queue, const math::clFTensor &col,
+                const std::pair<size_t, size_t> inputSize,
+                const std::pair<size_t, size_t> kernelSize,
+                const std::pair<size_t, size_t> outputSize, const size_t nBranch,
+                const std::pair<size_t, size_t> stride, const std::pair<size_t, size_t> padding,
+                math::clFTensor &res) {
+      const size_t n_input = col.getCols() / (outputSize.first * outputSize.second);
+      CNNStorageBP::reserve(res, inputSize.first, inputSize.second, n_input * nBranch);
+
+      auto kernel = utils::cl_wrapper.getKernels().getKernel("Convolution.cl", "col2im");
+      kernel.setArg(0, col.getBuffer());
+      kernel.setArg(1, res.getBuffer());
+      kernel.setArg(2, (cl_ulong) inputSize.second);
+      kernel.setArg(3, (cl_ulong) kernelSize.first);
+      kernel.setArg(4, (cl_ulong) kernelSize.second);
+      kernel.setArg(5, (cl_ulong) outputSize.first);
+      kernel.setArg(6, (cl_ulong) outputSize.second);
+      kernel.setArg(7, (cl_ulong) n_input);
+      kernel.setArg(8, (cl_ulong) stride.first);
+      kernel.setArg(9, (cl_ulong) stride.second);
+      kernel.setArg(10, (cl_ulong) padding.first);
+      kernel.setArg(11, (cl_ulong) padding.second);
+      queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                                 cl::NDRange(inputSize.first * inputSize.second, res.getDepth()),
+                                 cl::NullRange);
+    }
 
-      std::vector<size_t> x_offset(nInput);
-      std::vector<size_t> res_offset(nInput);
-      for (size_t i = 0; i < x_offset.size(); i++) { x_offset[i] = res_offset[i] = i * n; }
+    /**
+     * @brief Convolves every branch of the input with its 3x3 filters, using the Winograd
+     * F(2x2, 3x3) algorithm. Each 2x2 output tile only requires 16 multiplications, instead of 36
+     * for the direct convolution.
+     * The input tiles and the filters are transformed, multiplied element-wise by a batched GEMM
+     * (one per element of the 4x4 transformed tile and per branch), and transformed back
+     * @param input The input tensor, holding nBranch branches of images
+     * @param filters The 3x3 filters, nFilter per branch
+     * @param outputSize The size of the output of the convolution
+     * @param padding The zero padding added on each side of the input
+     * @param workspace Holds the transformed tensors, and receives the output of the convolution
+     * before the activation function
+     */
+    void winogradConvolution(cl::CommandQueue &queue, const math::clFTensor &input,
+                             const math::clFTensor &filters,
+                             const std::pair<size_t, size_t> outputSize, const size_t nBranch,
+                             const size_t nFilter, const std::pair<size_t, size_t> padding,
+                             CNNStorageBPConvolution &workspace) {
+      constexpr size_t kTileElements = 16;
+      const size_t n_input = input.getDepth() / nBranch;
+      const size_t tiles_h = (outputSize.first + 1) / 2;
+      const size_t tiles_w = (outputSize.second + 1) / 2;
+      const size_t n_tile = tiles_h * tiles_w;
+      const size_t n_output = nBranch * nFilter * n_input;
+
+      auto &u = workspace.winograd_filters;
+      CNNStorageBP::reserve(u, nBranch * nFilter, 1, kTileElements);
+      auto filter_kernel =
+              utils::cl_wrapper.getKernels().getKernel("Convolution.cl", "winogradFilter");
+      filter_kernel.setArg(0, filters.getBuffer());
+      filter_kernel.setArg(1, (cl_ulong) filters.getOffsetInFloats());
+      filter_kernel.setArg(2, u.getBuffer());
+      queue.enqueueNDRangeKernel(filter_kernel, cl::NullRange, cl::NDRange(filters.getDepth()),
+                                 cl::NullRange);
+
+      auto &v = workspace.winograd_inputs;
+      CNNStorageBP::reserve(v, input.getDepth(), n_tile, kTileElements);
+      auto input_kernel =
+              utils::cl_wrapper.getKernels().getKernel("Convolution.cl", "winogradInput");
+      input_kernel.setArg(0, input.getBuffer());
+      input_kernel.setArg(1, (cl_ulong) input.getOffsetInFloats());
+      input_kernel.setArg(2, v.getBuffer());
+      input_kernel.setArg(3, (cl_ulong) input.getRows());
+      input_kernel.setArg(4, (cl_ulong) input.getCols());
+      input_kernel.setArg(5, (cl_ulong) tiles_w);
+      input_kernel.setArg(6, (cl_ulong) padding.first);
+      input_kernel.setArg(7, (cl_ulong) padding.second);
+      queue.enqueueNDRangeKernel(input_kernel, cl::NullRange,
+                                 cl::NDRange(n_tile, input.getDepth()), cl::NullRange);
+
+      // In the transformed domain, each filter multiplies every tile of every input of its
+      // branch: this is an outer product of the (nFilter) filters of the branch by its
+      // (n_input * n_tile) tiles, computed for every element and every branch at once
+      auto &m = workspace.winograd_outputs;
+      CNNStorageBP::reserve(m, n_output, n_tile, kTileElements);
+      clblast::GemmStridedBatched<float>(
+              clblast::Layout::kRowMajor, clblast::Transpose::kNo, clblast::Transpose::kNo, nFilter,
+              n_input * n_tile, 1, 1.f, u.getBuffer()(), 0, 1, nFilter, v.getBuffer()(), 0,
+              n_input * n_tile, n_input * n_tile, 0.f, m.getBuffer()(), 0, n_input * n_tile,
+              nFilter * n_input * n_tile, kTileElements * nBranch, &queue(), nullptr);
+
+      auto &res = workspace.output;
+      CNNStorageBP::reserve(res, outputSize.first, outputSize.second, n_output);
+      auto output_kernel =
+              utils::cl_wrapper.getKernels().getKernel("Convolution.cl", "winogradOutput");
+      output_kernel.setArg(0, m.getBuffer());
+      output_kernel.setArg(1, res.getBuffer());
+      output_kernel.setArg(2, (cl_ulong) outputSize.first);
+      output_kernel.setArg(3, (cl_ulong) outputSize.second);
+      output_kernel.setArg(4, (cl_ulong) tiles_w);
+      queue.enqueueNDRangeKernel(output_kernel, cl::NullRange, cl::NDRange(n_tile, n_output),
+                                 cl::NullRange);
+    }
 
-      const size_t batch_count = nInput;
+    /**
+     * @brief Convolves every branch of the input with its filters using the direct kernel, which
+     * keeps the filters and a tile of the input in local memory
+     * @param input The input tensor, holding nBranch branches of images
+     * @param filters The filters, nFilter per branch
+     * @param outputSize The size of the output of the convolution
+     * @param res Receives the output of the convolution, before the activation function
+     */
+    void directConvolution(cl::CommandQueue &queue, const math::clFTensor &input,
+                           const math::clFTensor &filters,
+                           const std::pair<size_t, size_t> outputSize, const size_t nBranch,
+                           const size_t nFilter, const std::pair<size_t, size_t> stride,
+                           const std::pair<size_t, size_t> padding, math::clFTensor &res) {
+      const size_t n_input = input.getDepth() / nBranch;
+      const size_t n_kernel = filters.getRows() * filters.getCols();
+      const size_t tile_floats =
+              directTileFloats({filters.getRows(), filters.getCols()}, stride).first;
+      CNNStorageBP::reserve(res, outputSize.first, outputSize.second, nBranch * nFilter * n_input);
+
+      auto kernel = utils::cl_wrapper.getKernels().getKernel("Convolution.cl", "directConvolution");
+      kernel.setArg(0, input.getBuffer());
+      kernel.setArg(1, (cl_ulong) input.getOffsetInFloats());
+      kernel.setArg(2, filters.getBuffer());
+      kernel.setArg(3, (cl_ulong) filters.getOffsetInFloats());
+      kernel.setArg(4, res.getBuffer());
+      kernel.setArg(5, (cl_ulong) input.getRows());
+      kernel.setArg(6, (cl_ulong) input.getCols());
+      kernel.setArg(7, (cl_ulong) outputSize.first);
+      kernel.setArg(8, (cl_ulong) outputSize.second);
+      kernel.setArg(9, (cl_ulong) filters.getRows());
+      kernel.setArg(10, (cl_ulong) filters.getCols());
+      kernel.setArg(11, (cl_ulong) stride.first);
+      kernel.setArg(12, (cl_ulong) stride.second);
+      kernel.setArg(13, (cl_ulong) padding.first);
+      kernel.setArg(14, (cl_ulong) padding.second);
+      kernel.setArg(15, (cl_ulong) n_input);
+      kernel.setArg(16, (cl_ulong) nFilter);
+      kernel.setArg(17, cl::Local(tile_floats * sizeof(float)));
+      kernel.setArg(18, cl::Local(nFilter * n_kernel * sizeof(float)));
+      queue.enqueueNDRangeKernel(kernel, cl::NullRange, directRange(outputSize, input.getDepth()),
+                                 cl::NDRange(kDirectWorkGroupSize, kDirectWorkGroupSize, 1));
+    }
 
-      for (size_t i = 0; i < nBranch; i++) {
-        for (size_t j = 0; j < nFilter; j++) {
-          clblast::AxpyBatched<float>(n, alphas.data(), tensor.getBuffer()(), x_offset.data(), 1,
-                                      res.getBuffer()(), res_offset.data(), 1, batch_count,
-                                      &queue(), nullptr);
-          for (auto &val : x_offset) { val += batch_count * n; }
-        }
-        for (auto &val : res_offset) { val += batch_count * n; }
-      }
-      res.ipscale(1.f / static_cast<float>(nInput), queue);
-      return res;
+    /**
+     * @brief Computes the error on the inputs of a convolution using the direct kernel
+     * @param errors The errors on the output of the convolution, laid out as
+     * [branch][filter][input]
+     * @param filters The filters, nFilter per branch
+     * @param inputSize The size of the inputs of the convolution
+     * @param alpha The factor applied to the errors, summed over the filters of each branch
+     * @param res Receives the error on each input
+     */
+    void directConvolutionInputError(cl::CommandQueue &queue, const math::clFTensor &errors,
+                                     const math::clFTensor &filters,
+                                     const std::pair<size_t, size_t> inputSize,
+                                     const size_t nBranch, const size_t nFilter,
+                                     const std::pair<size_t, size_t> stride,
+                                     const std::pair<size_t, size_t> padding, const float alpha,
+                                     math::clFTensor &res) {
+      const size_t n_image = errors.getDepth() / nFilter;
+      const size_t n_kernel = filters.getRows() * filters.getCols();
+      const size_t tile_floats =
+              directTileFloats({filters.getRows(), filters.getCols()}, stride).second;
+      CNNStorageBP::reserve(res, inputSize.first, inputSize.second, n_image);
+
+      auto kernel = utils::cl_wrapper.getKernels().getKernel("Convolution.cl",
+                                                             "directConvolutionInputError");
+      kernel.setArg(0, errors.getBuffer());
+      kernel.setArg(1, (cl_ulong) errors.getOffsetInFloats());
+      kernel.setArg(2, filters.getBuffer());
+      kernel.setArg(3, (cl_ulong) filters.getOffsetInFloats());
+      kernel.setArg(4, res.getBuffer());
+      kernel.setArg(5, (cl_ulong) inputSize.first);
+      kernel.setArg(6, (cl_ulong) inputSize.second);
+      kernel.setArg(7, (cl_ulong) errors.getRows());
+      kernel.setArg(8, (cl_ulong) errors.getCols());
+      kernel.setArg(9, (cl_ulong) filters.getRows());
+      kernel.setArg(10, (cl_ulong) filters.getCols());
+      kernel.setArg(11, (cl_ulong) stride.first);
+      kernel.setArg(12, (cl_ulong) stride.second);
+      kernel.setArg(13, (cl_ulong) padding.first);
+      kernel.setArg(14, (cl_ulong) padding.second);
+      kernel.setArg(15, (cl_ulong) (n_image / nBranch));
+      kernel.setArg(16, (cl_ulong) nFilter);
+      kernel.setArg(17, alpha);
+      kernel.setArg(18, cl::Local(tile_floats * sizeof(float)));
+      kernel.setArg(19, cl::Local(nFilter * n_kernel * sizeof(float)));
+      queue.enqueueNDRangeKernel(kernel, cl::NullRange, directRange(inputSize, n_image),
+                                 cl::NDRange(kDirectWorkGroupSize, kDirectWorkGroupSize, 1));
     }
   }   // namespace
 
@@ -69,13 +304,17 @@ namespace nnet {
                                            const std::pair<size_t, size_t> sizeFilter,
                                            const size_t nFilter,
                                            const af::ActivationFunctionType aFunction,
-                                           const size_t nBranch)
-      : CNNLayer(outputSize), n_branch(nBranch), n_filter(nFilter),
-        filters(sizeFilter.first, sizeFilter.second, nFilter * nBranch), a_function(aFunction) {}
+                                           const size_t nBranch,
+                                           const std::pair<size_t, size_t> stride,
+                                           const std::pair<size_t, size_t> padding)
+      : CNNLayer(outputSize), n_branch(nBranch), n_filter(nFilter), stride(stride),
+        padding(padding), filters(sizeFilter.first, sizeFilter.second, nFilter * nBranch),
+        a_function(aFunction) {}
 
   CNNConvolutionLayer::CNNConvolutionLayer(const CNNConvolutionLayer &other)
       : CNNLayer(other.outputSize), n_branch(other.n_branch), n_filter(other.n_filter),
-        a_function(other.a_function) {
+        stride(other.stride), padding(other.padding), a_function(other.a_function),
+        algorithm(other.algorithm) {
     // TODO : check if the copy is good
     filters.copy(other.filters, utils::cl_wrapper.getDefaultQueue(), true);
   }
@@ -88,33 +327,145 @@ namespace nnet {
     filters.copy(weights, utils::cl_wrapper.getDefaultQueue(), true);
   }
 
+  void CNNConvolutionLayer::setAlgorithm(ConvolutionAlgorithm algo) {
+    if (algo == ConvolutionAlgorithm::winograd and not supportsWinograd())
+      throw std::invalid_argument("CNNConvolutionLayer::setAlgorithm: Winograd requires 3x3 "
+                                  "filters with a stride of 1");
+    if (algo == ConvolutionAlgorithm::direct and not supportsDirect())
+      throw std::invalid_argument("CNNConvolutionLayer::setAlgorithm: The filters are too large "
+                                  "for the direct convolution");
+    algorithm = algo;
+  }
+
+  bool CNNConvolutionLayer::supportsWinograd() const {
+    return filters.getRows() == 3 and filters.getCols() == 3 and stride.first == 1 and
+           stride.second == 1;
+  }
+
+  bool CNNConvolutionLayer::supportsDirect() const {
+    auto [input_tile, error_tile] =
+            directTileFloats({filters.getRows(), filters.getCols()}, stride);
+    return std::max(input_tile, error_tile) + n_filter * filters.getRows() * filters.getCols() <=
+           kDirectMaxLocalFloats;
+  }
+
+  ConvolutionAlgorithm CNNConvolutionLayer::selectAlgorithm(const math::clFTensor &input) const {
+    if (algorithm != ConvolutionAlgorithm::automatic) return algorithm;
+    if (input.getRows() * input.getCols() <= kDirectMaxInputPixels and supportsDirect())
+      return ConvolutionAlgorithm::direct;
+    if (supportsWinograd()) return ConvolutionAlgorithm::winograd;
+    return ConvolutionAlgorithm::gemm;
+  }
+
   math::clFTensor CNNConvolutionLayer::compute(cl::CommandQueue &queue,
                                                const math::clFTensor &input) {
-    std::cout << "call compute : branch{" << n_branch << "}, filter{" << n_filter << "}"
-              << std::endl;
-
-    const size_t output_size_z = n_branch * n_filter * input.getDepth() / n_branch;
-    math::clFTensor res(outputSize.first, outputSize.second, output_size_z);
-
-    auto sub_input = input.slice(n_branch);
-    auto sub_filter = filters.slice(n_branch);
-    auto sub_output = res.slice(n_branch * n_filter);
-
-    size_t index_out = 0;
-    for (size_t i = 0; i < n_branch; i++) {
-      for (size_t j = 0; j < sub_filter[i].getDepth(); j++) {
-        clblast::Convgemm<float>(clblast::KernelMode::kCrossCorrelation, 1, input.getRows(),
-                                 input.getCols(), filters.getRows(), filters.getCols(), 0, 0, 1, 1,
-                                 1, 1, 1, sub_input[i].getDepth(), sub_input[i].getBuffer()(),
-                                 sub_input[i].getOffsetInFloats(), sub_filter[i][j].getBuffer()(),
-                                 sub_filter[i][j].getOffset(), sub_output[index_out].getBuffer()(),
-                                 sub_output[index_out].getOffsetInFloats(), &queue(), nullptr);
-        index_out++;
+    // The prediction does not keep anything between two calls
+    CNNStorageBPConvolution workspace;
+    return convolve(queue, input, workspace);
+  }
+
+  bool CNNConvolutionLayer::supportsFusion(const CNNPoolingLayer &pooling) const {
+    auto [region_h, region_w] = fusedRegionSize(pooling);
+    return region_h * region_w <= kFusedMaxLocalFloats;
+  }
+
+  math::clFTensor CNNConvolutionLayer::computeFused(cl::CommandQueue &queue,
+                                                    const math::clFTensor &input,
+                                                    const CNNPoolingLayer &pooling) const {
+    if (not supportsFusion(pooling))
+      throw std::invalid_argument("CNNConvolutionLayer::computeFused: The pooling windows are too "
+                                  "large for the fused kernel");
+
+    const size_t n_input = input.getDepth() / n_branch;
+    const size_t n_map = n_branch * n_filter * n_input;
+    const auto &pooled_size = pooling.getOutputSize();
+    const auto &pool_size = pooling.getPoolingSize();
+    const auto &pool_stride = pooling.getStride();
+    const auto &pool_padding = pooling.getPadding();
+    auto [region_h, region_w] = fusedRegionSize(pooling);
+    math::clFTensor res(pooled_size.first, pooled_size.second, n_map);
+
+    auto kernel =
+            utils::cl_wrapper.getKernels().getKernel("Convolution.cl", "fusedConvolutionPooling");
+    kernel.setArg(0, input.getBuffer());
+    kernel.setArg(1, (cl_ulong) input.getOffsetInFloats());
+    kernel.setArg(2, filters.getBuffer());
+    kernel.setArg(3, (cl_ulong) filters.getOffsetInFloats());
+    kernel.setArg(4, res.getBuffer());
+    kernel.setArg(5, (cl_ulong) input.getRows());
+    kernel.setArg(6, (cl_ulong) input.getCols());
+    kernel.setArg(7, (cl_ulong) outputSize.first);
+    kernel.setArg(8, (cl_ulong) outputSize.second);
+    kernel.setArg(9, (cl_ulong) filters.getRows());
+    kernel.setArg(10, (cl_ulong) filters.getCols());
+    kernel.setArg(11, (cl_ulong) stride.first);
+    kernel.setArg(12, (cl_ulong) stride.second);
+    kernel.setArg(13, (cl_ulong) padding.first);
+    kernel.setArg(14, (cl_ulong) padding.second);
+    kernel.setArg(15, (cl_ulong) pooled_size.first);
+    kernel.setArg(16, (cl_ulong) pooled_size.second);
+    kernel.setArg(17, (cl_ulong) pool_size.first);
+    kernel.setArg(18, (cl_ulong) pool_size.second);
+    kernel.setArg(19, (cl_ulong) pool_stride.first);
+    kernel.setArg(20, (cl_ulong) pool_stride.second);
+    kernel.setArg(21, (cl_ulong) pool_padding.first);
+    kernel.setArg(22, (cl_ulong) pool_padding.second);
+    kernel.setArg(23, (cl_ulong) n_input);
+    kernel.setArg(24, (cl_ulong) n_filter);
+    kernel.setArg(25, (cl_int) a_function);
+    kernel.setArg(26, (cl_int) (pooling.getPoolingType() == PoolingType::MAX));
+    kernel.setArg(27, cl::Local(region_h * region_w * sizeof(float)));
+
+    const size_t groups_h = (pooled_size.first + kFusedWorkGroupSize - 1) / kFusedWorkGroupSize;
+    const size_t groups_w = (pooled_size.second + kFusedWorkGroupSize - 1) / kFusedWorkGroupSize;
+    queue.enqueueNDRangeKernel(
+            kernel, cl::NullRange,
+            cl::NDRange(groups_w * kFusedWorkGroupSize, groups_h * kFusedWorkGroupSize, n_map),
+            cl::NDRange(kFusedWorkGroupSize, kFusedWorkGroupSize, 1));
+    return res;
+  }
+
+  math::clFTensor CNNConvolutionLayer::convolve(cl::CommandQueue &queue,
+                                                const math::clFTensor &input,
+                                                CNNStorageBPConvolution &workspace) {
+    const std::pair<size_t, size_t> filter_size = {filters.getRows(), filters.getCols()};
+    workspace.has_input_col = false;
+
+    switch (selectAlgorithm(input)) {
+      case ConvolutionAlgorithm::direct:
+        directConvolution(queue, input, filters, outputSize, n_branch, n_filter, stride, padding,
+                          workspace.output);
+        break;
+      case ConvolutionAlgorithm::winograd:
+        winogradConvolution(queue, input, filters, outputSize, n_branch, n_filter, padding,
+                            workspace);
+        break;
+      default: {
+        const size_t n_input = input.getDepth() / n_branch;
+        const size_t n_kernel = filter_size.first * filter_size.second;
+        const size_t n_pixel = outputSize.first * outputSize.second;
+        im2col(queue, input, filter_size, outputSize, n_branch, stride, padding,
+               workspace.input_col);
+        workspace.has_input_col = true;
+        CNNStorageBP::reserve(workspace.output, outputSize.first, outputSize.second,
+                              n_filter * input.getDepth());
+
+        // The filters of a branch form a (n_filter, n_kernel) matrix, and its im2col matrix a
+        // (n_kernel, n_input * n_pixel) matrix. Their product is the output of the branch, laid
+        // out filter-major as expected by the next layer. Every branch is computed by the same
+        // batched GEMM
+        clblast::GemmStridedBatched<float>(
+                clblast::Layout::kRowMajor, clblast::Transpose::kNo, clblast::Transpose::kNo,
+                n_filter, n_input * n_pixel, n_kernel, 1.f, filters.getBuffer()(),
+                filters.getOffsetInFloats(), n_kernel, n_filter * n_kernel,
+                workspace.input_col.getBuffer()(), 0, n_input * n_pixel,
+                n_kernel * n_input * n_pixel, 0.f, workspace.output.getBuffer()(), 0,
+                n_input * n_pixel, n_filter * n_input * n_pixel, n_branch, &queue(), nullptr);
       }
     }
 
-    applyAF(a_function, res, queue);
-    return res;
+    applyAF(a_function, workspace.output, queue);
+    return workspace.output.shallowCopy();
   }
 
 
@@ -123,7 +474,9 @@ namespace nnet {
                                                       CNNStorageBP &storage) {
     auto &convoStorage = static_cast<CNNStorageBPConvolution &>(storage);
     convoStorage.input = inputs.shallowCopy();
-    return compute(queue, inputs);
+    // Only the GEMM path builds the im2col matrices during the forward pass. Otherwise, they are
+    // built by the backward pass
+    return convolve(queue, inputs, convoStorage);
   }
 
 
@@ -131,202 +484,177 @@ namespace nnet {
                                                        const math::clFTensor &errors,
                                                        CNNStorageBP &storage) {
     auto &convoStorage = static_cast<CNNStorageBPConvolution &>(storage);
-    const size_t n_input = convoStorage.input.getDepth() / n_branch;
-
-    math::clFTensor res_filter = computeErrorFilter(queue, errors, convoStorage);
-
-    math::clFTensor res_input = computeErrorInput(queue, errors, convoStorage);
-    convoStorage.error_filter = reduceFilter(queue, res_filter, n_input, n_filter, n_branch);
-    return reduceInput(queue, res_input, n_input, n_filter, n_branch);
+    computeErrorFilter(queue, errors, convoStorage);
+    computeErrorInput(queue, errors, convoStorage);
+    return convoStorage.error_input.shallowCopy();
   }
 
-  math::clFTensor CNNConvolutionLayer::computeErrorFilter(cl::CommandQueue &queue,
-                                                          const math::clFTensor &errors,
-                                                          CNNStorageBPConvolution &storage) {
-    // compute filter error
-    math::clFTensor res_filter(filters.getRows(), filters.getCols(), errors.getDepth());
-    const size_t height = storage.input.getRows();
-    const size_t width = storage.input.getCols();
-    const size_t kernel_h = errors.getRows();
-    const size_t kernel_w = errors.getCols();
+  void CNNConvolutionLayer::computeErrorFilter(cl::CommandQueue &queue,
+                                               const math::clFTensor &errors,
+                                               CNNStorageBPConvolution &storage) {
+    const std::pair<size_t, size_t> filter_size = {filters.getRows(), filters.getCols()};
     const size_t n_input = storage.input.getDepth() / n_branch;
-
-    std::vector<math::clFTensor> sub_input = storage.input.slice(n_branch);
-    std::vector<math::clFTensor> sub_error = errors.slice(n_branch * n_filter);
-
-    size_t index = 0;
-    for (size_t i = 0; i < n_branch; i++) {
-      for (size_t j = 0; j < n_filter; j++) {
-        for (size_t k = 0; k < n_input; k++) {
-          clblast::Convgemm<float>(clblast::KernelMode::kCrossCorrelation, 1, height, width,
-                                   kernel_h, kernel_w, 0, 0, 1, 1, 1, 1, 1, 1,
-                                   sub_input[i][k].getBuffer()(), sub_input[i][k].getOffset(),
-                                   errors[index].getBuffer()(), errors[index].getOffset(),
-                                   res_filter[index].getBuffer()(), res_filter[index].getOffset(),
-                                   &queue(), nullptr);
-          index++;
-        }
-      }
+    const size_t n_kernel = filter_size.first * filter_size.second;
+    const size_t n_pixel = errors.getRows() * errors.getCols();
+    CNNStorageBP::reserve(storage.error_filter, filter_size.first, filter_size.second,
+                          n_branch * n_filter);
+    if (not storage.has_input_col) {
+      im2col(queue, storage.input, filter_size, outputSize, n_branch, stride, padding,
+             storage.input_col);
+      storage.has_input_col = true;
     }
-    return res_filter.shallowCopy();
+
+    // The errors of a branch form a (n_filter, n_input * n_pixel) matrix. Multiplying it by the
+    // transposed im2col matrix of the branch sums the gradients of every input in the K dimension
+    // of the GEMM, and alpha averages them
+    clblast::GemmStridedBatched<float>(
+            clblast::Layout::kRowMajor, clblast::Transpose::kNo, clblast::Transpose::kYes, n_filter,
+            n_kernel, n_input * n_pixel, 1.f / static_cast<float>(n_input), errors.getBuffer()(),
+            errors.getOffsetInFloats(), n_input * n_pixel, n_filter * n_input * n_pixel,
+            storage.input_col.getBuffer()(), 0, n_input * n_pixel, n_kernel * n_input * n_pixel,
+            0.f, storage.error_filter.getBuffer()(), 0, n_kernel, n_filter * n_kernel, n_branch,
+            &queue(), nullptr);
   }
 
 
-  math::clFTensor CNNConvolutionLayer::computeErrorInput(cl::CommandQueue &queue,
-                                                         const math::clFTensor &errors,
-                                                         CNNStorageBPConvolution &storage) {
-    math::clFTensor res_input(storage.input.getRows(), storage.input.getCols(), errors.getDepth());
-    // compute input error
-    const size_t height = errors.getRows();
-    const size_t width = errors.getCols();
-    const size_t kernel_h = filters.getRows();
-    const size_t kernel_w = filters.getCols();
-    const size_t batch_count = errors.getDepth() / (n_branch * n_filter);
-
-    std::vector<math::clFTensor> sub_error = errors.slice(n_branch * n_filter);
-    std::vector<math::clFTensor> sub_filter = filters.slice(n_branch * n_filter);
-
-    size_t index = 0;
-    for (size_t i = 0; i < n_branch; i++) {
-      for (size_t j = 0; j < n_filter; j++) {
-        clblast::Convgemm<float>(clblast::KernelMode::kConvolution, 1, height, width, kernel_h,
-                                 kernel_w, kernel_h - 1, kernel_w - 1, 1, 1, 1, 1, 1, batch_count,
-                                 sub_error[i * n_filter + j].getBuffer()(),
-                                 sub_error[i * n_filter + j].getOffsetInFloats(),
-                                 sub_filter[i * n_filter + j].getBuffer()(),
-                                 sub_filter[i * n_filter + j].getOffsetInFloats(),
-                                 res_input[index].getBuffer()(), res_input[index].getOffset(),
-                                 &queue(), nullptr);
-        index += batch_count;
-      }
+  void CNNConvolutionLayer::computeErrorInput(cl::CommandQueue &queue,
+                                              const math::clFTensor &errors,
+                                              CNNStorageBPConvolution &storage) {
+    const std::pair<size_t, size_t> input_size = {storage.input.getRows(),
+                                                  storage.input.getCols()};
+    const size_t n_input = storage.input.getDepth() / n_branch;
+    if (selectAlgorithm(storage.input) == ConvolutionAlgorithm::direct) {
+      directConvolutionInputError(queue, errors, filters, input_size, n_branch, n_filter, stride,
+                                  padding, 1.f / static_cast<float>(n_input),
+                                  storage.error_input);
+      return;
     }
-    return res_input;
+
+    const size_t n_kernel = filters.getRows() * filters.getCols();
+    const size_t n_pixel = errors.getRows() * errors.getCols();
+    CNNStorageBP::reserve(storage.col_error, n_kernel, n_input * n_pixel, n_branch);
+
+    // The transposed filters of a branch spread the errors of its outputs over the elements of
+    // the kernel, summing the contributions of every filter. col2im then accumulates them back
+    // onto the input pixels. Like the filter error, the result is averaged over the inputs
+    clblast::GemmStridedBatched<float>(
+            clblast::Layout::kRowMajor, clblast::Transpose::kYes, clblast::Transpose::kNo, n_kernel,
+            n_input * n_pixel, n_filter, 1.f / static_cast<float>(n_input), filters.getBuffer()(),
+            filters.getOffsetInFloats(), n_kernel, n_filter * n_kernel, errors.getBuffer()(),
+            errors.getOffsetInFloats(), n_input * n_pixel, n_filter * n_input * n_pixel, 0.f,
+            storage.col_error.getBuffer()(), 0, n_input * n_pixel, n_kernel * n_input * n_pixel,
+            n_branch, &queue(), nullptr);
+
+    col2im(queue, storage.col_error, input_size, {filters.getRows(), filters.getCols()},
+           outputSize, n_branch, stride, padding, storage.error_input);
   }
 
 
   CNNPoolingLayer::CNNPoolingLayer(const std::pair<size_t, size_t> outputSize,
-                                   const std::pair<size_t, size_t> poolSize)
-      : CNNLayer(outputSize), poolingSize(poolSize) {}
+                                   const std::pair<size_t, size_t> poolSize,
+                                   const std::pair<size_t, size_t> stride,
+                                   const std::pair<size_t, size_t> padding)
+      : CNNLayer(outputSize), poolingSize(poolSize), stride(stride), padding(padding) {}
 
 
   CNNMaxPoolingLayer::CNNMaxPoolingLayer(const std::pair<size_t, size_t> outputSize,
-                                         const std::pair<size_t, size_t> poolSize)
-      : CNNPoolingLayer(outputSize, poolSize) {}
+                                         const std::pair<size_t, size_t> poolSize,
+                                         const std::pair<size_t, size_t> stride,
+                                         const std::pair<size_t, size_t> padding)
+      : CNNPoolingLayer(outputSize, poolSize, stride, padding) {}
 
   CNNMaxPoolingLayer::CNNMaxPoolingLayer(const CNNMaxPoolingLayer &other)
-      : CNNPoolingLayer(other.outputSize, other.poolingSize) {}
+      : CNNPoolingLayer(other.outputSize, other.poolingSize, other.stride, other.padding) {}
 
   std::unique_ptr<CNNLayer> CNNMaxPoolingLayer::copy() const {
     return std::make_unique<CNNMaxPoolingLayer>(*this);
   }
 
   math::clFTensor CNNMaxPoolingLayer::compute(cl::CommandQueue &queue,
-                                              const math::clFTensor &inputs) {
-    math::clFTensor res(outputSize.first, outputSize.second, inputs.getDepth());
-    for (size_t ii = 0; ii < inputs.getDepth(); ii++) {
-      math::FloatMatrix _input = inputs[ii].toFloatMatrix(true);
-      math::FloatMatrix _output = res[ii].toFloatMatrix(true);
-
-      size_t rowsPos = 0, colsPos = 0;
-
-      for (size_t i = 0; i < _output.getRows(); i++) {
-        for (size_t j = 0; j < _output.getCols(); j++) {
-          float max = _input(rowsPos, colsPos);
-          for (size_t k = 0; k < poolingSize.first; k++) {
-            for (size_t l = 0; l < poolingSize.second; l++) {
-              max = std::max(max, _input(k + rowsPos, l + colsPos));
-            }
-          }
-          _output(i, j) = max;
-          colsPos++;
-        }
-        colsPos = 0;
-        rowsPos++;
-      }
-      res[ii] = _output;
-    }
+                                              const math::clFTensor &input) {
+    math::clFTensor res;
+    pool(queue, input, res, nullptr);
     return res;
   }
 
+  void CNNMaxPoolingLayer::pool(cl::CommandQueue &queue, const math::clFTensor &input,
+                                math::clFTensor &res, cl::Buffer *indices) {
+    CNNStorageBP::reserve(res, outputSize.first, outputSize.second, input.getDepth());
+    // We need to return if the size is 0 else OpenCL will throw
+    if (input.getDepth() == 0) return;
+
+    auto kernel = utils::cl_wrapper.getKernels().getKernel(
+            "Pooling.cl", indices ? "maxPoolingForward" : "maxPooling");
+    cl_uint arg = 0;
+    kernel.setArg(arg++, input.getBuffer());
+    kernel.setArg(arg++, (cl_ulong) input.getOffsetInFloats());
+    kernel.setArg(arg++, res.getBuffer());
+    if (indices) kernel.setArg(arg++, *indices);
+    kernel.setArg(arg++, (cl_ulong) input.getRows());
+    kernel.setArg(arg++, (cl_ulong) input.getCols());
+    kernel.setArg(arg++, (cl_ulong) outputSize.second);
+    kernel.setArg(arg++, (cl_ulong) poolingSize.first);
+    kernel.setArg(arg++, (cl_ulong) poolingSize.second);
+    kernel.setArg(arg++, (cl_ulong) stride.first);
+    kernel.setArg(arg++, (cl_ulong) stride.second);
+    kernel.setArg(arg++, (cl_ulong) padding.first);
+    kernel.setArg(arg++, (cl_ulong) padding.second);
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                               cl::NDRange(outputSize.first * outputSize.second, input.getDepth()),
+                               cl::NullRange);
+  }
+
   math::clFTensor CNNMaxPoolingLayer::computeForward(cl::CommandQueue &queue,
                                                      const math::clFTensor &inputs,
                                                      CNNStorageBP &storage) {
     auto &poolingStorage = static_cast<CNNStorageBPMaxPooling &>(storage);
-    math::clFTensor res(outputSize.first, outputSize.second, inputs.getDepth());
-    for (size_t ii = 0; ii < inputs.getDepth(); ii++) {
-      math::FloatMatrix _input = inputs[ii].toFloatMatrix(true);
-      math::FloatMatrix _output = res[ii].toFloatMatrix(true);
-
-      math::Matrix<size_t> save_rows(outputSize.first, outputSize.second);
-      math::Matrix<size_t> save_cols(outputSize.first, outputSize.second);
-      save_rows.fill(0);
-      save_cols.fill(0);
-
-      size_t rowsPos = 0, colsPos = 0;
-      for (size_t i = 0; i < _output.getRows(); i++) {
-        for (size_t j = 0; j < _output.getCols(); j++) {
-          float max = _input(rowsPos, colsPos);
-          save_rows(i, j) = rowsPos;
-          save_cols(i, j) = colsPos;
-          for (size_t k = 0; k < poolingSize.first; k++) {
-            for (size_t l = 0; l < poolingSize.second; l++) {
-              if (max < _input(k + rowsPos, l + colsPos)) {
-                max = _input(k + rowsPos, l + colsPos);
-                save_rows(i, j) = k + rowsPos;
-                save_cols(i, j) = l + colsPos;
-              }
-            }
-          }
-          _output(i, j) = max;
-          colsPos++;
-        }
-        colsPos = 0;
-        rowsPos++;
-      }
-      poolingStorage.max_rows.push_back(std::move(save_rows));
-      poolingStorage.max_cols.push_back(std::move(save_cols));
-      res[ii] = _output;
-    }
-    return res;
+    // The indices of the maximums are overwritten by each batch
+    poolingStorage.reserveIndices(outputSize.first * outputSize.second * inputs.getDepth());
+    pool(queue, inputs, poolingStorage.output, &poolingStorage.max_indices);
+    return poolingStorage.output.shallowCopy();
   }
 
   math::clFTensor CNNMaxPoolingLayer::computeBackward(cl::CommandQueue &queue,
                                                       const math::clFTensor &errors,
                                                       CNNStorageBP &storage) {
     auto &poolingStorage = static_cast<CNNStorageBPMaxPooling &>(storage);
-
-    math::clFTensor res(poolingStorage.input_size.first, poolingStorage.input_size.second,
-                        errors.getDepth());
-    for (size_t ii = 0; ii < errors.getDepth(); ii++) {
-      math::FloatMatrix error_output = errors[ii].toFloatMatrix(true);
-      math::FloatMatrix error_input = res[ii].toFloatMatrix(true);
-      error_input.fill(0.f);
-
-      math::Matrix<size_t> &save_rows = poolingStorage.max_rows[ii];
-      math::Matrix<size_t> &save_cols = poolingStorage.max_cols[ii];
-
-      for (size_t i = 0; i < errors.getRows(); i++) {
-        for (size_t j = 0; j < errors.getCols(); j++) {
-          error_input(save_rows(i, j), save_cols(i, j)) += error_output(i, j);
-        }
-      }
-      res[ii] = error_input;
-    }
-    return res;
+    const auto &input_size = poolingStorage.input_size;
+    auto &res = poolingStorage.error_input;
+    CNNStorageBP::reserve(res, input_size.first, input_size.second, errors.getDepth());
+    // We need to return if the size is 0 else OpenCL will throw
+    if (errors.getDepth() == 0) return res.shallowCopy();
+    if (poolingStorage.max_indices_capacity < errors.size())
+      throw std::runtime_error(
+              "CNNMaxPoolingLayer::computeBackward: called without a forward pass");
+
+    auto kernel = utils::cl_wrapper.getKernels().getKernel("Pooling.cl", "maxPoolingBackward");
+    kernel.setArg(0, errors.getBuffer());
+    kernel.setArg(1, (cl_ulong) errors.getOffsetInFloats());
+    kernel.setArg(2, poolingStorage.max_indices);
+    kernel.setArg(3, res.getBuffer());
+    kernel.setArg(4, (cl_ulong) input_size.second);
+    kernel.setArg(5, (cl_ulong) errors.getRows());
+    kernel.setArg(6, (cl_ulong) errors.getCols());
+    kernel.setArg(7, (cl_ulong) poolingSize.first);
+    kernel.setArg(8, (cl_ulong) poolingSize.second);
+    kernel.setArg(9, (cl_ulong) stride.first);
+    kernel.setArg(10, (cl_ulong) stride.second);
+    kernel.setArg(11, (cl_ulong) padding.first);
+    kernel.setArg(12, (cl_ulong) padding.second);
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                               cl::NDRange(input_size.first * input_size.second, res.getDepth()),
+                               cl::NullRange);
+    return res.shallowCopy();
   }
 
   CNNAvgPoolingLayer::CNNAvgPoolingLayer(const std::pair<size_t, size_t> outputSize,
-                                         const std::pair<size_t, size_t> poolSize)
-      : CNNPoolingLayer(outputSize, poolSize), filter(poolSize.first, poolSize.second, 1) {
-    // TODO : faire attention a la queu sur laquel on fait le calcul
-    filter[0].fill(1.f, utils::cl_wrapper.getDefaultQueue(), true);
-  }
+                                         const std::pair<size_t, size_t> poolSize,
+                                         const std::pair<size_t, size_t> stride,
+                                         const std::pair<size_t, size_t> padding)
+      : CNNPoolingLayer(outputSize, poolSize, stride, padding) {}
 
   CNNAvgPoolingLayer::CNNAvgPoolingLayer(const CNNAvgPoolingLayer &other)
-      : CNNPoolingLayer(other.outputSize, other.poolingSize) {
-    // TODO : je crois je fais de ma merde
-    filter.copy(other.filter, utils::cl_wrapper.getDefaultQueue(), true);
-  }
+      : CNNPoolingLayer(other.outputSize, other.poolingSize, other.stride, other.padding) {}
 
   std::unique_ptr<CNNLayer> CNNAvgPoolingLayer::copy() const {
     return std::make_unique<CNNAvgPoolingLayer>(*this);
@@ -334,59 +662,69 @@ namespace nnet {
 
   math::clFTensor CNNAvgPoolingLayer::compute(cl::CommandQueue &queue,
                                               const math::clFTensor &input) {
-    math::clFTensor res(outputSize.first, outputSize.second, input.getDepth());
-
-    clblast::Convgemm<float>(clblast::KernelMode::kCrossCorrelation, 1, input.getRows(),
-                             input.getCols(), filter.getRows(), filter.getCols(), 0, 0, 1, 1, 1, 1,
-                             1, input.getDepth(), input.getBuffer()(), input.getOffsetInFloats(),
-                             filter.getBuffer()(), filter.getOffsetInFloats(), res.getBuffer()(),
-                             res.getOffsetInFloats(), &queue(), nullptr);
-
-    const float scale = 1.f / static_cast<float>(filter.getRows() * filter.getCols());
-    res.ipscale(scale, queue);
-
+    math::clFTensor res;
+    pool(queue, input, res);
     return res;
   }
 
+  void CNNAvgPoolingLayer::pool(cl::CommandQueue &queue, const math::clFTensor &input,
+                                math::clFTensor &res) {
+    CNNStorageBP::reserve(res, outputSize.first, outputSize.second, input.getDepth());
+    // We need to return if the size is 0 else OpenCL will throw
+    if (input.getDepth() == 0) return;
+
+    auto kernel = utils::cl_wrapper.getKernels().getKernel("Pooling.cl", "avgPooling");
+    kernel.setArg(0, input.getBuffer());
+    kernel.setArg(1, (cl_ulong) input.getOffsetInFloats());
+    kernel.setArg(2, res.getBuffer());
+    kernel.setArg(3, (cl_ulong) input.getRows());
+    kernel.setArg(4, (cl_ulong) input.getCols());
+    kernel.setArg(5, (cl_ulong) outputSize.second);
+    kernel.setArg(6, (cl_ulong) poolingSize.first);
+    kernel.setArg(7, (cl_ulong) poolingSize.second);
+    kernel.setArg(8, (cl_ulong) stride.first);
+    kernel.setArg(9, (cl_ulong) stride.second);
+    kernel.setArg(10, (cl_ulong) padding.first);
+    kernel.setArg(11, (cl_ulong) padding.second);
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                               cl::NDRange(outputSize.first * outputSize.second, input.getDepth()),
+                               cl::NullRange);
+  }
+
   math::clFTensor CNNAvgPoolingLayer::computeForward(cl::CommandQueue &queue,
                                                      const math::clFTensor &inputs,
                                                      CNNStorageBP &storages) {
-    return compute(queue, inputs);
+    pool(queue, inputs, storages.output);
+    return storages.output.shallowCopy();
   }
 
   math::clFTensor CNNAvgPoolingLayer::computeBackward(cl::CommandQueue &queue,
                                                       const math::clFTensor &errors,
                                                       CNNStorageBP &storages) {
     auto &poolingStorage = static_cast<CNNStorageBPAvgPooling &>(storages);
-
-    math::clFTensor res(poolingStorage.input_size.first, poolingStorage.input_size.second,
-                        errors.getDepth());
-
-    for (size_t ii = 0; ii < errors.getDepth(); ii++) {
-      math::FloatMatrix error_output = errors[ii].toFloatMatrix(true);
-      math::FloatMatrix error_input = res[ii].toFloatMatrix(true);
-      error_input.fill(0.f);
-
-      size_t rowsPos = 0, colsPos = 0;
-
-      const size_t max_i = error_input.getRows() - error_output.getRows() + 1;
-      const size_t max_j = error_input.getCols() - error_output.getCols() + 1;
-      for (size_t i = 0; i < max_i; i++) {
-        for (size_t j = 0; j < max_j; j++) {
-          for (size_t k = 0; k < error_output.getRows(); k++) {
-            for (size_t l = 0; l < error_output.getCols(); l++) {
-              error_input(k + rowsPos, l + colsPos) += error_output(i, j);
-            }
-          }
-          colsPos++;
-        }
-        colsPos = 0;
-        rowsPos++;
-      }
-      error_input *= 1.f / (float) (poolingSize.first * poolingSize.second);
-      res[ii] = error_input;
-    }
-    return res;
+    const auto &input_size = poolingStorage.input_size;
+    auto &res = poolingStorage.error_input;
+    CNNStorageBP::reserve(res, input_size.first, input_size.second, errors.getDepth());
+    // We need to return if the size is 0 else OpenCL will throw
+    if (errors.getDepth() == 0) return res.shallowCopy();
+
+    auto kernel = utils::cl_wrapper.getKernels().getKernel("Pooling.cl", "avgPoolingBackward");
+    kernel.setArg(0, errors.getBuffer());
+    kernel.setArg(1, (cl_ulong) errors.getOffsetInFloats());
+    kernel.setArg(2, res.getBuffer());
+    kernel.setArg(3, (cl_ulong) input_size.second);
+    kernel.setArg(4, (cl_ulong) errors.getRows());
+    kernel.setArg(5, (cl_ulong) errors.getCols());
+    kernel.setArg(6, (cl_ulong) poolingSize.first);
+    kernel.setArg(7, (cl_ulong) poolingSize.second);
+    kernel.setArg(8, (cl_ulong) stride.first);
+    kernel.setArg(9, (cl_ulong) stride.second);
+    kernel.setArg(10, (cl_ulong) padding.first);
+    kernel.setArg(11, (cl_ulong) padding.second);
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange,
+                               cl::NDRange(input_size.first * input_size.second, res.getDepth()),
+                               cl::NullRange);
+    return res.shallowCopy();
   }
 
 
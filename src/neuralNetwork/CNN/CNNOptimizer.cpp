@@ -4,9 +4,9 @@
 namespace nnet {
   namespace {
     math::clFTensor forward(const CNN &cnn, const math::clFTensor &inputs,
-                            std::vector<std::unique_ptr<CNNStorageBP>> &storages,
-                            cl::CommandQueue &queue) {
+                            CNNOptimizer::WeightUpdateCache &cache, cl::CommandQueue &queue) {
       auto &layers = cnn.getLayers();
+      auto &storages = cache.getStorages();
 
       math::clFTensor output = inputs.shallowCopy();
 
@@ -14,7 +14,8 @@ namespace nnet {
         output = layers[i]->computeForward(queue, output, *storages[i]);
       }
 
-      reorganizeForward(queue, output, inputs.getDepth(), cnn.getTopology().getNBranchFinal());
+      reorganizeForward(queue, output, inputs.getDepth(), cnn.getTopology().getNBranchFinal(),
+                        cache.getFlattenBuffer());
 
       return output;
     }
@@ -25,9 +26,11 @@ namespace nnet {
       auto &layers = cache.getLayers();
 
       reorganizeBackward(queue, errorsFlatten, errorsFlatten.getDepth(),
-                         cnn.getTopology().getNBranchFinal(), layers.back()->getOutputSize());
+                         cnn.getTopology().getNBranchFinal(), layers.back()->getOutputSize(),
+                         cache.getErrorBuffer());
 
-      math::clFTensor output = inputs.shallowCopy();
+      // The error on the cnn output is propagated back to the first layer
+      math::clFTensor output = errorsFlatten.shallowCopy();
 
       for (long i = static_cast<long>(layers.size() - 1); i > -1; i--) {
         output = layers[i]->computeBackward(queue, output, *storages[i]);
@@ -36,7 +39,7 @@ namespace nnet {
       size_t i = 0;
       for (auto &s : storages) {
         if (s->hasGradient()) {
-          cache.add(i, s->getGradient(), queue);
+          cache.add(i, s->getGradient(), inputs.getDepth(), queue);
           i++;
         }
       }
@@ -46,38 +49,54 @@ namespace nnet {
   using WeightUpdateCache = CNNOptimizer::WeightUpdateCache;
 
   WeightUpdateCache::WeightUpdateCache(CNNOptimizer &optimizer)
-      : cnn(optimizer.cnn), contributions(0), optimization(optimizer.optimization.get()) {
+      : cnn(optimizer.cnn), contributions(0), storages(cnn->getTopology().convertToStorage()),
+        optimization(optimizer.optimization.get()) {
     auto &layers = cnn->getLayers();
 
+    auto queue = utils::cl_wrapper.getDefaultQueue();
     for (auto &l : layers) {
       if (l->hasWeight()) {
         const auto &filter = l->getWeight();
         weight_updates.emplace_back(filter.getRows(), filter.getCols(), filter.getDepth());
+        weight_updates.back().fill(0.f, queue, false);
       }
     }
+    queue.finish();
   }
 
-  WeightUpdateCache::WeightUpdateCache(CNN *cnn, std::vector<math::clFTensor> &&weight_updates,
-                                       size_t contribution) {}
-
-  void WeightUpdateCache::add(size_t index, const math::clFTensor &delta, cl::CommandQueue &queue) {
-    weight_updates[index].ipadd(1.0f, delta, queue);
+  WeightUpdateCache::WeightUpdateCache(CNNOptimizer &optimizer,
+                                       std::vector<math::clFTensor> &&weight_updates,
+                                       size_t contribution)
+      : cnn(optimizer.cnn), contributions(contribution), weight_updates(std::move(weight_updates)),
+        storages(cnn->getTopology().convertToStorage()),
+        optimization(optimizer.optimization.get()) {}
+
+  void WeightUpdateCache::add(size_t index, const math::clFTensor &delta, size_t contribution_size,
+                              cl::CommandQueue &queue) {
+    // The layers return a gradient averaged over the batch, we weight it by the batch size so
+    // apply() can average over every contribution
+    weight_updates[index].ipadd(static_cast<float>(contribution_size), delta, queue);
   }
 
   void WeightUpdateCache::reduce(WeightUpdateCache &other, cl::CommandQueue &queue) {
     for (size_t i = 0; i < weight_updates.size(); ++i) {
       weight_updates[i].ipadd(1.0f, other.weight_updates[i], queue);
     }
+    contributions += other.contributions;
   }
 
   void WeightUpdateCache::apply(cl::CommandQueue &queue) {
+    if (contributions == 0) return;
+
     size_t tensor_index = 0;
     auto &cnn_layers = cnn->getLayers();
+    const float mean_factor = 1.0f / static_cast<float>(contributions);
 
     for (auto &layer : cnn_layers) {
       if (layer->hasWeight()) {
         auto &filter = layer->getWeight();
-        optimization->optimize(filter, weight_updates[tensor_index], queue);
+        weight_updates[tensor_index].ipscale(mean_factor, queue);
+        optimization->optimize(weight_updates[tensor_index], filter, queue);
         tensor_index++;
       }
     }
@@ -89,19 +108,28 @@ namespace nnet {
 
   void WeightUpdateCache::clear(cl::CommandQueue &queue) {
     for (auto &tensor : weight_updates) { tensor.fill(0.f, queue, false); }
+    contributions = 0;
   }
 
-  CNNOptimizer::CNNOptimizer(CNNModel &model, std::unique_ptr<Optimization> mlpTm)
-      : cnn(&model.getCnn()), mlp_optimizer(model.getMlp(), std::move(mlpTm)) {}
+  CNNOptimizer::CNNOptimizer(CNNModel &model, std::unique_ptr<Optimization> mlp_optimization,
+                             std::unique_ptr<CNNOptimization> cnn_optimization)
+      : CNNOptimizer(model,
+                     std::make_unique<MLPOptimizer>(model.getMlp(), std::move(mlp_optimization)),
+                     std::move(cnn_optimization)) {}
+
+  CNNOptimizer::CNNOptimizer(CNNModel &model, std::unique_ptr<MLPOptimizer> mlp_optimizer,
+                             std::unique_ptr<CNNOptimization> cnn_optimization)
+      : cnn(&model.getCnn()), mlp_optimizer(std::move(mlp_optimizer)),
+        optimization(std::move(cnn_optimization)) {}
 
   void CNNOptimizer::optimize(const math::clFTensor &inputs, const math::clFTensor &targets,
                               WeightUpdateCache &cnn_cache,
                               MLPOptimizer::WeightUpdateCache &mlp_cache, cl::CommandQueue &queue) {
-    std::vector<std::unique_ptr<CNNStorageBP>> storages = cnn->getTopology().convertToStorage();
+    auto &storages = cnn_cache.getStorages();
 
-    math::clFTensor flatten = forward(*cnn, inputs, storages, queue);
+    math::clFTensor flatten = forward(*cnn, inputs, cnn_cache, queue);
 
-    math::clFTensor errorFlatten = mlp_optimizer.optimize(flatten, targets, mlp_cache, queue);
+    math::clFTensor errorFlatten = mlp_optimizer->optimize(flatten, targets, mlp_cache, queue);
 
     backward(cnn_cache, *cnn, inputs, errorFlatten, storages, queue);
     cnn_cache.increaseContribution(inputs.getDepth());
@@ -3,6 +3,15 @@
 
 namespace nnet {
 
+  void CNNStorageBP::reserve(math::clFTensor &tensor, size_t rows, size_t cols, size_t depth) {
+    if (tensor.getRows() != rows or tensor.getCols() != cols or tensor.getDepth() != depth)
+      tensor = math::clFTensor(rows, cols, depth);
+  }
 
+  void CNNStorageBPMaxPooling::reserveIndices(size_t count) {
+    if (count <= max_indices_capacity) return;
+    max_indices = cl::Buffer(CL_MEM_READ_WRITE, count * sizeof(cl_uint));
+    max_indices_capacity = count;
+  }
 
 }   // namespace nnet
\ No newline at end of file
@@ -30,22 +30,25 @@ namespace nnet {
                                    const size_t features,
                                    const std::pair<size_t, size_t> &filterSize,
                                    const af::ActivationFunctionType aFunction,
-                                   const size_t nbranch) {
-    layers.push_back(std::make_shared<CNNTopologyLayerConvolution>(inputSize, features, filterSize,
-                                                                   aFunction, nbranch));
+                                   const size_t nbranch, const std::pair<size_t, size_t> &stride,
+                                   const std::pair<size_t, size_t> &padding) {
+    layers.push_back(std::make_shared<CNNTopologyLayerConvolution>(
+            inputSize, features, filterSize, aFunction, nbranch, stride, padding));
   }
 
   void CNNTopology::addPooling(const std::pair<size_t, size_t> &inputSize,
                                const PoolingType poolingType,
-                               const std::pair<size_t, size_t> &poolSize, const size_t nbranch) {
+                               const std::pair<size_t, size_t> &poolSize, const size_t nbranch,
+                               const std::pair<size_t, size_t> &stride,
+                               const std::pair<size_t, size_t> &padding) {
     switch (poolingType) {
       case PoolingType::MAX:
-        layers.push_back(
-                std::make_shared<CNNTopologyLayerMaxPooling>(inputSize, poolSize, nbranch));
+        layers.push_back(std::make_shared<CNNTopologyLayerMaxPooling>(inputSize, poolSize,
+                                                                      nbranch, stride, padding));
         break;
       case PoolingType::AVERAGE:
-        layers.push_back(
-                std::make_shared<CNNTopologyLayerAvgPooling>(inputSize, poolSize, nbranch));
+        layers.push_back(std::make_shared<CNNTopologyLayerAvgPooling>(inputSize, poolSize,
+                                                                      nbranch, stride, padding));
         break;
       default:
         throw std::invalid_argument("Invalid pooling type");
@@ -80,23 +83,36 @@ namespace nnet {
     res.activationFunction = af::strToAFType(type);
 
     size_t n_branch = 1;
-    while (ss >> type) {
+    bool has_next = static_cast<bool>(ss >> type);
+    while (has_next) {
       LayerType layerType = stringToLayerType(type);
+      size_t features = 0;
+      std::string strPoolingType;
+      std::pair<size_t, size_t> filterSize = {0, 0};
       if (layerType == LayerType::CONVOLUTION) {
-        size_t features = 0;
-        std::pair<size_t, size_t> filterSize = {0, 0};
         ss >> features >> filterSize.first >> filterSize.second;
-        res.addConvolution(inputSize, features, filterSize, res.activationFunction, n_branch);
-        n_branch *= features;
       } else if (layerType == LayerType::POOLING) {
-        std::string strPoolingType;
-        std::pair<size_t, size_t> poolSize;
-        ss >> strPoolingType >> poolSize.first >> poolSize.second;
-        PoolingType poolType = stringToPoolingType(strPoolingType);
-        res.addPooling(inputSize, poolType, poolSize, n_branch);
+        ss >> strPoolingType >> filterSize.first >> filterSize.second;
       } else {
         throw std::invalid_argument("Invalid type " + type);
       }
+
+      // Optional parameters of the layer, in any order
+      std::pair<size_t, size_t> stride = {1, 1}, padding = {0, 0};
+      while ((has_next = static_cast<bool>(ss >> type)) and
+             (type == "stride" or type == "padding")) {
+        auto &parameter = type == "stride" ? stride : padding;
+        ss >> parameter.first >> parameter.second;
+      }
+
+      if (layerType == LayerType::CONVOLUTION) {
+        res.addConvolution(inputSize, features, filterSize, res.activationFunction, n_branch,
+                           stride, padding);
+        n_branch *= features;
+      } else {
+        res.addPooling(inputSize, stringToPoolingType(strPoolingType), filterSize, n_branch, stride,
+                       padding);
+      }
       inputSize = res.layers.back()->getOutputSize();
     }
     res.n_branch_final = n_branch;
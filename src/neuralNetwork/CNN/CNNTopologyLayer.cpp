@@ -4,20 +4,46 @@ namespace nnet {
 
   CNNTopologyLayer::CNNTopologyLayer(const std::pair<size_t, size_t> inputSize,
                                      const std::pair<size_t, size_t> filterSize,
-                                     const size_t nBranch)
-      : input_size(inputSize), filter_size(filterSize), n_branch(nBranch) {}
+                                     const size_t nBranch, const std::pair<size_t, size_t> stride,
+                                     const std::pair<size_t, size_t> padding)
+      : input_size(inputSize), filter_size(filterSize), n_branch(nBranch), stride(stride),
+        padding(padding) {}
+
+  const std::pair<size_t, size_t>
+  CNNTopologyLayer::computeSlidingOutputSize(const std::pair<size_t, size_t> &inputSize) const {
+    //(((W - K + 2P)/S) + 1)
+    // W = Input size
+    // K = Filter size
+    // S = Stride
+    // P = Padding
+    if (stride.first == 0 or stride.second == 0)
+      throw std::invalid_argument("CNNTopologyLayer: Stride must be positive");
+    // A window made only of padding would have no input to read
+    if (padding.first >= filter_size.first or padding.second >= filter_size.second)
+      throw std::invalid_argument("CNNTopologyLayer: Padding must be smaller than the filter");
+    if (inputSize.first + 2 * padding.first < filter_size.first or
+        inputSize.second + 2 * padding.second < filter_size.second)
+      throw std::invalid_argument("CNNTopologyLayer: Filter is larger than the padded input");
+
+    const size_t rows =
+            (inputSize.first + 2 * padding.first - filter_size.first) / stride.first + 1;
+    const size_t cols =
+            (inputSize.second + 2 * padding.second - filter_size.second) / stride.second + 1;
+    return std::make_pair(rows, cols);
+  }
 
 
   CNNTopologyLayerConvolution::CNNTopologyLayerConvolution(
           const std::pair<size_t, size_t> inputSize, const size_t features,
           const std::pair<size_t, size_t> filterSize, const af::ActivationFunctionType aFunction,
-          const size_t nBranch)
-      : CNNTopologyLayer(inputSize, filterSize, nBranch), features(features),
+          const size_t nBranch, const std::pair<size_t, size_t> stride,
+          const std::pair<size_t, size_t> padding)
+      : CNNTopologyLayer(inputSize, filterSize, nBranch, stride, padding), features(features),
         activationFunction(aFunction), outputSize(computeOutputSize(inputSize)) {}
 
   std::unique_ptr<CNNLayer> CNNTopologyLayerConvolution::convertToLayer() const {
     return std::make_unique<CNNConvolutionLayer>(outputSize, filter_size, features,
-                                                 activationFunction, n_branch);
+                                                 activationFunction, n_branch, stride, padding);
   }
 
   std::unique_ptr<CNNStorageBP> CNNTopologyLayerConvolution::convertToStorage() const {
@@ -26,49 +52,41 @@ namespace nnet {
 
   const std::pair<size_t, size_t>
   CNNTopologyLayerConvolution::computeOutputSize(const std::pair<size_t, size_t> &inputSize) const {
-    //(((W - K + 2P)/S) + 1)
-    // W = Input size
-    // K = Filter size
-    // S = Stride ( 1 )
-    // P = Padding ( 0 )
-    const size_t rows = (inputSize.first - filter_size.first) + 1;
-    const size_t cols = (inputSize.second - filter_size.second) + 1;
-    return std::make_pair(rows, cols);
+    return computeSlidingOutputSize(inputSize);
   }
 
   std::ostream &CNNTopologyLayerConvolution::printTo(std::ostream &os) const {
     os << "Convolution layer: nBranch{" << n_branch << "}, outPutSize{" << outputSize.first << ", "
        << outputSize.second << "}, features{" << features << "}, filter{" << filter_size.first << ", "
-       << filter_size.second << "}";
+       << filter_size.second << "}, stride{" << stride.first << ", " << stride.second
+       << "}, padding{" << padding.first << ", " << padding.second << "}";
     return os;
   }
 
 
   CNNTopologyLayerPooling::CNNTopologyLayerPooling(const std::pair<size_t, size_t> inputSize,
                                                    const std::pair<size_t, size_t> filter,
-                                                   const size_t nBranch)
-      : CNNTopologyLayer(inputSize, filter, nBranch), outputSize(computeOutputSize(inputSize)) {}
+                                                   const size_t nBranch,
+                                                   const std::pair<size_t, size_t> stride,
+                                                   const std::pair<size_t, size_t> padding)
+      : CNNTopologyLayer(inputSize, filter, nBranch, stride, padding),
+        outputSize(computeOutputSize(inputSize)) {}
 
   const std::pair<size_t, size_t>
   CNNTopologyLayerPooling::computeOutputSize(const std::pair<size_t, size_t> &inputSize) const {
-    //(((W - K)/S) + 1)
-    // W = Input size
-    // K = Filter size
-    // S = Stride ( 1 )
-
-    const size_t rows = (inputSize.first - filter_size.first) + 1;
-    const size_t cols = (inputSize.second - filter_size.second) + 1;
-    return std::make_pair(rows, cols);
+    return computeSlidingOutputSize(inputSize);
   }
 
 
   CNNTopologyLayerMaxPooling::CNNTopologyLayerMaxPooling(const std::pair<size_t, size_t> inputSize,
                                                          const std::pair<size_t, size_t> filter,
-                                                         const size_t nBranch)
-      : CNNTopologyLayerPooling(inputSize, filter, nBranch) {}
+                                                         const size_t nBranch,
+                                                         const std::pair<size_t, size_t> stride,
+                                                         const std::pair<size_t, size_t> padding)
+      : CNNTopologyLayerPooling(inputSize, filter, nBranch, stride, padding) {}
 
   std::unique_ptr<CNNLayer> CNNTopologyLayerMaxPooling::convertToLayer() const {
-    return std::make_unique<CNNMaxPoolingLayer>(outputSize, filter_size);
+    return std::make_unique<CNNMaxPoolingLayer>(outputSize, filter_size, stride, padding);
   }
 
   std::unique_ptr<CNNStorageBP> CNNTopologyLayerMaxPooling::convertToStorage() const {
@@ -77,18 +95,22 @@ namespace nnet {
 
   std::ostream &CNNTopologyLayerMaxPooling::printTo(std::ostream &os) const {
     os << "Max Pooling layer: nBranch{" << n_branch << "}, outputSize{" << outputSize.first << ", "
-       << outputSize.second << "}, filter{" << filter_size.first << ", " << filter_size.second << "}";
+       << outputSize.second << "}, filter{" << filter_size.first << ", " << filter_size.second
+       << "}, stride{" << stride.first << ", " << stride.second << "}, padding{" << padding.first
+       << ", " << padding.second << "}";
     return os;
   }
 
 
   CNNTopologyLayerAvgPooling::CNNTopologyLayerAvgPooling(const std::pair<size_t, size_t> inputSize,
                                                          const std::pair<size_t, size_t> filter,
-                                                         const size_t nBranch)
-      : CNNTopologyLayerPooling(inputSize, filter, nBranch) {}
+                                                         const size_t nBranch,
+                                                         const std::pair<size_t, size_t> stride,
+                                                         const std::pair<size_t, size_t> padding)
+      : CNNTopologyLayerPooling(inputSize, filter, nBranch, stride, padding) {}
 
   std::unique_ptr<CNNLayer> CNNTopologyLayerAvgPooling::convertToLayer() const {
-    return std::make_unique<CNNAvgPoolingLayer>(outputSize, filter_size);
+    return std::make_unique<CNNAvgPoolingLayer>(outputSize, filter_size, stride, padding);
   }
 
   std::unique_ptr<CNNStorageBP> CNNTopologyLayerAvgPooling::convertToStorage() const {
@@ -98,7 +120,8 @@ namespace nnet {
   std::ostream &CNNTopologyLayerAvgPooling::printTo(std::ostream &os) const {
     os << "Avg Pooling layer: nBranch{" << n_branch << ", outputSize{" << outputSize.first << ", "
        << outputSize.second << "}, nBranch{" << n_branch << "}, filter{" << filter_size.first << ", "
-       << filter_size.second << "}";
+       << filter_size.second << "}, stride{" << stride.first << ", " << stride.second
+       << "}, padding{" << padding.first << ", " << padding.second << "}";
     return os;
   }
 
@@ -0,0 +1,138 @@
+#include "MPICNNOptimizer.hpp"
+
+using namespace math;
+
+namespace nnet {
+  namespace {
+    /**
+     * @brief Broadcast the content of the given matrices / tensors from the 0-th process of the
+     * communicator to every other process
+     */
+    template<class T>
+    void broadcastFromRoot(const std::vector<T *> &objects, MPI_Comm comm,
+                           cl::CommandQueue &queue) {
+      int rank = 0, n_process = 0;
+      MPI_Comm_rank(comm, &rank);
+      MPI_Comm_size(comm, &n_process);
+
+      if (n_process == 1 or objects.empty()) return;
+
+      // Map asynchronous buffers
+      std::vector<void *> data_ptrs(objects.size());
+      for (size_t i = 0; i < objects.size(); i++)
+        data_ptrs[i] = queue.enqueueMapBuffer(objects[i]->getBuffer(), CL_FALSE,
+                                              rank == 0 ? CL_MAP_READ : CL_MAP_WRITE,
+                                              objects[i]->getOffsetInBytes(),
+                                              objects[i]->sizeInBytes());
+      queue.finish();
+
+      std::vector<MPI_Request> requests(objects.size());
+      for (size_t i = 0; i < objects.size(); i++)
+        MPI_Ibcast(data_ptrs[i], (int) objects[i]->size(), MPI_FLOAT, 0, comm, &requests[i]);
+      MPI_Waitall((int) requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+      // Unmap buffers
+      for (size_t i = 0; i < objects.size(); i++)
+        queue.enqueueUnmapMemObject(objects[i]->getBuffer(), data_ptrs[i]);
+      queue.finish();
+    }
+
+    std::vector<clFTensor *> getFilters(const CNN &cnn) {
+      std::vector<clFTensor *> filters;
+      for (auto &layer : cnn.getLayers()) {
+        if (layer->hasWeight()) filters.push_back(&layer->getWeight());
+      }
+      return filters;
+    }
+
+    /**
+     * @brief Sum the weight updates and the contributions of every process into the cache of the
+     * 0-th process. The caches of the other processes are left unchanged
+     */
+    void reduceWeightUpdates(CNNOptimizer::WeightUpdateCache &cache, MPI_Comm comm,
+                             cl::CommandQueue &queue) {
+      int rank = 0;
+      MPI_Comm_rank(comm, &rank);
+
+      auto &weight_updates = cache.getWeightUpdates();
+      std::vector<void *> data_ptrs(weight_updates.size());
+      for (size_t i = 0; i < weight_updates.size(); i++)
+        data_ptrs[i] = queue.enqueueMapBuffer(
+                weight_updates[i].getBuffer(), CL_FALSE,
+                rank == 0 ? CL_MAP_READ | CL_MAP_WRITE : CL_MAP_READ,
+                weight_updates[i].getOffsetInBytes(), weight_updates[i].sizeInBytes());
+      queue.finish();
+
+      // The root reduces in place, so no additional buffer is required
+      std::vector<MPI_Request> requests(weight_updates.size());
+      for (size_t i = 0; i < weight_updates.size(); i++)
+        MPI_Ireduce(rank == 0 ? MPI_IN_PLACE : data_ptrs[i], data_ptrs[i],
+                    (int) weight_updates[i].size(), MPI_FLOAT, MPI_SUM, 0, comm, &requests[i]);
+
+      auto local_contribution = (unsigned long) cache.getContribution();
+      unsigned long global_contribution = 0;
+      MPI_Reduce(&local_contribution, &global_contribution, 1, MPI_UNSIGNED_LONG, MPI_SUM, 0,
+                 comm);
+      if (rank == 0) cache.setContribution(global_contribution);
+
+      MPI_Waitall((int) requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+
+      for (size_t i = 0; i < weight_updates.size(); i++)
+        queue.enqueueUnmapMemObject(weight_updates[i].getBuffer(), data_ptrs[i]);
+      queue.finish();
+    }
+  }   // namespace
+
+  MPICNNOptimizer::MPICNNOptimizer(CNNModel &model, std::unique_ptr<Optimization> mlp_optimization,
+                                   std::unique_ptr<CNNOptimization> cnn_optimization)
+      : CNNOptimizer(model,
+                     std::make_unique<MPIMLPOptimizer>(model.getMlp(), std::move(mlp_optimization)),
+                     std::move(cnn_optimization)) {
+    auto &queue = utils::cl_wrapper.getDefaultQueue();
+    auto &mlp = model.getMlp();
+
+    std::vector<clFMatrix *> mlp_parameters;
+    for (auto &weight : mlp.getWeights()) mlp_parameters.push_back(&weight);
+    for (auto &bias : mlp.getBiases()) mlp_parameters.push_back(&bias);
+
+    broadcastFromRoot(getFilters(*cnn), MPI_COMM_WORLD, queue);
+    broadcastFromRoot(mlp_parameters, MPI_COMM_WORLD, queue);
+  }
+
+  CNNOptimizer::Operation *MPICNNOptimizer::makeOperationImpl() { return new Operation(*this); }
+
+  MPICNNOptimizer::Operation::Operation(MPICNNOptimizer &optimizer)
+      : CNNOptimizer::Operation(optimizer), current_comm(MPI_COMM_WORLD) {}
+
+  void MPICNNOptimizer::Operation::setCommunicator(MPI_Comm comm) {
+    current_comm = comm;
+    // The perceptron must be synchronized with the same processes as the filters
+    dynamic_cast<MPIOperation &>(*mlp_operation).setCommunicator(comm);
+  }
+
+  void MPICNNOptimizer::Operation::reduceAll(cl::CommandQueue &queue) {
+    int n_process = 0;
+    MPI_Comm_size(current_comm, &n_process);
+
+    // Process-local reduction
+    CNNOptimizer::Operation::reduceAll(queue);
+
+    if (n_process == 1) return;
+    reduceWeightUpdates(*caches[0], current_comm, queue);
+  }
+
+  void MPICNNOptimizer::Operation::applyChanges(cl::CommandQueue &queue) {
+    int rank = 0;
+    MPI_Comm_rank(current_comm, &rank);
+
+    // Only the 0-th process holds the global weight updates. The other processes would apply
+    // their local updates for nothing, and their optimization state would drift from the root's
+    if (rank == 0) caches[0]->apply(queue);
+    // Updates the perceptron, using the MPIMLPOptimizer operation
+    mlp_operation->updateModel(queue);
+    queue.finish();
+
+    broadcastFromRoot(getFilters(*optimizer->getCNN()), current_comm, queue);
+  }
+
+}   // namespace nnet
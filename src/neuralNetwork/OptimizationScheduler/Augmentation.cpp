@@ -0,0 +1,110 @@
+#include "Augmentation.hpp"
+
+#include <stdexcept>
+#include <type_traits>
+
+namespace nnet {
+
+  namespace {
+    // Flags of the enabled augmentations. Must match the definitions in Augmentation.cl
+    constexpr cl_uint kHorizontalFlip = 1;
+    constexpr cl_uint kVerticalFlip = 2;
+    constexpr cl_uint kRotation = 4;
+
+    size_t offsetInElements(const math::clFTensor &tensor) { return tensor.getOffsetInFloats(); }
+    size_t offsetInElements(const math::clU8Tensor &tensor) { return tensor.getOffsetInBytes(); }
+  }   // namespace
+
+  Augmentation::Augmentation(size_t width, size_t height, unsigned long seed)
+      : width(width), height(height), seed(seed) {
+    if (width == 0 or height == 0)
+      throw std::invalid_argument("Augmentation::Augmentation: Empty images");
+  }
+
+  void Augmentation::setFlips(bool horizontal, bool vertical) {
+    horizontal_flip = horizontal;
+    vertical_flip = vertical;
+  }
+
+  void Augmentation::setRotations(bool enable) {
+    if (enable and width != height)
+      throw std::invalid_argument("Augmentation::setRotations: Rotations require square images");
+    rotation = enable;
+  }
+
+  void Augmentation::setMaxTranslation(size_t pixels) {
+    if (pixels >= width or pixels >= height)
+      throw std::invalid_argument("Augmentation::setMaxTranslation: Translation larger than the "
+                                  "images");
+    max_translation = pixels;
+  }
+
+  void Augmentation::setIntensityJitter(float new_contrast, float new_brightness) {
+    if (new_contrast < 0 or new_brightness < 0)
+      throw std::invalid_argument("Augmentation::setIntensityJitter: Negative amplitude");
+    contrast = new_contrast;
+    brightness = new_brightness;
+  }
+
+  bool Augmentation::isIdentity() const {
+    return not horizontal_flip and not vertical_flip and not rotation and max_translation == 0 and
+           contrast == 0 and brightness == 0;
+  }
+
+  math::clFTensor Augmentation::apply(const math::clFTensor &inputs,
+                                      const std::vector<size_t> &sample_ids, size_t epoch,
+                                      cl::CommandQueue &queue) const {
+    return applyImpl(inputs, sample_ids, epoch, queue, 1.0f);
+  }
+
+  math::clFTensor Augmentation::apply(const math::clU8Tensor &inputs,
+                                      const std::vector<size_t> &sample_ids, size_t epoch,
+                                      cl::CommandQueue &queue, float factor) const {
+    return applyImpl(inputs, sample_ids, epoch, queue, factor);
+  }
+
+  template<class Tensor>
+  math::clFTensor Augmentation::applyImpl(const Tensor &inputs,
+                                          const std::vector<size_t> &sample_ids, size_t epoch,
+                                          cl::CommandQueue &queue, float factor) const {
+    if (inputs.getRows() * inputs.getCols() != width * height)
+      throw std::invalid_argument("Augmentation::apply: Samples of " +
+                                  std::to_string(inputs.getRows() * inputs.getCols()) +
+                                  " values, expected " + std::to_string(width * height));
+    if (sample_ids.size() != inputs.getDepth())
+      throw std::invalid_argument("Augmentation::apply: " + std::to_string(sample_ids.size()) +
+                                  " ids for " + std::to_string(inputs.getDepth()) + " samples");
+
+    math::clFTensor res(inputs.getRows(), inputs.getCols(), inputs.getDepth());
+    // We need to return if the size is 0 else OpenCL will throw
+    if (inputs.size() == 0) return res;
+
+    cl_uint flags = (horizontal_flip ? kHorizontalFlip : 0) | (vertical_flip ? kVerticalFlip : 0) |
+                    (rotation ? kRotation : 0);
+
+    constexpr bool bytes = std::is_same_v<Tensor, math::clU8Tensor>;
+    std::vector<cl_ulong> ids(sample_ids.begin(), sample_ids.end());
+    cl::Buffer ids_buffer(CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, sizeof(cl_ulong) * ids.size(),
+                          ids.data());
+    cl::Kernel kernel = utils::cl_wrapper.getKernels().getKernel(
+            "Augmentation.cl", bytes ? "augmentBytes" : "augment");
+    kernel.setArg(0, inputs.getBuffer());
+    kernel.setArg(1, (cl_ulong) offsetInElements(inputs));
+    kernel.setArg(2, res.getBuffer());
+    kernel.setArg(3, (cl_ulong) res.getOffsetInFloats());
+    kernel.setArg(4, (cl_ulong) width);
+    kernel.setArg(5, (cl_ulong) height);
+    kernel.setArg(6, (cl_ulong) seed);
+    kernel.setArg(7, (cl_ulong) epoch);
+    kernel.setArg(8, ids_buffer);
+    kernel.setArg(9, flags);
+    kernel.setArg(10, (cl_uint) max_translation);
+    kernel.setArg(11, contrast);
+    kernel.setArg(12, brightness);
+    if constexpr (bytes) kernel.setArg(13, factor);
+    queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(width, height, inputs.getDepth()),
+                               cl::NullRange);
+    return res;
+  }
+
+}   // namespace nnet
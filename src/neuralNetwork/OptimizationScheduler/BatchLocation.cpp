@@ -1,4 +1,5 @@
 #include "BatchLocation.hpp"
+#include <stdexcept>
 
 
 namespace nnet {
@@ -7,14 +8,45 @@ namespace nnet {
                                size_t local_index)
       : inputs(&inputs), targets(&targets), tensor_index(tensor_index), local_index(local_index) {}
 
+  BatchLocation::BatchLocation(const std::vector<math::clU8Tensor> &inputs,
+                               const std::vector<math::clFTensor> &targets, size_t tensor_index,
+                               size_t local_index)
+      : targets(&targets), byte_inputs(&inputs), tensor_index(tensor_index),
+        local_index(local_index) {}
+
   void BatchLocation::progress(size_t count) {
+    // The targets have the same depths as the inputs, whatever their storage
     local_index += count;
-    while (local_index > 0 and local_index >= (*inputs)[tensor_index].getDepth()) {
-      local_index -= (*inputs)[tensor_index].getDepth();
+    while (local_index > 0 and local_index >= (*targets)[tensor_index].getDepth()) {
+      local_index -= (*targets)[tensor_index].getDepth();
       tensor_index++;
       // If we have reached the end of the input sets, loop back to the beginning
-      if (tensor_index >= inputs->size()) tensor_index = 0;
+      if (tensor_index >= targets->size()) tensor_index = 0;
     }
   }
 
+  math::clFTensor BatchLocation::getInputSlice(size_t size, cl::CommandQueue &queue) const {
+    const size_t end = local_index + size;
+    if (augmentation and not augmentation->isIdentity()) {
+      if (not sample_ids)
+        throw std::runtime_error("BatchLocation::getInputSlice: Augmentation requires sample ids");
+      auto first = sample_ids->begin() + (long) getGlobalIndex();
+      std::vector<size_t> ids(first, first + (long) size);
+      if (byte_inputs)
+        return augmentation->apply((*byte_inputs)[tensor_index].slice(local_index, end), ids,
+                                   epoch, queue);
+      return augmentation->apply((*inputs)[tensor_index].slice(local_index, end), ids, epoch,
+                                 queue);
+    }
+
+    if (byte_inputs) return (*byte_inputs)[tensor_index].slice(local_index, end).toFloat(queue);
+    return (*inputs)[tensor_index].slice(local_index, end);
+  }
+
+  size_t BatchLocation::getGlobalIndex() const {
+    size_t res = local_index;
+    for (size_t i = 0; i < tensor_index; i++) res += (*targets)[i].getDepth();
+    return res;
+  }
+
 }   // namespace nnet
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "BatchOptimizationScheduler.hpp"
+#include <stdexcept>
 
 namespace nnet {
 
@@ -7,9 +8,23 @@ namespace nnet {
                                        const std::vector<math::clFTensor> &targets)
       : batch_size(batch_size), inputs(&inputs), targets(&targets) {}
 
+  BatchSchedulerJob::BatchSchedulerJob(size_t batch_size,
+                                       const std::vector<math::clU8Tensor> &inputs,
+                                       const std::vector<math::clFTensor> &targets)
+      : batch_size(batch_size), byte_inputs(&inputs), targets(&targets) {}
+
+  void BatchSchedulerJob::setAugmentation(const Augmentation *new_augmentation,
+                                          const std::vector<size_t> *new_sample_ids) {
+    if (new_augmentation and (not new_sample_ids or new_sample_ids->size() != getGlobalWorkSize()))
+      throw std::invalid_argument("BatchSchedulerJob::setAugmentation: Requires one id per sample");
+    augmentation = new_augmentation;
+    sample_ids = new_sample_ids;
+  }
+
   size_t BatchSchedulerJob::getGlobalWorkSize() const {
     size_t res = 0;
-    for (const auto &t : *inputs) { res += t.getDepth(); }
+    // The targets have the same depths as the inputs, whatever their storage
+    for (const auto &t : *targets) { res += t.getDepth(); }
     return res;
   }
 
@@ -1,108 +1,233 @@
 #include "MPIParallelScheduler.hpp"
-#include "MPIMLPOptimizer.hpp"
+#include "MPIOperation.hpp"
+#include "RebalancePlan.hpp"
 #include "math/clFTensor.hpp"
-#include <boost/asio/thread_pool.hpp>
-#include <future>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <numeric>
 
 using namespace math;
-using namespace boost;
+namespace chrono = std::chrono;
 
 namespace nnet {
   namespace {
-    /** Creates a new MPI communicator with the given processes (ranks from the World communicator).
-     * @param ranks_to_keep
-     * @return the new MPI_Comm
-     * @warning returned MPI_Comm can be MPI_COMM_NULL
-     */
-    MPI_Comm newCommWith(const std::vector<int> &ranks_to_keep) {
-      int rank;
-      MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-      MPI_Comm new_comm;
-      MPI_Group world_group;
-      MPI_Comm_group(MPI_COMM_WORLD, &world_group);
-      MPI_Group new_group;
-      MPI_Group_incl(world_group, (int) ranks_to_keep.size(), ranks_to_keep.data(), &new_group);
-      MPI_Comm_create(MPI_COMM_WORLD, new_group, &new_comm);
-      return new_comm;
-    }
+    // Imbalances smaller than this fraction of the mean number of samples per process are ignored,
+    // so that measurement noise doesn't move samples back and forth
+    constexpr double kRebalanceThreshold = 0.05;
 
     /**
-     * Creates sub-communicators for each process, according to their work_size.
-     * @param work_sizes work sizes for each rank [work_size of 0-th process, ...]
-     * @return [{first minimal work_size, communicator to use}, ...]
+     * @brief Moves the last samples of a list of tensors into a new contiguous tensor. The
+     * remaining tensors are shrunk, and remain views on their original buffers
      */
-    std::vector<std::pair<size_t, MPI_Comm>>
-    createSubCommunicators(const std::vector<size_t> &work_sizes) {
-      std::vector<std::pair<size_t, MPI_Comm>> result;
-      std::vector<size_t> work_sizes_copy = work_sizes;
-      while (!work_sizes_copy.empty()) {
-        std::vector<int> ranks_to_keep;
-        size_t current_work_size =
-                *std::min_element(work_sizes_copy.begin(), work_sizes_copy.end());
-
-        // Keep only ranks with a greater or equal current_work_size
-        for (int i = 0; i < work_sizes.size(); i++)
-          if (work_sizes[i] >= current_work_size) ranks_to_keep.push_back(i);
-        std::erase_if(work_sizes_copy, [&](size_t s) { return s <= current_work_size; });
-
-        // Create new communicator
-        MPI_Comm new_comm = newCommWith(ranks_to_keep);
-        result.emplace_back(current_work_size, new_comm);
+    clFTensor takeTail(std::vector<clFTensor> &tensors, size_t count, cl::CommandQueue &queue) {
+      clFTensor res(tensors.back().getRows(), tensors.back().getCols(), count);
+
+      size_t remaining = count;
+      while (remaining > 0) {
+        auto &last = tensors.back();
+        size_t n = std::min(remaining, last.getDepth());
+        remaining -= n;
+
+        clFTensor tail = last.slice(last.getDepth() - n, last.getDepth());
+        queue.enqueueCopyBuffer(tail.getBuffer(), res.getBuffer(), tail.getOffsetInBytes(),
+                                res.getOffsetOfInBytes(remaining), tail.sizeInBytes());
+
+        if (n == last.getDepth()) tensors.pop_back();
+        else
+          last = last.slice(0, last.getDepth() - n);
       }
-
-
-      return result;
+      return res;
     }
 
-    std::vector<std::pair<size_t, MPI_Comm>> synchronizeGlobalWorkSize(size_t local_work_size) {
-      int rank;
-      MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-      int n_process = 0;
-      MPI_Comm_size(MPI_COMM_WORLD, &n_process);
-
-      std::vector<unsigned long> processes_work_sizes(n_process);
+    /**
+     * @brief Exchange samples between processes according to the plan
+     * @param dims The dimensions of the inputs and the targets {input_rows, input_cols,
+     * target_rows, target_cols}
+     */
+    void migrateSamples(const std::vector<SampleTransfer> &transfers, MPI_Comm comm,
+                        const std::array<size_t, 4> &dims, std::vector<clFTensor> &inputs,
+                        std::vector<clFTensor> &targets) {
+      int rank = 0;
+      MPI_Comm_rank(comm, &rank);
+      auto &queue = utils::cl_wrapper.getDefaultQueue();
+
+      // Tensors exchanged with other processes, with their mapped pointer
+      std::vector<std::pair<clFTensor, void *>> sent, received;
+      for (const auto &transfer : transfers) {
+        if (transfer.source == rank) {
+          sent.emplace_back(takeTail(inputs, transfer.count, queue), nullptr);
+          sent.emplace_back(takeTail(targets, transfer.count, queue), nullptr);
+        } else if (transfer.destination == rank) {
+          received.emplace_back(clFTensor(dims[0], dims[1], transfer.count), nullptr);
+          received.emplace_back(clFTensor(dims[2], dims[3], transfer.count), nullptr);
+        }
+      }
+      if (sent.empty() and received.empty()) return;
+
+      // Map asynchronous buffers
+      for (auto &[tensor, ptr] : sent)
+        ptr = queue.enqueueMapBuffer(tensor.getBuffer(), CL_FALSE, CL_MAP_READ,
+                                     tensor.getOffsetInBytes(), tensor.sizeInBytes());
+      for (auto &[tensor, ptr] : received)
+        ptr = queue.enqueueMapBuffer(tensor.getBuffer(), CL_FALSE, CL_MAP_WRITE,
+                                     tensor.getOffsetInBytes(), tensor.sizeInBytes());
+      queue.finish();
+
+      // A pair of processes is involved in at most one transfer, so the tag only needs to
+      // distinguish the inputs (0) from the targets (1)
+      std::vector<MPI_Request> requests;
+      size_t sent_index = 0, received_index = 0;
+      for (const auto &transfer : transfers) {
+        for (int tag = 0; tag < 2; tag++) {
+          requests.push_back(MPI_REQUEST_NULL);
+          if (transfer.source == rank) {
+            auto &[tensor, ptr] = sent[sent_index++];
+            MPI_Isend(ptr, (int) tensor.size(), MPI_FLOAT, transfer.destination, tag, comm,
+                      &requests.back());
+          } else if (transfer.destination == rank) {
+            auto &[tensor, ptr] = received[received_index++];
+            MPI_Irecv(ptr, (int) tensor.size(), MPI_FLOAT, transfer.source, tag, comm,
+                      &requests.back());
+          }
+        }
+      }
+      MPI_Waitall((int) requests.size(), requests.data(), MPI_STATUSES_IGNORE);
 
-      MPI_Allgather(&local_work_size, 1, MPI_UNSIGNED_LONG, processes_work_sizes.data(), 1,
-                    MPI_UNSIGNED_LONG, MPI_COMM_WORLD);
+      // Unmap buffers
+      for (auto &[tensor, ptr] : sent) queue.enqueueUnmapMemObject(tensor.getBuffer(), ptr);
+      for (auto &[tensor, ptr] : received) queue.enqueueUnmapMemObject(tensor.getBuffer(), ptr);
+      queue.finish();
 
-      return createSubCommunicators(processes_work_sizes);
+      for (size_t i = 0; i < received.size(); i += 2) {
+        inputs.push_back(std::move(received[i].first));
+        targets.push_back(std::move(received[i + 1].first));
+      }
     }
-  }   // anonymous namespace
+  }   // namespace
+
+  MPIParallelScheduler::MPIParallelScheduler(ParallelScheduler &&other)
+      : ParallelScheduler(std::move(other)) {
+    if (getJob().hasByteInputs())
+      throw std::invalid_argument("MPIParallelScheduler: Inputs stored as bytes are not supported");
+    // Samples migrate between processes, but their ids do not follow them
+    if (getJob().getAugmentation())
+      throw std::invalid_argument("MPIParallelScheduler: Augmentations are not supported");
+    // Samples may be migrated between processes, so we keep our own list of tensors
+    for (auto &tensor : getJob().getInputs()) local_inputs.push_back(tensor.shallowCopy());
+    for (auto &tensor : getJob().getTargets()) local_targets.push_back(tensor.shallowCopy());
+    setJob({getJob().getBatchSize(), local_inputs, local_targets});
+
+    MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+
+    auto *mpi_op = dynamic_cast<MPIOperation *>(optimizer_operation.get());
+    if (not mpi_op)
+      throw std::runtime_error("MPIParallelScheduler: optimizer does not support MPI");
+    mpi_op->setCommunicator(comm);
+  }
 
+  MPIParallelScheduler::~MPIParallelScheduler() {
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (not finalized and comm != MPI_COMM_NULL) MPI_Comm_free(&comm);
+  }
 
   void MPIParallelScheduler::run() {
-    int rank = 0, world_n_process = 0;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &world_n_process);
+    int n_process = 0;
+    MPI_Comm_size(comm, &n_process);
 
     epochStart();
-    auto job = getJob();
-    size_t global_work_size = job.getGlobalWorkSize();
-    size_t batch_size = job.getBatchSize();
+    const size_t local_work_size = getJob().getGlobalWorkSize();
+    const size_t batch_size = getJob().getBatchSize();
 
-    BatchLocation progression(job.getInputs(), job.getTargets());
+    // Every process must take part in the same number of model updates
+    unsigned long local_size = local_work_size, total_work_size = 0;
+    MPI_Allreduce(&local_size, &total_work_size, 1, MPI_UNSIGNED_LONG, MPI_SUM, comm);
+    const size_t global_batch_size = batch_size * n_process;
+    const size_t n_steps = (total_work_size + global_batch_size - 1) / global_batch_size;
 
-    // As processes do not have the same work_size, we synchronize them into sub-communicators
-    auto sub_comms = synchronizeGlobalWorkSize(global_work_size);
+    BatchLocation progression(local_inputs, local_targets);
 
-    auto mpi_op = (MPIMLPOptimizer::Operation *) optimizer_operation.get();
-    mpi_op->setCommunicator(sub_comms.front().second);
-    size_t current_comm_index = 0;
-    for (size_t current_size = 0; current_size < global_work_size; current_size += batch_size) {
-      if (current_size >= sub_comms[current_comm_index].first)
-        mpi_op->setCommunicator(sub_comms[++current_comm_index].second);
+    double compute_time = 0;
+    for (size_t step = 0; step < n_steps; step++) {
+      // The local samples are spread evenly over the steps, so the local batch size is
+      // proportional to the number of samples held by this process
+      size_t current_batch_size =
+              local_work_size / n_steps + (step < local_work_size % n_steps ? 1 : 0);
 
-      size_t current_batch_size = std::min(global_work_size - current_size, batch_size);
-      batch_dispatcher->dispatch(progression, current_batch_size,
-                                 *ParallelScheduler::optimizer_operation);
+      auto start = chrono::steady_clock::now();
+      batch_dispatcher->dispatch(progression, current_batch_size, *optimizer_operation);
+      compute_time += chrono::duration<double>(chrono::steady_clock::now() - start).count();
 
       updateModel();
     }
 
+    // Keep the previous measure if this process had no sample to compute
+    if (local_work_size > 0 and compute_time > 0)
+      throughput = (double) local_work_size / compute_time;
+    if (rebalancing) rebalance();
+
     optimizer->update();
     endEpoch();
   }
 
+  void MPIParallelScheduler::rebalance() {
+    int rank = 0, n_process = 0;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &n_process);
+    if (n_process == 1) return;
+
+    // Share the throughput, the sample count, and the tensors dimensions in a single collective
+    // Processes without any sample cannot know the dimensions, so we keep the maximum
+    std::array<double, 6> local = {throughput, (double) getLocalSampleCount(), 0, 0, 0, 0};
+    if (not local_inputs.empty()) {
+      local[2] = (double) local_inputs.front().getRows();
+      local[3] = (double) local_inputs.front().getCols();
+      local[4] = (double) local_targets.front().getRows();
+      local[5] = (double) local_targets.front().getCols();
+    }
+    std::vector<double> global(local.size() * n_process);
+    MPI_Allgather(local.data(), (int) local.size(), MPI_DOUBLE, global.data(), (int) local.size(),
+                  MPI_DOUBLE, comm);
+
+    std::vector<double> throughputs(n_process);
+    std::vector<size_t> counts(n_process);
+    std::array<size_t, 4> dims = {0, 0, 0, 0};
+    for (size_t p = 0; p < n_process; p++) {
+      throughputs[p] = global[p * local.size()];
+      counts[p] = (size_t) global[p * local.size() + 1];
+      for (size_t d = 0; d < dims.size(); d++)
+        dims[d] = std::max(dims[d], (size_t) global[p * local.size() + 2 + d]);
+    }
+
+    // Every process must have measured its throughput
+    if (std::any_of(throughputs.begin(), throughputs.end(), [](double t) { return t <= 0; }))
+      return;
+
+    size_t total = std::accumulate(counts.begin(), counts.end(), (size_t) 0);
+    auto targets = computeTargetCounts(total, throughputs);
+
+    size_t max_imbalance = 0;
+    for (size_t p = 0; p < n_process; p++)
+      max_imbalance = std::max(max_imbalance, counts[p] > targets[p] ? counts[p] - targets[p]
+                                                                     : targets[p] - counts[p]);
+    if ((double) max_imbalance <= kRebalanceThreshold * (double) total / n_process) return;
+
+    auto transfers = planTransfers(counts, targets);
+    migrateSamples(transfers, comm, dims, local_inputs, local_targets);
+
+    tscl::logger("[P" + std::to_string(rank) + "]: Rebalanced to " +
+                         std::to_string(getLocalSampleCount()) + " samples (" +
+                         std::to_string(throughput) + " samples/s)",
+                 tscl::Log::Debug);
+  }
+
+  void MPIParallelScheduler::print(std::ostream &os) const {
+    os << "MPIParallelScheduler: " << std::endl;
+    os << "\tBatch size: " << getJob().getBatchSize() << std::endl;
+    os << "\tLocal work size: " << getLocalSampleCount() << std::endl;
+    os << "\tThroughput: " << throughput << " samples/s" << std::endl;
+  }
 
   std::unique_ptr<ParallelScheduler> MPIParallelScheduler::Builder::build() const {
     if (not optimizer or devices.empty() or not job.isValid()) {
@@ -114,4 +239,4 @@ namespace nnet {
     auto scheduler = ParallelScheduler::makeWithDefaultDispatcher(job, *optimizer, policy);
     return std::make_unique<MPIParallelScheduler>(std::move(scheduler));
   }
-}   // namespace nnet
\ No newline at end of file
+}   // namespace nnet
@@ -0,0 +1,77 @@
+#include "MPIPipelineScheduler.hpp"
+
+namespace nnet {
+
+  MPIPipelineScheduler::MPIPipelineScheduler(const BatchSchedulerJob &job,
+                                             MPIPipelineOptimizer &optimizer)
+      : BatchOptimizationScheduler(job), optimizer(&optimizer) {
+    if (job.hasByteInputs())
+      throw std::invalid_argument("MPIPipelineScheduler: Inputs stored as bytes are not supported");
+    if (job.getAugmentation())
+      throw std::invalid_argument("MPIPipelineScheduler: Augmentations are not supported");
+    auto operation = optimizer.makeOperation();
+    optimizer_operation.reset(dynamic_cast<MPIPipelineOptimizer::Operation *>(operation.release()));
+    // Each stage runs the micro-batches sequentially, a single cache is enough
+    optimizer_operation->reserveCaches(1);
+  }
+
+  void MPIPipelineScheduler::run() {
+    epochStart();
+    MPI_Comm comm = optimizer->getCommunicator();
+    const bool first = optimizer->isFirstStage();
+    auto &queue = utils::cl_wrapper.getDefaultQueue();
+
+    // The first stage splits its tensors into batches, and sends the size of each batch to the
+    // other stages
+    std::vector<unsigned long> batch_sizes;
+    // The tensor and the first sample of each batch, only known by the first stage
+    std::vector<std::pair<size_t, size_t>> locations;
+    if (first) {
+      size_t batch_size = getJob().getBatchSize();
+      auto &inputs = getJob().getInputs();
+      for (size_t t = 0; t < inputs.size(); t++) {
+        for (size_t begin = 0; begin < inputs[t].getDepth(); begin += batch_size) {
+          locations.emplace_back(t, begin);
+          batch_sizes.push_back(std::min(batch_size, inputs[t].getDepth() - begin));
+        }
+      }
+    }
+
+    unsigned long n_batch = batch_sizes.size();
+    MPI_Bcast(&n_batch, 1, MPI_UNSIGNED_LONG, 0, comm);
+    batch_sizes.resize(n_batch);
+    MPI_Bcast(batch_sizes.data(), (int) n_batch, MPI_UNSIGNED_LONG, 0, comm);
+
+    for (size_t b = 0; b < n_batch; b++) {
+      if (first) {
+        auto [t, begin] = locations[b];
+        size_t end = begin + batch_sizes[b];
+        optimizer_operation->runBatch(batch_sizes[b], getJob().getInputs()[t].slice(begin, end),
+                                      getJob().getTargets()[t].slice(begin, end), queue);
+      } else {
+        optimizer_operation->runBatch(batch_sizes[b], {}, {}, queue);
+      }
+      updateModel();
+    }
+
+    optimizer->update();
+    endEpoch();
+  }
+
+  void MPIPipelineScheduler::updateModel() {
+    optimizer_operation->updateModel(utils::cl_wrapper.getDefaultQueue());
+  }
+
+  void MPIPipelineScheduler::print(std::ostream &os) const {
+    int rank = 0, n_stage = 0;
+    MPI_Comm_rank(optimizer->getCommunicator(), &rank);
+    MPI_Comm_size(optimizer->getCommunicator(), &n_stage);
+    os << "MPIPipelineScheduler: " << std::endl;
+    os << "\tStage: " << rank << "/" << n_stage << std::endl;
+    os << "\tBatch size: " << getJob().getBatchSize() << std::endl;
+    os << "\tGlobal work size: " << getJob().getGlobalWorkSize() << std::endl;
+  }
+
+  void MPIPipelineScheduler::epochStart() {}
+  void MPIPipelineScheduler::endEpoch() {}
+}   // namespace nnet
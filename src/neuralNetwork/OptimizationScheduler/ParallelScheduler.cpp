@@ -10,7 +10,8 @@ using namespace boost;
 namespace nnet {
   namespace {
 
-    bool checkTensorsSize(const std::vector<clFTensor> &inputs,
+    template<typename InputTensor>
+    bool checkTensorsSize(const std::vector<InputTensor> &inputs,
                           const std::vector<clFTensor> &targets) {
       if (inputs.size() != targets.size()) return false;
 
@@ -115,7 +116,7 @@ namespace nnet {
       for (size_t i = 0; i < count;) {
         size_t work_size = std::min(count - i, progression.getBatchRemainder());
 
-        clFTensor current_input = progression.getInputSlice(work_size);
+        clFTensor current_input = progression.getInputSlice(work_size, queue);
         clFTensor current_target = progression.getTargetSlice(work_size);
 
         op(thread_rank, current_input, current_target, queue);
@@ -131,15 +132,14 @@ namespace nnet {
                                        std::unique_ptr<Dispatcher> dispatcher)
       : BatchOptimizationScheduler(job), batch_dispatcher(std::move(dispatcher)),
         optimizer(&optimizer) {
-    bool tensors_ok = checkTensorsSize(job.getInputs(), job.getTargets());
+    if (not job.isValid())
+      throw std::runtime_error("ParallelScheduler::ParallelScheduler: Invalid job");
+    bool tensors_ok = job.hasByteInputs() ? checkTensorsSize(job.getByteInputs(), job.getTargets())
+                                          : checkTensorsSize(job.getInputs(), job.getTargets());
     if (not tensors_ok) {
-      tscl::logger("job.getInputs().size() != job.getTargets().size(): " +
-                           std::to_string(job.getInputs().size()) +
-                           " != " + std::to_string(job.getTargets().size()),
-                   tscl::Log::Error);
+      tscl::logger("The inputs and targets of the job have different sizes", tscl::Log::Error);
       throw std::runtime_error("ParallelScheduler::ParallelScheduler: Tensors size mismatch");
-    } else if (not job.isValid())
-      throw std::runtime_error("ParallelScheduler::ParallelScheduler: Invalid job");
+    }
     optimizer_operation = optimizer.makeOperation();
   }
 
@@ -155,7 +155,11 @@ namespace nnet {
     size_t global_work_size = getJob().getGlobalWorkSize();
     size_t batch_size = getJob().getBatchSize();
 
-    BatchLocation progression(getJob().getInputs(), getJob().getTargets());
+    BatchLocation progression =
+            getJob().hasByteInputs()
+                    ? BatchLocation(getJob().getByteInputs(), getJob().getTargets())
+                    : BatchLocation(getJob().getInputs(), getJob().getTargets());
+    progression.setAugmentation(getJob().getAugmentation(), getJob().getSampleIds(), epoch);
 
     for (size_t current_size = 0; current_size < global_work_size; current_size += batch_size) {
       size_t current_batch_size = std::min(global_work_size - current_size, batch_size);
@@ -164,6 +168,7 @@ namespace nnet {
     }
 
     optimizer->update();
+    epoch++;
     endEpoch();
   }
 
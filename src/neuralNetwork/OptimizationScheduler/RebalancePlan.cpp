@@ -0,0 +1,53 @@
+#include "RebalancePlan.hpp"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace nnet {
+
+  std::vector<size_t> computeTargetCounts(size_t total, const std::vector<double> &throughputs) {
+    double total_throughput = std::accumulate(throughputs.begin(), throughputs.end(), 0.0);
+    if (throughputs.empty() or total_throughput <= 0)
+      throw std::invalid_argument("computeTargetCounts: throughputs must be positive");
+
+    std::vector<size_t> targets(throughputs.size());
+    std::vector<std::pair<double, size_t>> remainders;
+    size_t assigned = 0;
+    for (size_t i = 0; i < throughputs.size(); i++) {
+      double share = (double) total * throughputs[i] / total_throughput;
+      targets[i] = (size_t) share;
+      assigned += targets[i];
+      remainders.emplace_back(share - (double) targets[i], i);
+    }
+
+    // Ties are broken by rank, so that every process computes the same targets
+    std::stable_sort(remainders.begin(), remainders.end(),
+                     [](const auto &a, const auto &b) { return a.first > b.first; });
+    for (size_t i = 0; assigned < total; i++, assigned++) targets[remainders[i].second]++;
+    return targets;
+  }
+
+  std::vector<SampleTransfer> planTransfers(const std::vector<size_t> &counts,
+                                            const std::vector<size_t> &targets) {
+    if (counts.size() != targets.size())
+      throw std::invalid_argument("planTransfers: counts and targets size mismatch");
+
+    std::vector<SampleTransfer> transfers;
+    std::vector<long> surplus(counts.size());
+    for (size_t i = 0; i < counts.size(); i++) surplus[i] = (long) counts[i] - (long) targets[i];
+
+    size_t src = 0, dst = 0;
+    while (true) {
+      while (src < surplus.size() and surplus[src] <= 0) src++;
+      while (dst < surplus.size() and surplus[dst] >= 0) dst++;
+      if (src == surplus.size() or dst == surplus.size()) break;
+
+      long count = std::min(surplus[src], -surplus[dst]);
+      transfers.push_back({(int) src, (int) dst, (size_t) count});
+      surplus[src] -= count;
+      surplus[dst] += count;
+    }
+    return transfers;
+  }
+
+}   // namespace nnet
@@ -40,7 +40,7 @@ namespace nnet {
       }
     }
 
-    clFTensor backward(MLPerceptron &perceptron, const clFTensor &targets,
+    clFTensor backward(MLPerceptron &perceptron, clFTensor error,
                        std::vector<clFTensor> &layers_output,
                        std::vector<clFTensor> &layers_af_output,
                        MLPOptimizer::WeightUpdateCache &updater, cl::CommandQueue &queue) {
@@ -50,12 +50,6 @@ namespace nnet {
       if (weights.empty()) return {};
 
       // std::stringstream ss;
-      // auto substart = std::chrono::high_resolution_clock::now();
-      clFTensor error = layers_af_output.back().sub(1.0f, targets, queue);
-      // auto subend = std::chrono::high_resolution_clock::now();
-      // auto subduration = std::chrono::duration_cast<std::chrono::microseconds>(subend -
-      // substart); ss << queue() << ": "
-      //    << "Subtraction: " << subduration.count() << " us" << std::endl;
       //   Need to use a long since we stop when index reaches -1
       for (long i = weights.size() - 1; i >= 0; i--) {
         // auto start = std::chrono::high_resolution_clock::now();
@@ -190,17 +184,32 @@ namespace nnet {
 
   clFTensor MLPOptimizer::optimize(const clFTensor &inputs, const clFTensor &targets,
                                    WeightUpdateCache &cache, cl::CommandQueue &queue) {
-    std::vector<clFTensor> layers_output(neural_network->getWeights().size() + 1);
-    std::vector<clFTensor> layers_af_output(neural_network->getWeights().size() + 1);
+    auto layers = forwardPass(inputs, cache, queue);
+    clFTensor error = layers.layers_af_output.back().sub(1.0f, targets.flatten(), queue);
 
-    forward(*neural_network, inputs.flatten(), layers_output, layers_af_output, cache, queue);
-
-    auto res = backward(*neural_network, targets.flatten(), layers_output, layers_af_output, cache,
-                        queue);
+    auto res = backwardPass(std::move(error), layers, cache, queue);
     cache.increaseContribution(inputs.getDepth());
     return res;
   }
 
+  MLPOptimizer::LayersOutput MLPOptimizer::forwardPass(const clFTensor &inputs,
+                                                       WeightUpdateCache &cache,
+                                                       cl::CommandQueue &queue) {
+    LayersOutput res;
+    res.layers_output.resize(neural_network->getWeights().size() + 1);
+    res.layers_af_output.resize(neural_network->getWeights().size() + 1);
+
+    forward(*neural_network, inputs.flatten(), res.layers_output, res.layers_af_output, cache,
+            queue);
+    return res;
+  }
+
+  clFTensor MLPOptimizer::backwardPass(clFTensor output_error, LayersOutput &layers,
+                                       WeightUpdateCache &cache, cl::CommandQueue &queue) {
+    return backward(*neural_network, std::move(output_error), layers.layers_output,
+                    layers.layers_af_output, cache, queue);
+  }
+
   math::clFTensor MLPOptimizer::Operation::computeGradient(size_t thread_rank,
                                                            const math::clFTensor &inputs,
                                                            const math::clFTensor &targets,
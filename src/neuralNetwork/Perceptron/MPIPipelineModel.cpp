@@ -0,0 +1,84 @@
+#include "MPIPipelineModel.hpp"
+
+using namespace math;
+
+namespace nnet {
+  namespace {
+    constexpr int kActivationTag = 4;
+
+    void send(const clFTensor &tensor, int dest, MPI_Comm comm, cl::CommandQueue &queue) {
+      // The map is blocking, so that the tensor is fully computed before being sent
+      void *data = queue.enqueueMapBuffer(tensor.getBuffer(), CL_TRUE, CL_MAP_READ,
+                                          tensor.getOffsetInBytes(), tensor.sizeInBytes());
+      MPI_Send(data, (int) tensor.size(), MPI_FLOAT, dest, kActivationTag, comm);
+      queue.enqueueUnmapMemObject(tensor.getBuffer(), data);
+    }
+
+    clFTensor receive(size_t rows, size_t depth, int source, MPI_Comm comm,
+                      cl::CommandQueue &queue) {
+      clFTensor res(rows, 1, depth);
+      void *data = queue.enqueueMapBuffer(res.getBuffer(), CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION,
+                                          0, res.sizeInBytes());
+      MPI_Recv(data, (int) res.size(), MPI_FLOAT, source, kActivationTag, comm, MPI_STATUS_IGNORE);
+      queue.enqueueUnmapMemObject(res.getBuffer(), data);
+      return res;
+    }
+  }   // namespace
+
+  MPIPipelineModel::MPIPipelineModel(MLPModel &stage, MPI_Comm comm) : stage(&stage), comm(comm) {
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &n_stage);
+
+    unsigned long size = stage.getPerceptron().getTopology().getOutputSize();
+    MPI_Bcast(&size, 1, MPI_UNSIGNED_LONG, n_stage - 1, comm);
+    output_size = size;
+  }
+
+  clFMatrix MPIPipelineModel::predict(cl::CommandQueue &queue, const clFMatrix &input) const {
+    clFTensor inputs;
+    if (isFirstStage()) {
+      inputs = clFTensor(input.getRows(), input.getCols(), 1);
+      inputs[0].copy(input, queue, false);
+    }
+    clFTensor outputs = predict(queue, inputs);
+    return outputs[0];
+  }
+
+  clFTensor MPIPipelineModel::predict(cl::CommandQueue &queue, const clFTensor &inputs) const {
+    // Only the first stage knows the number of samples
+    unsigned long depth = isFirstStage() ? inputs.getDepth() : 0;
+    MPI_Bcast(&depth, 1, MPI_UNSIGNED_LONG, 0, comm);
+    // We need to return if the size is 0 else OpenCL will throw
+    if (depth == 0) return {};
+
+    auto &perceptron = stage->getPerceptron();
+    clFTensor activations;
+    if (isFirstStage()) activations = perceptron.predict(queue, inputs);
+    else {
+      size_t input_size = perceptron.getTopology().getInputSize();
+      activations = perceptron.predict(queue, receive(input_size, depth, rank - 1, comm, queue));
+    }
+    if (not isLastStage()) send(activations, rank + 1, comm, queue);
+
+    // The outputs are broadcast from the last stage, so that every stage returns the same result
+    clFTensor outputs = isLastStage() ? std::move(activations) : clFTensor(output_size, 1, depth);
+    void *data = queue.enqueueMapBuffer(outputs.getBuffer(), CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                                        outputs.getOffsetInBytes(), outputs.sizeInBytes());
+    MPI_Bcast(data, (int) outputs.size(), MPI_FLOAT, n_stage - 1, comm);
+    queue.enqueueUnmapMemObject(outputs.getBuffer(), data);
+    queue.finish();
+    return outputs;
+  }
+
+  std::filesystem::path MPIPipelineModel::getStagePath(const std::filesystem::path &path) const {
+    return path.string() + ".stage" + std::to_string(rank);
+  }
+
+  bool MPIPipelineModel::save(const std::filesystem::path &path) const {
+    return stage->save(getStagePath(path));
+  }
+
+  bool MPIPipelineModel::load(const std::filesystem::path &path) {
+    return stage->load(getStagePath(path));
+  }
+}   // namespace nnet
@@ -0,0 +1,150 @@
+#include "MPIPipelineOptimizer.hpp"
+#include "PipelinePartition.hpp"
+
+using namespace math;
+
+namespace nnet {
+  namespace {
+    constexpr int kActivationTag = 0;
+    constexpr int kErrorTag = 1;
+    constexpr int kTargetTag = 2;
+    constexpr int kTopologyTag = 3;
+
+    /**
+     * @brief A tensor being sent asynchronously. The tensor stays mapped in host memory until the
+     * request completes
+     */
+    struct PendingSend {
+      clFTensor tensor;
+      void *data = nullptr;
+      MPI_Request request = MPI_REQUEST_NULL;
+    };
+
+    void sendAsync(const clFTensor &tensor, int dest, int tag, MPI_Comm comm,
+                   cl::CommandQueue &queue, std::vector<PendingSend> &sends) {
+      PendingSend send;
+      // Keeps the buffer alive until the request completes
+      send.tensor = tensor.shallowCopy();
+      // The map is blocking, so that the tensor is fully computed before being sent
+      send.data = queue.enqueueMapBuffer(send.tensor.getBuffer(), CL_TRUE, CL_MAP_READ,
+                                         send.tensor.getOffsetInBytes(), send.tensor.sizeInBytes());
+      MPI_Isend(send.data, (int) send.tensor.size(), MPI_FLOAT, dest, tag, comm, &send.request);
+      sends.push_back(std::move(send));
+    }
+
+    void waitSends(std::vector<PendingSend> &sends, cl::CommandQueue &queue) {
+      for (auto &send : sends) {
+        MPI_Wait(&send.request, MPI_STATUS_IGNORE);
+        queue.enqueueUnmapMemObject(send.tensor.getBuffer(), send.data);
+      }
+      queue.finish();
+      sends.clear();
+    }
+
+    /**
+     * @brief Receives a tensor of flattened matrices of the given size
+     */
+    clFTensor receive(size_t rows, size_t depth, int source, int tag, MPI_Comm comm,
+                      cl::CommandQueue &queue) {
+      clFTensor res(rows, 1, depth);
+      void *data = queue.enqueueMapBuffer(res.getBuffer(), CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION,
+                                          0, res.sizeInBytes());
+      MPI_Recv(data, (int) res.size(), MPI_FLOAT, source, tag, comm, MPI_STATUS_IGNORE);
+      queue.enqueueUnmapMemObject(res.getBuffer(), data);
+      return res;
+    }
+  }   // namespace
+
+  MPIPipelineOptimizer::MPIPipelineOptimizer(MLPModel &stage,
+                                             std::unique_ptr<Optimization> optimization,
+                                             MPI_Comm comm, size_t n_micro_batch)
+      : MLPOptimizer(stage, std::move(optimization)), comm(comm),
+        n_micro_batch(std::max<size_t>(n_micro_batch, 1)) {
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &n_stage);
+
+    // Ensures each stage outputs activations of the size expected by the next one
+    auto &topology = neural_network->getTopology();
+    unsigned long input_size = topology.getInputSize();
+    unsigned long next_input_size = topology.getOutputSize();
+    MPI_Sendrecv(&input_size, 1, MPI_UNSIGNED_LONG, isFirstStage() ? MPI_PROC_NULL : rank - 1,
+                 kTopologyTag, &next_input_size, 1, MPI_UNSIGNED_LONG,
+                 isLastStage() ? MPI_PROC_NULL : rank + 1, kTopologyTag, comm, MPI_STATUS_IGNORE);
+    if (next_input_size != topology.getOutputSize())
+      throw std::runtime_error("MPIPipelineOptimizer: The output size of stage " +
+                               std::to_string(rank) + " does not match the input of the next one");
+  }
+
+  MLPOptimizer::Operation *MPIPipelineOptimizer::makeOperationImpl() {
+    return new Operation(*this);
+  }
+
+  MPIPipelineOptimizer::Operation::Operation(MPIPipelineOptimizer &optimizer)
+      : MLPOptimizer::Operation(optimizer), pipeline(&optimizer) {}
+
+  void MPIPipelineOptimizer::Operation::operator()(size_t thread_rank, const clFTensor &inputs,
+                                                   const clFTensor &targets,
+                                                   cl::CommandQueue queue) {
+    runBatch(inputs.getDepth(), inputs, targets, queue);
+  }
+
+  void MPIPipelineOptimizer::Operation::runBatch(size_t batch_size, const clFTensor &inputs,
+                                                 const clFTensor &targets,
+                                                 cl::CommandQueue &queue) {
+    auto &cache = getCache(0);
+    auto &topology = pipeline->getNeuralNetwork()->getTopology();
+    const MPI_Comm comm = pipeline->comm;
+    const int rank = pipeline->rank;
+    const bool first = pipeline->isFirstStage(), last = pipeline->isLastStage();
+
+    cache.acquireBuffer(queue);
+    auto bounds = splitBatch(batch_size, pipeline->n_micro_batch);
+    const size_t n_micro_batch = bounds.size() - 1;
+
+    std::vector<LayersOutput> layers(n_micro_batch);
+    std::vector<clFTensor> micro_targets(n_micro_batch);
+    std::vector<PendingSend> sends;
+
+    // Forward pass. Each micro-batch is sent to the next stage as soon as it is computed, so that
+    // consecutive stages work on different micro-batches at the same time
+    for (size_t m = 0; m < n_micro_batch; m++) {
+      const size_t depth = bounds[m + 1] - bounds[m];
+      clFTensor input;
+      if (first) {
+        input = inputs.slice(bounds[m], bounds[m + 1]);
+        auto target = targets.slice(bounds[m], bounds[m + 1]).flatten();
+        if (last) micro_targets[m] = std::move(target);
+        else
+          sendAsync(target, pipeline->n_stage - 1, kTargetTag, comm, queue, sends);
+      } else {
+        input = receive(topology.getInputSize(), depth, rank - 1, kActivationTag, comm, queue);
+      }
+
+      if (last and not first)
+        micro_targets[m] = receive(topology.getOutputSize(), depth, 0, kTargetTag, comm, queue);
+
+      layers[m] = pipeline->forwardPass(input, cache, queue);
+      if (not last)
+        sendAsync(layers[m].layers_af_output.back(), rank + 1, kActivationTag, comm, queue, sends);
+    }
+
+    // Backward pass, in reverse order: the last micro-batch is the first to reach the last stage
+    for (size_t m = n_micro_batch; m-- > 0;) {
+      const size_t depth = bounds[m + 1] - bounds[m];
+      clFTensor error;
+      if (last) error = layers[m].layers_af_output.back().sub(1.0f, micro_targets[m], queue);
+      else
+        error = receive(topology.getOutputSize(), depth, rank + 1, kErrorTag, comm, queue);
+
+      auto input_error = pipeline->backwardPass(std::move(error), layers[m], cache, queue);
+      cache.increaseContribution(depth);
+      if (not first) sendAsync(input_error, rank - 1, kErrorTag, comm, queue, sends);
+
+      // The activations of this micro-batch are no longer needed
+      layers[m] = LayersOutput();
+    }
+
+    waitSends(sends, queue);
+  }
+
+}   // namespace nnet
@@ -0,0 +1,48 @@
+#include "PipelinePartition.hpp"
+
+namespace nnet {
+
+  MLPTopology makeStageTopology(const MLPTopology &topology, size_t stage, size_t n_stage) {
+    if (stage >= n_stage) throw std::invalid_argument("makeStageTopology: Invalid stage");
+
+    size_t n_layers = topology.empty() ? 0 : topology.size() - 1;
+    if (n_layers < n_stage)
+      throw std::invalid_argument("makeStageTopology: The perceptron has " +
+                                  std::to_string(n_layers) + " layers, which cannot be split in " +
+                                  std::to_string(n_stage) + " stages");
+
+    std::vector<size_t> weight_count(n_layers);
+    size_t total = 0;
+    for (size_t i = 0; i < n_layers; i++) {
+      weight_count[i] = topology[i] * topology[i + 1];
+      total += weight_count[i];
+    }
+
+    // Each stage takes layers until it reaches its share of the weights, while leaving at least one
+    // layer to each of the following stages
+    std::vector<size_t> bounds = {0};
+    size_t cumulated = 0, layer = 0;
+    for (size_t s = 0; s + 1 < n_stage; s++) {
+      size_t target = total * (s + 1) / n_stage;
+      cumulated += weight_count[layer++];
+      while (layer < n_layers - (n_stage - 1 - s) and
+             cumulated + weight_count[layer] / 2 <= target)
+        cumulated += weight_count[layer++];
+      bounds.push_back(layer);
+    }
+    bounds.push_back(n_layers);
+
+    MLPTopology res;
+    for (size_t i = bounds[stage]; i <= bounds[stage + 1]; i++) res.pushBack(topology[i]);
+    return res;
+  }
+
+  std::vector<size_t> splitBatch(size_t batch_size, size_t n_micro_batch) {
+    n_micro_batch = std::min(n_micro_batch, batch_size);
+    std::vector<size_t> res(n_micro_batch + 1, 0);
+    for (size_t i = 0; i < n_micro_batch; i++)
+      res[i + 1] = res[i] + batch_size / n_micro_batch + (i < batch_size % n_micro_batch ? 1 : 0);
+    return res;
+  }
+
+}   // namespace nnet
@@ -0,0 +1,99 @@
+#include "TiledInference.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace control;
+
+TEST(TiledInferenceTest, OriginsFollowTheStride) {
+  EXPECT_EQ(TiledInference::tileOrigins(10, 4, 2), (std::vector<size_t>{0, 2, 4, 6}));
+  EXPECT_EQ(TiledInference::tileOrigins(8, 4, 4), (std::vector<size_t>{0, 4}));
+}
+
+TEST(TiledInferenceTest, LastOriginIsAlignedOnTheBorder) {
+  EXPECT_EQ(TiledInference::tileOrigins(10, 4, 4), (std::vector<size_t>{0, 4, 6}));
+  EXPECT_EQ(TiledInference::tileOrigins(11, 4, 3), (std::vector<size_t>{0, 3, 6, 7}));
+}
+
+TEST(TiledInferenceTest, OriginsOfSmallAxes) {
+  EXPECT_EQ(TiledInference::tileOrigins(4, 4, 2), (std::vector<size_t>{0}));
+  EXPECT_TRUE(TiledInference::tileOrigins(3, 4, 2).empty());
+  EXPECT_ANY_THROW(TiledInference::tileOrigins(10, 4, 0));
+  EXPECT_ANY_THROW(TiledInference::tileOrigins(10, 0, 2));
+}
+
+TEST(TiledInferenceTest, HeatmapOfDisjointTilesCopiesTheScores) {
+  // 2x2 tiles of 2x2 pixels, with two outputs per tile
+  math::FloatMatrix scores(4, 2);
+  for (size_t i = 0; i < 4; i++) {
+    scores(i, 0) = (float) i;
+    scores(i, 1) = 10.f + (float) i;
+  }
+
+  math::FloatMatrix heatmap = TiledInference::averageTiles(scores, 1, 4, 4, 2, 2, 2, 2);
+  ASSERT_EQ(heatmap.getRows(), 4);
+  ASSERT_EQ(heatmap.getCols(), 4);
+  for (size_t y = 0; y < 4; y++) {
+    for (size_t x = 0; x < 4; x++) {
+      EXPECT_FLOAT_EQ(heatmap(y, x), 10.f + (float) ((y / 2) * 2 + x / 2));
+    }
+  }
+}
+
+TEST(TiledInferenceTest, HeatmapAveragesOverlappingTiles) {
+  // A 5x3 image covered by 3x3 tiles every 2 pixels: tiles start at x = 0 and x = 2, and overlap
+  // on the middle column
+  math::FloatMatrix scores(2, 1);
+  scores(0, 0) = 1.f;
+  scores(1, 0) = 3.f;
+
+  math::FloatMatrix heatmap = TiledInference::averageTiles(scores, 0, 5, 3, 3, 3, 2, 2);
+  ASSERT_EQ(heatmap.getRows(), 3);
+  ASSERT_EQ(heatmap.getCols(), 5);
+  const float expected[5] = {1.f, 1.f, 2.f, 3.f, 3.f};
+  for (size_t y = 0; y < 3; y++) {
+    for (size_t x = 0; x < 5; x++) EXPECT_FLOAT_EQ(heatmap(y, x), expected[x]);
+  }
+}
+
+TEST(TiledInferenceTest, HeatmapMatchesABruteForceAverage) {
+  const size_t width = 13, height = 9, tile_w = 5, tile_h = 4, stride_x = 3, stride_y = 2;
+  auto x_origins = TiledInference::tileOrigins(width, tile_w, stride_x);
+  auto y_origins = TiledInference::tileOrigins(height, tile_h, stride_y);
+
+  math::FloatMatrix scores(x_origins.size() * y_origins.size(), 1);
+  for (size_t i = 0; i < scores.getRows(); i++) scores(i, 0) = (float) ((i * 7) % 5) * 0.25f;
+
+  math::FloatMatrix heatmap = TiledInference::averageTiles(scores, 0, width, height, tile_w,
+                                                           tile_h, stride_x, stride_y);
+  for (size_t y = 0; y < height; y++) {
+    for (size_t x = 0; x < width; x++) {
+      double sum = 0;
+      size_t count = 0;
+      for (size_t ty = 0; ty < y_origins.size(); ty++) {
+        for (size_t tx = 0; tx < x_origins.size(); tx++) {
+          if (x < x_origins[tx] or x >= x_origins[tx] + tile_w) continue;
+          if (y < y_origins[ty] or y >= y_origins[ty] + tile_h) continue;
+          sum += scores(ty * x_origins.size() + tx, 0);
+          count++;
+        }
+      }
+      ASSERT_GT(count, 0);
+      EXPECT_NEAR(heatmap(y, x), sum / (double) count, 1e-5);
+    }
+  }
+}
+
+TEST(TiledInferenceTest, HeatmapThrowsOnMismatchedScores) {
+  math::FloatMatrix scores(3, 2);
+  EXPECT_ANY_THROW(TiledInference::averageTiles(scores, 2, 4, 4, 2, 2, 2, 2));
+  EXPECT_ANY_THROW(TiledInference::averageTiles(scores, 0, 4, 4, 2, 2, 2, 2));
+  EXPECT_ANY_THROW(TiledInference::averageTiles(scores, 0, 1, 4, 2, 2, 2, 2));
+}
+
+TEST(TiledInferenceTest, HeatmapThrowsOnUncoveredPixels) {
+  // Tiles of 2 pixels every 5 pixels leave x = 2..4 uncovered
+  EXPECT_EQ(TiledInference::tileOrigins(10, 2, 5), (std::vector<size_t>{0, 5, 8}));
+  math::FloatMatrix scores(3, 1);
+  EXPECT_ANY_THROW(TiledInference::averageTiles(scores, 0, 10, 2, 2, 2, 5, 2));
+  EXPECT_ANY_THROW(TiledInference::averageTiles(scores, 0, 2, 10, 2, 2, 2, 5));
+}
@@ -1,5 +1,7 @@
 #include "Transform.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <gtest/gtest.h>
 
 #include "Image.hpp"
@@ -53,3 +55,122 @@ TEST(TransformTest, ResizeToZero) {
   resize_tranform = image::transform::Resize(0, 0);
   ASSERT_THROW(resize_tranform.transform(original), std::invalid_argument);
 }
+
+TEST(TransformTest, IdentifierDependsOnParameters) {
+  image::transform::TransformEngine a, b, c;
+  a.addTransformation(std::make_shared<image::transform::Inversion>());
+  a.addTransformation(std::make_shared<image::transform::Resize>(32, 32));
+  b.addTransformation(std::make_shared<image::transform::Inversion>());
+  b.addTransformation(std::make_shared<image::transform::Resize>(32, 32));
+  c.addTransformation(std::make_shared<image::transform::Inversion>());
+  c.addTransformation(std::make_shared<image::transform::Resize>(32, 16));
+
+  ASSERT_EQ(a.getIdentifier(), b.getIdentifier());
+  ASSERT_NE(a.getIdentifier(), c.getIdentifier());
+  ASSERT_NE(a.getIdentifier(), image::transform::TransformEngine().getIdentifier());
+}
+
+TEST(TransformTest, FilterMatchesGaussianConvolution) {
+  image::GrayscaleImage original = image::ImageSerializer::createRandomNoiseImage(37, 23);
+  image::GrayscaleImage filtered = original;
+  image::transform::Filter().transform(filtered);
+
+  // Reference 2D convolution, with the border pixels replicated outside the image
+  const int dimension = 11, half_d = dimension / 2;
+  const float sigma = 1.84f;
+  std::vector<float> kernel(dimension * dimension);
+  float sum = 0;
+  for (int y = 0; y < dimension; y++) {
+    for (int x = 0; x < dimension; x++) {
+      float dx = (float) (x - half_d), dy = (float) (y - half_d);
+      kernel[y * dimension + x] = expf(-(dx * dx + dy * dy) / (2 * sigma * sigma));
+      sum += kernel[y * dimension + x];
+    }
+  }
+
+  const int width = (int) original.getWidth(), height = (int) original.getHeight();
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      float expected = 0;
+      for (int ky = 0; ky < dimension; ky++) {
+        for (int kx = 0; kx < dimension; kx++) {
+          int sx = std::clamp(x + kx - half_d, 0, width - 1);
+          int sy = std::clamp(y + ky - half_d, 0, height - 1);
+          expected += kernel[ky * dimension + kx] / sum * (float) original(sx, sy);
+        }
+      }
+      ASSERT_NEAR(filtered(x, y), expected, 1.0) << "at (" << x << ", " << y << ")";
+    }
+  }
+}
+
+TEST(TransformTest, FilterPreservesUniformImage) {
+  image::GrayscaleImage image(64, 48);
+  std::fill(image.begin(), image.end(), (image::grayscale_t) 200);
+  image::transform::Filter().transform(image);
+  ASSERT_TRUE(std::all_of(image.begin(), image.end(), [](auto e) { return e == 200; }));
+}
+
+TEST(TransformTest, FusedPointwiseRunMatchesSequentialTransforms) {
+  image::GrayscaleImage original = image::ImageSerializer::createRandomNoiseImage(50, 30);
+  std::vector<std::shared_ptr<image::transform::Transformation>> transformations = {
+          std::make_shared<image::transform::Inversion>(),
+          std::make_shared<image::transform::Restriction>(7),
+          std::make_shared<image::transform::Equalize>(),
+          std::make_shared<image::transform::Filter>(),
+          std::make_shared<image::transform::BinaryScaleByMedian>(),
+          std::make_shared<image::transform::Inversion>()};
+
+  // The engine composes the pointwise transformations around the filter into lookup tables
+  image::transform::TransformEngine te;
+  for (auto &tr : transformations) te.addTransformation(tr);
+  image::GrayscaleImage fused = te.transform(original);
+
+  image::GrayscaleImage sequential = original;
+  for (auto &tr : transformations) tr->transform(sequential);
+  ASSERT_FLOAT_EQ(fused.getDifference(sequential), .0);
+}
+
+TEST(TransformTest, ResizeAveragesAreaOnReduction) {
+  // A checkerboard averages to a uniform gray, instead of aliasing to black or white
+  image::GrayscaleImage checkerboard(64, 48);
+  for (size_t y = 0; y < checkerboard.getHeight(); y++)
+    for (size_t x = 0; x < checkerboard.getWidth(); x++)
+      checkerboard(x, y) = (x + y) % 2 ? 255 : 0;
+
+  image::transform::Resize(8, 6).transform(checkerboard);
+  ASSERT_TRUE(checkerboard.getWidth() == 8 && checkerboard.getHeight() == 6);
+  for (auto e : checkerboard) ASSERT_NEAR(e, 127.5, 1.0);
+}
+
+TEST(TransformTest, ResizeKeepsCornersOnEnlargement) {
+  image::GrayscaleImage original = image::ImageSerializer::createRandomNoiseImage(10, 10);
+  image::GrayscaleImage enlarged = original;
+  image::transform::Resize(37, 23).transform(enlarged);
+  ASSERT_EQ(original(0, 0), enlarged(0, 0));
+  ASSERT_EQ(original(9, 0), enlarged(36, 0));
+  ASSERT_EQ(original(0, 9), enlarged(0, 22));
+  ASSERT_EQ(original(9, 9), enlarged(36, 22));
+}
+
+TEST(TransformTest, BatchMatchesImageByImage) {
+  image::transform::TransformEngine te;
+  te.addTransformation(std::make_shared<image::transform::Inversion>());
+  te.addTransformation(std::make_shared<image::transform::Equalize>());
+  te.addTransformation(std::make_shared<image::transform::Filter>());
+  te.addTransformation(std::make_shared<image::transform::BinaryScale>());
+
+  std::vector<image::GrayscaleImage> images;
+  image::ImageBatch batch(31, 17, 4);
+  for (size_t i = 0; i < batch.getCount(); i++) {
+    images.push_back(image::ImageSerializer::createRandomNoiseImage(31, 17));
+    batch.setImage(i, images.back());
+  }
+
+  te.apply(batch);
+  for (size_t i = 0; i < batch.getCount(); i++)
+    ASSERT_FLOAT_EQ(te.transform(images[i]).getDifference(batch.getImageCopy(i)), .0);
+
+  // Transformations changing the size of the images cannot be applied on a batch
+  ASSERT_THROW(image::transform::Resize(8, 8).transformBatch(batch), std::invalid_argument);
+}
@@ -0,0 +1,74 @@
+#include "clTransformEngine.hpp"
+
+#include <gtest/gtest.h>
+
+#include "Image.hpp"
+
+using namespace image;
+
+TEST(clTransformEngineTest, MatchesHostTransformations) {
+  const size_t width = 20, height = 16;
+  std::vector<GrayscaleImage> images;
+  for (size_t i = 0; i < 3; i++)
+    images.push_back(ImageSerializer::createRandomNoiseImage(width, height));
+
+  transform::TransformEngine host;
+  host.addTransformation(std::make_shared<transform::Inversion>());
+  host.addTransformation(std::make_shared<transform::Restriction>(3));
+  host.addTransformation(std::make_shared<transform::Equalize>());
+  ASSERT_TRUE(transform::clTransformEngine::supports(host));
+
+  // The images already have the output size, so the resizing does not change them
+  transform::clTransformEngine device(width, height);
+  device.addTransformations(host);
+  cl::CommandQueue queue = utils::cl_wrapper.getDefaultQueue();
+  math::clFTensor res = device.transform(images, queue);
+  ASSERT_EQ(images.size(), res.getDepth());
+
+  for (size_t i = 0; i < images.size(); i++) {
+    GrayscaleImage expected = host.transform(images[i]);
+    math::FloatMatrix actual = res[i].toFloatMatrix(true);
+    // The device builds the equalization with floats, which can round a level differently
+    for (size_t p = 0; p < expected.getSize(); p++)
+      ASSERT_NEAR(expected.getData()[p] / 255.0f, actual.getData()[p], 1.5f / 255.0f);
+  }
+}
+
+TEST(clTransformEngineTest, CropsAndResizesToBytes) {
+  GrayscaleImage image(40, 30);
+  std::fill(image.begin(), image.end(), (grayscale_t) 100);
+
+  transform::clTransformEngine device(7, 7);
+  device.setCrop(10, 10, 5, 5);
+  device.addTransformation(std::make_shared<transform::Inversion>());
+  cl::CommandQueue queue = utils::cl_wrapper.getDefaultQueue();
+  math::clU8Tensor res = device.transformToBytes({image}, queue);
+  ASSERT_EQ(7 * 7, res.size());
+
+  math::FloatMatrix actual = res.toFloat(queue, 1.0f)[0].toFloatMatrix(true);
+  for (size_t p = 0; p < res.size(); p++) ASSERT_FLOAT_EQ(155.0f, actual.getData()[p]);
+
+  device.setCrop(50, 10);
+  ASSERT_THROW(device.transformToBytes({image}, queue), std::invalid_argument);
+}
+
+TEST(clTransformEngineTest, AveragesAreaOnLargeReductions) {
+  const size_t width = 16, height = 12;
+  std::vector<GrayscaleImage> images;
+  images.push_back(ImageSerializer::createRandomNoiseImage(613, 457));
+  images.push_back(ImageSerializer::createRandomNoiseImage(200, 150));
+
+  transform::clTransformEngine device(width, height);
+  cl::CommandQueue queue = utils::cl_wrapper.getDefaultQueue();
+  math::clU8Tensor res = device.transformToBytes(images, queue);
+
+  // The device uses floating-point weights, the host fixed-point weights
+  transform::Resize resize(width, height);
+  for (size_t i = 0; i < images.size(); i++) {
+    GrayscaleImage expected = images[i];
+    resize.transform(expected);
+    math::FloatMatrix actual = res.slice(i, i + 1).toFloat(queue, 1.0f)[0].toFloatMatrix(true);
+    for (size_t p = 0; p < expected.getSize(); p++)
+      ASSERT_NEAR(expected.getData()[p], actual.getData()[p], 1.0f);
+  }
+}
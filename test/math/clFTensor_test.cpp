@@ -155,6 +155,37 @@ TEST(clFTensor, canSplitShallowCopy) {
   for (size_t i = 0; i < 6; i++) { EXPECT_EQ(fmatrix(i, 0), expected(i, 0)); }
 }
 
+TEST(clFTensor, canSliceAView) {
+  FloatMatrix m(1, 2);
+  clFTensor tensor(1, 2, 6);
+  for (size_t i = 0; i < 6; i++) {
+    m(0, 0) = (float) i;
+    m(0, 1) = (float) i;
+    clFMatrix mat = tensor[i];
+    mat = m;
+  }
+
+  // Views of views must be offset from the start of the buffer, not from the parent view
+  auto view = tensor.slice(2, 6);
+  auto sub = view.slice(1, 3);
+  EXPECT_EQ(sub.getDepth(), 2);
+  EXPECT_EQ(sub.getOffset(), 3);
+  EXPECT_EQ(sub.getOffsetInFloats(), 6);
+  EXPECT_EQ(sub[0].toFloatMatrix()(0, 0), 3);
+  EXPECT_EQ(sub[1].toFloatMatrix()(0, 1), 4);
+
+  auto parts = view.slice(3);
+  ASSERT_EQ(parts.size(), 3);
+  EXPECT_EQ(parts[0].getOffset(), 2);
+  EXPECT_EQ(parts[1].getOffset(), 4);
+  EXPECT_EQ(parts[2].getOffset(), 5);
+  EXPECT_EQ(parts[0].getDepth(), 2);
+  EXPECT_EQ(parts[1].getDepth(), 1);
+  EXPECT_EQ(parts[2].getDepth(), 1);
+  EXPECT_EQ(parts[1][0].toFloatMatrix()(0, 0), 4);
+  EXPECT_EQ(parts[2][0].toFloatMatrix()(0, 1), 5);
+}
+
 
 TEST(clFTensor, canSubtract) {
   FloatMatrix m(5, 5);
@@ -0,0 +1,106 @@
+#include "Augmentation.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+
+using namespace nnet;
+using namespace math;
+
+namespace {
+  // Builds a tensor of flattened samples, where each value is unique
+  clFTensor makeSamples(size_t width, size_t height, size_t depth) {
+    clFTensor res(width * height, 1, depth);
+    for (size_t i = 0; i < depth; i++) {
+      FloatMatrix sample(width * height, 1);
+      std::iota(sample.begin(), sample.end(), (float) (i * width * height));
+      res[i].fromFloatMatrix(sample);
+    }
+    return res;
+  }
+
+  std::vector<size_t> makeIds(size_t first, size_t count) {
+    std::vector<size_t> res(count);
+    std::iota(res.begin(), res.end(), first);
+    return res;
+  }
+
+  std::vector<float> toVector(const clFMatrix &matrix) {
+    FloatMatrix host = matrix.toFloatMatrix(true);
+    return {host.begin(), host.end()};
+  }
+}   // namespace
+
+TEST(AugmentationTest, IdentityKeepsSamples) {
+  clFTensor samples = makeSamples(5, 4, 2);
+  Augmentation augmentation(5, 4);
+  ASSERT_TRUE(augmentation.isIdentity());
+
+  cl::CommandQueue queue = utils::cl_wrapper.getDefaultQueue();
+  clFTensor res = augmentation.apply(samples, makeIds(0, 2), 0, queue);
+  for (size_t i = 0; i < samples.getDepth(); i++) ASSERT_EQ(toVector(samples[i]), toVector(res[i]));
+}
+
+TEST(AugmentationTest, FlipsAndRotationsPermutePixels) {
+  const size_t size = 6;
+  clFTensor samples = makeSamples(size, size, 16);
+  Augmentation augmentation(size, size, 42);
+  augmentation.setFlips(true, true);
+  augmentation.setRotations(true);
+
+  cl::CommandQueue queue = utils::cl_wrapper.getDefaultQueue();
+  clFTensor res = augmentation.apply(samples, makeIds(0, 16), 0, queue);
+  bool changed = false;
+  for (size_t i = 0; i < samples.getDepth(); i++) {
+    auto expected = toVector(samples[i]), actual = toVector(res[i]);
+    changed = changed or expected != actual;
+    std::sort(actual.begin(), actual.end());
+    ASSERT_EQ(expected, actual);
+  }
+  ASSERT_TRUE(changed);
+}
+
+TEST(AugmentationTest, DependsOnlyOnSeedEpochAndSample) {
+  const size_t size = 8;
+  clFTensor samples = makeSamples(size, size, 8);
+  Augmentation augmentation(size, size, 7);
+  augmentation.setFlips(true, false);
+  augmentation.setRotations(true);
+  augmentation.setMaxTranslation(2);
+  augmentation.setIntensityJitter(0.2f, 0.1f);
+
+  cl::CommandQueue queue = utils::cl_wrapper.getDefaultQueue();
+  clFTensor whole = augmentation.apply(samples, makeIds(10, 8), 3, queue);
+  // A sample is augmented the same way whatever the batch it belongs to
+  clFTensor part = augmentation.apply(samples.slice(2, 5), makeIds(12, 3), 3, queue);
+  for (size_t i = 0; i < part.getDepth(); i++)
+    ASSERT_EQ(toVector(whole[i + 2]), toVector(part[i]));
+
+  // Or whatever its position in the set, once it is shuffled
+  clFTensor swapped(size * size, 1, 2);
+  swapped[0].copy(samples[5], queue, false);
+  swapped[1].copy(samples[2], queue, false);
+  clFTensor shuffled = augmentation.apply(swapped, {15, 12}, 3, queue);
+  ASSERT_EQ(toVector(whole[5]), toVector(shuffled[0]));
+  ASSERT_EQ(toVector(whole[2]), toVector(shuffled[1]));
+
+  clFTensor next_epoch = augmentation.apply(samples, makeIds(10, 8), 4, queue);
+  bool changed = false;
+  for (size_t i = 0; i < samples.getDepth(); i++)
+    changed = changed or toVector(whole[i]) != toVector(next_epoch[i]);
+  ASSERT_TRUE(changed);
+}
+
+TEST(AugmentationTest, RejectsInvalidParameters) {
+  Augmentation augmentation(6, 4);
+  ASSERT_THROW(augmentation.setRotations(true), std::invalid_argument);
+  ASSERT_THROW(augmentation.setMaxTranslation(4), std::invalid_argument);
+
+  clFTensor samples = makeSamples(5, 5, 1);
+  cl::CommandQueue queue = utils::cl_wrapper.getDefaultQueue();
+  ASSERT_THROW(augmentation.apply(samples, {0}, 0, queue), std::invalid_argument);
+
+  Augmentation square(5, 5);
+  ASSERT_THROW(square.apply(samples, {0, 1}, 0, queue), std::invalid_argument);
+}
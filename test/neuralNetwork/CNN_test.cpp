@@ -46,6 +46,20 @@ TEST(CNNTopologyTest, canCreateTopology) {
   ASSERT_EQ(36, topology.getCNNOutputSize());
 }
 
+TEST(CNNTopologyTest, canCreateTopologyWithStrideAndPadding) {
+  std::string str_topology(
+          "6 6 relu convolution 2 3 3 padding 1 1 pooling max 2 2 stride 2 2 convolution 2 2 2");
+  auto topology = stringToTopology(str_topology);
+
+  ASSERT_EQ(3, topology.getDepth());
+  ASSERT_EQ(6, topology(0)->getOutputSize().first);
+  ASSERT_EQ(3, topology(1)->getOutputSize().first);
+  ASSERT_EQ(2, topology(1)->getStride().first);
+  ASSERT_EQ(0, topology(1)->getPadding().first);
+  ASSERT_EQ(4, topology.getNBranchFinal());
+  ASSERT_EQ(16, topology.getCNNOutputSize());
+}
+
 TEST(CNNTopologyTest, throwInvalidTopology) {
   std::string str_topology("6 6 relu conv 2 2 2 convolution 2 2 2 pooling max 2 2");
   ASSERT_ANY_THROW(stringToTopology(str_topology));
@@ -392,6 +406,157 @@ TEST(CNNLayerTest, canComputeConvolutionLayer) {
   }
 }
 
+TEST(CNNLayerTest, winogradConvolutionMatchesConvgemm) {
+  auto &queue = utils::cl_wrapper.getDefaultQueue();
+  const size_t n_branch = 2, n_filter = 2, n_input = 3;
+  // Odd output size to check the partial tiles
+  CNNConvolutionLayer layer({7, 7}, {3, 3}, n_filter, af::ActivationFunctionType::identity,
+                            n_branch, {1, 1}, {1, 1});
+  layer.setAlgorithm(ConvolutionAlgorithm::winograd);
+
+  clFTensor filters(3, 3, n_branch * n_filter);
+  for (size_t i = 0; i < filters.getDepth(); i++) {
+    FloatMatrix filter(3, 3);
+    randomize<float>(filter, -1.f, 1.f);
+    filters[i] = filter;
+  }
+  layer.setWeight(filters);
+
+  clFTensor input(7, 7, n_branch * n_input);
+  for (size_t i = 0; i < input.getDepth(); i++) {
+    FloatMatrix image(7, 7);
+    randomize<float>(image, -1.f, 1.f);
+    input[i] = image;
+  }
+
+  clFTensor output = layer.compute(queue, input);
+
+  clFTensor expected(7, 7, n_branch * n_filter * n_input);
+  for (size_t b = 0; b < n_branch; b++) {
+    for (size_t f = 0; f < n_filter; f++) {
+      auto filter = filters[b * n_filter + f];
+      auto res = expected[(b * n_filter + f) * n_input];
+      clblast::Convgemm<float>(clblast::KernelMode::kCrossCorrelation, 1, 7, 7, 3, 3, 1, 1, 1, 1,
+                               1, 1, 1, n_input, input.getBuffer()(),
+                               input[b * n_input].getOffset(), filter.getBuffer()(),
+                               filter.getOffset(), res.getBuffer()(), res.getOffset(), &queue(),
+                               nullptr);
+    }
+  }
+
+  for (size_t ii = 0; ii < expected.getDepth(); ii++) {
+    auto expected_matrix = expected[ii].toFloatMatrix(true);
+    auto output_matrix = output[ii].toFloatMatrix(true);
+    for (size_t i = 0; i < 7; i++) {
+      for (size_t j = 0; j < 7; j++) {
+        EXPECT_NEAR(expected_matrix(i, j), output_matrix(i, j), 1e-4f);
+      }
+    }
+  }
+}
+
+TEST(CNNLayerTest, directConvolutionMatchesGemm) {
+  auto &queue = utils::cl_wrapper.getDefaultQueue();
+  const size_t n_branch = 2, n_filter = 3, n_input = 2;
+  // Stride, padding and an output larger than a tile of the direct kernels
+  CNNConvolutionLayer direct({10, 18}, {3, 2}, n_filter, af::ActivationFunctionType::identity,
+                             n_branch, {2, 1}, {1, 1});
+  direct.setAlgorithm(ConvolutionAlgorithm::direct);
+  CNNConvolutionLayer gemm(direct);
+  gemm.setAlgorithm(ConvolutionAlgorithm::gemm);
+
+  clFTensor filters(3, 2, n_branch * n_filter);
+  for (size_t i = 0; i < filters.getDepth(); i++) {
+    FloatMatrix filter(3, 2);
+    randomize<float>(filter, -1.f, 1.f);
+    filters[i] = filter;
+  }
+  direct.setWeight(filters);
+  gemm.setWeight(filters);
+
+  clFTensor input(19, 17, n_branch * n_input);
+  for (size_t i = 0; i < input.getDepth(); i++) {
+    FloatMatrix image(19, 17);
+    randomize<float>(image, -1.f, 1.f);
+    input[i] = image;
+  }
+
+  CNNStorageBPConvolution direct_storage, gemm_storage;
+  clFTensor direct_output = direct.computeForward(queue, input, direct_storage);
+  clFTensor gemm_output = gemm.computeForward(queue, input, gemm_storage);
+
+  clFTensor errors(10, 18, n_branch * n_filter * n_input);
+  for (size_t i = 0; i < errors.getDepth(); i++) {
+    FloatMatrix error(10, 18);
+    randomize<float>(error, -1.f, 1.f);
+    errors[i] = error;
+  }
+  clFTensor direct_error = direct.computeBackward(queue, errors, direct_storage);
+  clFTensor gemm_error = gemm.computeBackward(queue, errors, gemm_storage);
+
+  auto expectNear = [](const clFTensor &expected, const clFTensor &actual) {
+    ASSERT_EQ(expected.getDepth(), actual.getDepth());
+    for (size_t ii = 0; ii < expected.getDepth(); ii++) {
+      auto expected_matrix = expected[ii].toFloatMatrix(true);
+      auto actual_matrix = actual[ii].toFloatMatrix(true);
+      for (size_t i = 0; i < expected_matrix.getRows(); i++) {
+        for (size_t j = 0; j < expected_matrix.getCols(); j++) {
+          EXPECT_NEAR(expected_matrix(i, j), actual_matrix(i, j), 1e-4f);
+        }
+      }
+    }
+  };
+  expectNear(gemm_output, direct_output);
+  expectNear(gemm_error, direct_error);
+  expectNear(gemm_storage.error_filter, direct_storage.error_filter);
+}
+
+TEST(CNNLayerTest, fusedConvolutionPoolingMatchesLayers) {
+  auto &queue = utils::cl_wrapper.getDefaultQueue();
+  const size_t n_branch = 2, n_filter = 2, n_input = 3;
+  // Pooled outputs larger than a work-group of the fused kernel
+  CNNConvolutionLayer convolution({20, 19}, {3, 3}, n_filter, af::ActivationFunctionType::relu,
+                                  n_branch, {1, 2}, {1, 1});
+  CNNMaxPoolingLayer max_pooling({21, 18}, {2, 2}, {1, 1}, {1, 0});
+  CNNAvgPoolingLayer avg_pooling({10, 10}, {3, 3}, {2, 2}, {1, 1});
+
+  clFTensor filters(3, 3, n_branch * n_filter);
+  for (size_t i = 0; i < filters.getDepth(); i++) {
+    FloatMatrix filter(3, 3);
+    randomize<float>(filter, -1.f, 1.f);
+    filters[i] = filter;
+  }
+  convolution.setWeight(filters);
+
+  clFTensor input(20, 37, n_branch * n_input);
+  for (size_t i = 0; i < input.getDepth(); i++) {
+    FloatMatrix image(20, 37);
+    randomize<float>(image, -1.f, 1.f);
+    input[i] = image;
+  }
+
+  clFTensor convolved = convolution.compute(queue, input);
+  for (CNNPoolingLayer *pooling : std::initializer_list<CNNPoolingLayer *>{&max_pooling,
+                                                                           &avg_pooling}) {
+    ASSERT_TRUE(convolution.supportsFusion(*pooling));
+    clFTensor expected = pooling->compute(queue, convolved);
+    clFTensor fused = convolution.computeFused(queue, input, *pooling);
+
+    ASSERT_EQ(expected.getDepth(), fused.getDepth());
+    for (size_t ii = 0; ii < expected.getDepth(); ii++) {
+      auto expected_matrix = expected[ii].toFloatMatrix(true);
+      auto fused_matrix = fused[ii].toFloatMatrix(true);
+      ASSERT_EQ(expected_matrix.getRows(), fused_matrix.getRows());
+      ASSERT_EQ(expected_matrix.getCols(), fused_matrix.getCols());
+      for (size_t i = 0; i < expected_matrix.getRows(); i++) {
+        for (size_t j = 0; j < expected_matrix.getCols(); j++) {
+          EXPECT_NEAR(expected_matrix(i, j), fused_matrix(i, j), 1e-4f);
+        }
+      }
+    }
+  }
+}
+
 TEST(CNNLayerTest, canComputeBPConvolutionLayer) {
   auto &queue = utils::cl_wrapper.getDefaultQueue();
   nnet::CNNConvolutionLayer layer({5, 5}, {2, 2}, 2, af::ActivationFunctionType::relu, 2);
@@ -1246,6 +1411,90 @@ TEST(CNNLayerTest, canComputeBPAvgPoolingLayer) {
   }
 }
 
+TEST(CNNLayerTest, canComputeMaxPoolingLayer) {
+  auto &queue = utils::cl_wrapper.getDefaultQueue();
+  CNNMaxPoolingLayer layer({4, 4}, {3, 3});
+
+  const float input_values[6][6] = {{1, 2, 1, 1, 4, 1}, {2, 1, 1, 2, 2, 1}, {4, 3, 2, 1, 2, 1},
+                                    {1, 5, 1, 1, 2, 1}, {2, 1, 1, 4, 1, 1}, {2, 1, 4, 2, 4, 1}};
+  math::FloatMatrix input1(6, 6);
+  for (size_t i = 0; i < 6; i++) {
+    for (size_t j = 0; j < 6; j++) input1(i, j) = input_values[i][j];
+  }
+  math::FloatMatrix input2(input1);
+  input2(0, 0) = 100.f;
+
+  clFTensor input_tensor(6, 6, 2);
+  input_tensor[0] = input1;
+  input_tensor[1] = input2;
+
+  clFTensor output_tensor = layer.compute(queue, input_tensor);
+
+  queue.finish();
+
+  const float valid_values[4][4] = {{4, 3, 4, 4}, {5, 5, 2, 2}, {5, 5, 4, 4}, {5, 5, 4, 4}};
+  for (size_t ii = 0; ii < 2; ii++) {
+    math::FloatMatrix output = output_tensor[ii].toFloatMatrix(true);
+    for (size_t i = 0; i < 4; i++) {
+      for (size_t j = 0; j < 4; j++) {
+        const float valid = (ii == 1 and i == 0 and j == 0) ? 100.f : valid_values[i][j];
+        EXPECT_FLOAT_EQ(valid, output(i, j));
+      }
+    }
+  }
+}
+
+TEST(CNNLayerTest, canComputeBPMaxPoolingLayer) {
+  auto &queue = utils::cl_wrapper.getDefaultQueue();
+  CNNMaxPoolingLayer layer({4, 4}, {3, 3});
+  CNNStorageBPMaxPooling storage({6, 6});
+
+  const float input_values[6][6] = {{1, 2, 1, 1, 4, 1}, {2, 1, 1, 2, 2, 1}, {4, 3, 2, 1, 2, 1},
+                                    {1, 5, 1, 1, 2, 1}, {2, 1, 1, 4, 1, 1}, {2, 1, 4, 2, 4, 1}};
+  math::FloatMatrix input(6, 6);
+  for (size_t i = 0; i < 6; i++) {
+    for (size_t j = 0; j < 6; j++) input(i, j) = input_values[i][j];
+  }
+
+  clFTensor input_tensor(6, 6, 2);
+  input_tensor[0] = input;
+  input_tensor[1] = input;
+
+  clFTensor output_tensor = layer.computeForward(queue, input_tensor, storage);
+  clFTensor predicted = layer.compute(queue, input_tensor);
+
+  clFTensor errors_tensor(4, 4, 2);
+  errors_tensor[0].fill(1.f, queue, true);
+  errors_tensor[1].fill(2.f, queue, true);
+
+  clFTensor errors_input = layer.computeBackward(queue, errors_tensor, storage);
+
+  queue.finish();
+
+  for (size_t ii = 0; ii < 2; ii++) {
+    math::FloatMatrix output = output_tensor[ii].toFloatMatrix(true);
+    math::FloatMatrix expected = predicted[ii].toFloatMatrix(true);
+    for (size_t i = 0; i < 4; i++) {
+      for (size_t j = 0; j < 4; j++) EXPECT_FLOAT_EQ(expected(i, j), output(i, j));
+    }
+  }
+
+  // Each input pixel receives the errors of the windows whose first maximum it is
+  const float valid_values[6][6] = {{0, 0, 0, 0, 2, 0}, {0, 0, 0, 2, 0, 0}, {1, 1, 0, 0, 0, 0},
+                                    {0, 6, 0, 0, 0, 0}, {0, 0, 0, 4, 0, 0}, {0, 0, 0, 0, 0, 0}};
+  for (size_t ii = 0; ii < 2; ii++) {
+    math::FloatMatrix error_input = errors_input[ii].toFloatMatrix(true);
+    for (size_t i = 0; i < 6; i++) {
+      for (size_t j = 0; j < 6; j++) {
+        EXPECT_FLOAT_EQ(valid_values[i][j] * (float) (ii + 1), error_input(i, j));
+      }
+    }
+  }
+
+  clFTensor too_deep(4, 4, 3);
+  ASSERT_ANY_THROW(layer.computeBackward(queue, too_deep, storage));
+}
+
 TEST(CNNBackpropStorage, canCreateBPStorage) {
   CNNStorageBPConvolution convolution_storage;
   ASSERT_EQ(true, convolution_storage.hasGradient());
@@ -0,0 +1,49 @@
+#include "PipelinePartition.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace nnet;
+
+TEST(PipelinePartitionTest, StagesCoverEveryLayerOnce) {
+  MLPTopology topology = {784, 512, 256, 128, 64, 10};
+  for (size_t n_stage = 1; n_stage <= 5; n_stage++) {
+    // Consecutive stages share a layer: the output of a stage is the input of the next one
+    size_t n_layers = 0;
+    size_t previous_output = topology.getInputSize();
+    for (size_t stage = 0; stage < n_stage; stage++) {
+      auto stage_topology = makeStageTopology(topology, stage, n_stage);
+      ASSERT_GE(stage_topology.size(), 2);
+      EXPECT_EQ(stage_topology.getInputSize(), previous_output);
+      for (size_t i = 0; i < stage_topology.size(); i++)
+        EXPECT_EQ(stage_topology[i], topology[n_layers + i]);
+      n_layers += stage_topology.size() - 1;
+      previous_output = stage_topology.getOutputSize();
+    }
+    EXPECT_EQ(n_layers, topology.size() - 1);
+    EXPECT_EQ(previous_output, topology.getOutputSize());
+  }
+}
+
+TEST(PipelinePartitionTest, BalancesTheWeights) {
+  // The first layer holds as many weights as the three following ones
+  MLPTopology topology = {300, 100, 100, 100, 100};
+  auto first = makeStageTopology(topology, 0, 2);
+  auto second = makeStageTopology(topology, 1, 2);
+  EXPECT_EQ(first.size(), 2);
+  EXPECT_EQ(second.size(), 4);
+}
+
+TEST(PipelinePartitionTest, RejectsInvalidStages) {
+  MLPTopology topology = {10, 20, 5};
+  EXPECT_THROW(makeStageTopology(topology, 2, 2), std::invalid_argument);
+  EXPECT_THROW(makeStageTopology(topology, 0, 3), std::invalid_argument);
+  EXPECT_THROW(makeStageTopology({}, 0, 1), std::invalid_argument);
+}
+
+TEST(PipelinePartitionTest, SplitsBatchesEvenly) {
+  EXPECT_EQ(splitBatch(10, 3), (std::vector<size_t>{0, 4, 7, 10}));
+  EXPECT_EQ(splitBatch(8, 4), (std::vector<size_t>{0, 2, 4, 6, 8}));
+  // A micro-batch is never empty
+  EXPECT_EQ(splitBatch(2, 4), (std::vector<size_t>{0, 1, 2}));
+  EXPECT_EQ(splitBatch(0, 4), (std::vector<size_t>{0}));
+}
@@ -0,0 +1,61 @@
+#include "RebalancePlan.hpp"
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+
+using namespace nnet;
+
+TEST(RebalancePlanTest, TargetsPreserveTheTotal) {
+  std::vector<double> throughputs = {1.3, 2.7, 0.4, 5.1};
+  for (size_t total : {0, 1, 7, 100, 1013}) {
+    auto targets = computeTargetCounts(total, throughputs);
+    ASSERT_EQ(targets.size(), throughputs.size());
+    EXPECT_EQ(std::accumulate(targets.begin(), targets.end(), (size_t) 0), total);
+  }
+}
+
+TEST(RebalancePlanTest, TargetsAreProportionalToThroughput) {
+  auto targets = computeTargetCounts(100, {1, 3});
+  EXPECT_EQ(targets, (std::vector<size_t>{25, 75}));
+
+  // Each target is within one sample of its exact share
+  std::vector<double> throughputs = {1.3, 2.7, 0.4, 5.1};
+  double sum = std::accumulate(throughputs.begin(), throughputs.end(), 0.0);
+  targets = computeTargetCounts(1013, throughputs);
+  for (size_t i = 0; i < throughputs.size(); i++)
+    EXPECT_NEAR((double) targets[i], 1013 * throughputs[i] / sum, 1.0);
+}
+
+TEST(RebalancePlanTest, TiesAreBrokenByRank) {
+  EXPECT_EQ(computeTargetCounts(10, {1, 1, 1}), (std::vector<size_t>{4, 3, 3}));
+  EXPECT_EQ(computeTargetCounts(11, {1, 1, 1}), (std::vector<size_t>{4, 4, 3}));
+}
+
+TEST(RebalancePlanTest, RejectsInvalidThroughputs) {
+  EXPECT_THROW(computeTargetCounts(10, {}), std::invalid_argument);
+  EXPECT_THROW(computeTargetCounts(10, {0, 0}), std::invalid_argument);
+}
+
+TEST(RebalancePlanTest, TransfersReachTheTargets) {
+  std::vector<size_t> counts = {40, 10, 30, 20};
+  std::vector<size_t> targets = {10, 35, 20, 35};
+  auto transfers = planTransfers(counts, targets);
+
+  std::vector<long> balance(counts.begin(), counts.end());
+  for (auto &t : transfers) {
+    EXPECT_GT(t.count, 0);
+    EXPECT_NE(t.source, t.destination);
+    // Processes only send their surplus, and never receive and send in the same plan
+    EXPECT_GT(counts[t.source], targets[t.source]);
+    EXPECT_LT(counts[t.destination], targets[t.destination]);
+    balance[t.source] -= (long) t.count;
+    balance[t.destination] += (long) t.count;
+  }
+  for (size_t i = 0; i < counts.size(); i++) EXPECT_EQ(balance[i], (long) targets[i]);
+}
+
+TEST(RebalancePlanTest, NoTransferWhenBalanced) {
+  EXPECT_TRUE(planTransfers({5, 5, 5}, {5, 5, 5}).empty());
+  EXPECT_THROW(planTransfers({5, 5}, {10}), std::invalid_argument);
+}